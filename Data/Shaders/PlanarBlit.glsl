@@ -0,0 +1,117 @@
+/*
+ * BSD 2-Clause License
+ *
+ * Copyright (c) 2022, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+-- Compute
+
+#version 450
+
+layout(push_constant) uniform PushConstants {
+    uint numChannels;
+    uint outputOffset; ///< In number of elements. Even for 16-bit outputs.
+};
+
+layout(binding = 0, rgba32f) uniform readonly image2D inputImage;
+
+#if defined(OUTPUT_FLOAT16) || defined(OUTPUT_BFLOAT16)
+
+layout(local_size_x = BLOCK_SIZE * BLOCK_SIZE) in;
+
+// Two 16-bit elements are packed into one word, as 16-bit storage buffer access is an optional device feature.
+layout(std430, binding = 1) writeonly buffer OutputBuffer {
+    uint outputBuffer[];
+};
+
+float loadElement(uint elementIdx, ivec2 imageDim) {
+    uint planeSize = uint(imageDim.x * imageDim.y);
+    uint c = elementIdx / planeSize;
+    if (c >= numChannels) {
+        return 0.0; // Padding of images with an odd number of elements.
+    }
+    uint pixelIdx = elementIdx - c * planeSize;
+    ivec2 readPos = ivec2(pixelIdx % uint(imageDim.x), pixelIdx / uint(imageDim.x));
+    return imageLoad(inputImage, readPos)[c];
+}
+
+#ifdef OUTPUT_BFLOAT16
+// Round to nearest even (like PyTorch).
+uint floatToBfloat16(float value) {
+    if (isnan(value)) {
+        return 0x7FC0u;
+    }
+    uint bits = floatBitsToUint(value);
+    bits += 0x7FFFu + ((bits >> 16u) & 1u);
+    return bits >> 16u;
+}
+#endif
+
+// Splits the RGBA image into one contiguous plane per channel (i.e., CHW layout as used by PyTorch) and converts the
+// values to 16-bit floats. Each invocation writes one word, i.e., two consecutive elements.
+void main() {
+    ivec2 imageDim = imageSize(inputImage);
+    uint numWords = (numChannels * uint(imageDim.x * imageDim.y) + 1u) / 2u;
+    uint wordIdx = gl_GlobalInvocationID.x + gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x;
+    if (wordIdx >= numWords) {
+        return;
+    }
+    vec2 values = vec2(loadElement(2u * wordIdx, imageDim), loadElement(2u * wordIdx + 1u, imageDim));
+#ifdef OUTPUT_FLOAT16
+    // Values outside of the half range (e.g., fireflies) are undefined after packing, so they saturate to the largest
+    // finite half value. NaNs are passed through unchanged. bfloat16 has the range of float and needs no clamping.
+    const float HALF_MAX = 65504.0;
+    values = mix(clamp(values, vec2(-HALF_MAX), vec2(HALF_MAX)), values, isnan(values));
+    uint word = packHalf2x16(values);
+#else
+    uint word = floatToBfloat16(values.x) | (floatToBfloat16(values.y) << 16u);
+#endif
+    outputBuffer[outputOffset / 2u + wordIdx] = word;
+}
+
+#else
+
+layout(local_size_x = BLOCK_SIZE, local_size_y = BLOCK_SIZE) in;
+
+layout(std430, binding = 1) writeonly buffer OutputBuffer {
+    float outputBuffer[];
+};
+
+// Splits the RGBA image into one contiguous plane per channel (i.e., CHW layout as used by PyTorch).
+void main() {
+    ivec2 readPos = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 imageDim = imageSize(inputImage);
+    if (readPos.x >= imageDim.x || readPos.y >= imageDim.y) {
+        return;
+    }
+    vec4 value = imageLoad(inputImage, readPos);
+    uint planeSize = uint(imageDim.x * imageDim.y);
+    uint pixelIdx = uint(readPos.x + readPos.y * imageDim.x);
+    for (uint c = 0; c < numChannels; c++) {
+        outputBuffer[outputOffset + c * planeSize + pixelIdx] = value[c];
+    }
+}
+
+#endif
@@ -40,26 +40,65 @@
 #include "ResidualRatioTracking.glsl"
 #include "DecompositionTracking.glsl"
 #include "NextEventTracking.glsl"
+#include "FirstEventTracking.glsl"
 
-void pathTraceSample(int i, bool onlyFirstEvent, out ScatterEvent firstEvent){
-    uint frame = frameInfo.frameCount + i;
+/**
+ * Per-invocation accumulation of all samples traced in one dispatch. The sums are kept in registers and only written
+ * to the accumulation images once at the end of the dispatch (see writeAccumulatedSamples).
+ */
+struct SampleAccumulator {
+    vec3 result;
+    float luminanceSquared; ///< Sum of squared result luminance (for adaptive sampling).
+    vec4 cloudOnly;
+    vec4 background;
+    vec4 position;
+    vec2 depth; ///< Sum of depth and squared depth.
+    vec2 density; ///< Sum of density and squared density.
+    vec3 normal;
+    uint numNormalSamples;
+    bool hasReprojUV;
+    vec2 reprojUV;
+    vec4 firstW;
+};
+
+#ifdef COMPUTE_PRIMARY_RAY_ABSORPTION_MOMENTS
+float primaryRayAbsorptionMomentsSum[NUM_PRIMARY_RAY_ABSORPTION_MOMENTS + 1];
+#endif
+
+// Bits of the feature map write mask (indices of FeatureMapTypeVpt on the host side).
+const uint FEATURE_MAP_BIT_FIRST_X = 1u << 1u;
+const uint FEATURE_MAP_BIT_FIRST_W = 1u << 2u;
+const uint FEATURE_MAP_BIT_NORMAL = 1u << 3u;
+const uint FEATURE_MAP_BIT_CLOUD_ONLY = 1u << 4u;
+const uint FEATURE_MAP_BIT_DEPTH = 1u << 5u;
+const uint FEATURE_MAP_BIT_DENSITY = 1u << 6u;
+const uint FEATURE_MAP_BIT_BACKGROUND = 1u << 7u;
+const uint FEATURE_MAP_BIT_REPROJ_UV = 1u << 8u;
+
+// Pixel traced by this invocation. While the camera is moving, one invocation traces a block of pixelStride^2 pixels
+// and stores the samples in the top left pixel of the block (see InteractionUpsampling.glsl).
+ivec2 pixelCoord;
+
+// Seed offset of the sample stream of the samples only contributing to the feature maps. It keeps them independent of
+// the full path samples, which use the sample indices of the following dispatches.
+const uint FEATURE_ONLY_SAMPLE_STREAM_SEED_OFFSET = 0x9e3779b9u;
 
+void pathTraceSample(
+        uint frame, uint seedOffset, bool onlyFirstEvent, uint featureMapMask, inout SampleAccumulator acc) {
     ivec2 dim = imageSize(resultImage);
-    ivec2 imageCoord = ivec2(gl_GlobalInvocationID.xy);
 
-    uint seed = frame * dim.x * dim.y + gl_GlobalInvocationID.x + gl_GlobalInvocationID.y * dim.x;
-#ifdef CUSTOM_SEED_OFFSET
-    seed += CUSTOM_SEED_OFFSET;
-#endif
-    initializeRandom(seed);
+    uint seed = frame * dim.x * dim.y + pixelCoord.x + pixelCoord.y * dim.x;
+    initializeRandom(seed + seedOffset);
+    initializeSampler(frame, uvec2(pixelCoord), seedOffset);
 
-    vec2 screenCoord = 2.0 * (gl_GlobalInvocationID.xy + vec2(random(), random())) / dim - 1;
+    vec2 screenCoord = 2.0 * (vec2(pixelCoord) + vec2(random(), random()) * float(frameInfo.pixelStride)) / dim - 1;
 
     // Get ray direction and volume entry point
     vec3 x, w;
     createCameraRay(screenCoord, x, w);
 
     // Perform a single path and get radiance
+    ScatterEvent firstEvent;
 #ifdef COMPUTE_SCATTER_RAY_ABSORPTION_MOMENTS
     float scatterRayAbsorptionMoments[NUM_SCATTER_RAY_ABSORPTION_MOMENTS + 1];
 #endif
@@ -83,84 +122,367 @@ void pathTraceSample(int i, bool onlyFirstEvent, out ScatterEvent firstEvent){
     vec3 result = nextEventTracking(x, w, firstEvent, onlyFirstEvent);
 #elif defined(USE_NEXT_EVENT_TRACKING_SPECTRAL)
     vec3 result = nextEventTrackingSpectral(x, w, firstEvent, onlyFirstEvent);
+#elif defined(USE_FEATURE_MAPS_ONLY)
+    vec3 result = firstEventTracking(x, w, firstEvent);
 #endif
 
     if (!onlyFirstEvent) {
-        // Accumulate cloudOnly
+        acc.cloudOnly += firstEvent.hasValue ? vec4(result, 1) : vec4(0);
+        if ((featureMapMask & FEATURE_MAP_BIT_BACKGROUND) != 0u) {
+            acc.background += firstEvent.hasValue ? vec4(sampleSkybox(w), 1) : vec4(result, 1);
+        }
+        acc.result += result;
+        float resultLuminance = luminance(result);
+        acc.luminanceSquared += resultLuminance * resultLuminance;
+    }
+
+    acc.position += firstEvent.hasValue ? vec4(firstEvent.x, 1) : vec4(0);
+    acc.depth += firstEvent.hasValue ? vec2(firstEvent.depth, firstEvent.depth * firstEvent.depth) : vec2(0);
+    acc.density += firstEvent.hasValue ? vec2(firstEvent.density * .001, firstEvent.density * firstEvent.density * .001 * .001) : vec2(0);
+
+    // Saving the first scatter position and direction
+    if (firstEvent.hasValue) {
+        vec4 prevClip = (parameters.previousViewProjMatrix * vec4(firstEvent.x, 1));
+        acc.reprojUV = prevClip.xy / prevClip.w * .5 + .5;
+        acc.hasReprojUV = true;
+
+        if ((featureMapMask & FEATURE_MAP_BIT_NORMAL) != 0u) {
+            acc.normal += getCloudFiniteDifference(firstEvent.x);
+            acc.numNormalSamples++;
+        }
+
+        acc.firstW = vec4(firstEvent.w, firstEvent.pdf_w);
+    } else {
+        acc.firstW = vec4(0);
+    }
+
+#ifdef COMPUTE_PRIMARY_RAY_ABSORPTION_MOMENTS
+    float primaryRayAbsorptionMoments[NUM_PRIMARY_RAY_ABSORPTION_MOMENTS + 1];
+    computePrimaryRayAbsorptionMoments(x, w, primaryRayAbsorptionMoments);
+    for (int i = 0; i <= NUM_PRIMARY_RAY_ABSORPTION_MOMENTS; i++) {
+        primaryRayAbsorptionMomentsSum[i] += primaryRayAbsorptionMoments[i];
+    }
+#endif
+}
+
+#ifdef USE_TEMPORAL_ACCUMULATION
+// Distance at which pixels without a first event are reprojected (i.e., the background only depends on the direction).
+const float TEMPORAL_BACKGROUND_DISTANCE = 1e4;
+
+/**
+ * Returns the accumulated result (xyz) and its number of samples (w) the samples of this dispatch are blended with.
+ * When the accumulation was restarted because the camera moved or the cloud data changed, the history of the previous
+ * view is reprojected using the mean first event position of this dispatch. Pixels that were not visible in the
+ * previous view or whose first event differs too much in position or density are rejected, and the number of reused
+ * samples is capped so that stale history fades out quickly.
+ */
+vec4 getTemporalHistory(SampleAccumulator acc, uint frame, uint numFeatureSamples) {
+    ivec2 imageCoord = pixelCoord;
+    if (frame != 0u) {
+        return vec4(imageLoad(accImage, imageCoord).xyz, imageLoad(temporalSampleInfoImage, imageCoord).x);
+    }
+    if (frameInfo.reprojectHistory == 0u) {
+        return vec4(0.0);
+    }
+
+    ivec2 dim = imageSize(resultImage);
+    vec3 cameraPosition, w;
+    createCameraRay(2.0 * (vec2(imageCoord) + vec2(0.5)) / vec2(dim) - 1.0, cameraPosition, w);
+    bool hasFirstEvent = acc.position.w > 0.0;
+    vec3 position = hasFirstEvent
+            ? acc.position.xyz / acc.position.w : cameraPosition + w * TEMPORAL_BACKGROUND_DISTANCE;
+
+    vec4 prevClip = parameters.historyViewProjMatrix * vec4(position, 1.0);
+    if (prevClip.w <= 0.0) {
+        return vec4(0.0);
+    }
+    ivec2 prevCoord = ivec2(floor((prevClip.xy / prevClip.w * 0.5 + 0.5) * vec2(dim)));
+    if (any(lessThan(prevCoord, ivec2(0))) || any(greaterThanEqual(prevCoord, dim))) {
+        return vec4(0.0);
+    }
+
+    // Disocclusion test.
+    vec4 historyPosition = imageLoad(historyPositionImage, prevCoord);
+    bool historyHasFirstEvent = historyPosition.w > 0.0;
+    if (hasFirstEvent != historyHasFirstEvent) {
+        return vec4(0.0);
+    }
+    if (hasFirstEvent) {
+        float positionDifference = distance(position, historyPosition.xyz / historyPosition.w);
+        if (positionDifference > parameters.temporalPositionTolerance * distance(position, cameraPosition)) {
+            return vec4(0.0);
+        }
+    }
+    vec2 historySampleInfo = imageLoad(historySampleInfoImage, prevCoord).xy;
+    float density = acc.density.x / float(numFeatureSamples);
+    if (abs(density - historySampleInfo.y) > parameters.temporalDensityTolerance * max(density, historySampleInfo.y)) {
+        return vec4(0.0);
+    }
+
+    return vec4(
+            imageLoad(historyAccImage, prevCoord).xyz,
+            min(historySampleInfo.x, float(parameters.temporalMaxHistoryLength)));
+}
+#endif
+
+/**
+ * Blends the samples of this dispatch into the accumulation images. The images store the running mean over the
+ * 'frame' samples of previous dispatches, so the new batch mean is weighted by numSamples / (frame + numSamples).
+ * Feature maps whose bit is not set in featureMapMask are left untouched. Returns the new accumulated result.
+ */
+vec3 writeAccumulatedSamples(
+        SampleAccumulator acc, uint frame, uint numSamples, uint numFeatureSamples, uint featureMapMask) {
+    ivec2 imageCoord = pixelCoord;
+    float invNumSamples = 1.0 / float(numSamples);
+    float invNumFeatureSamples = 1.0 / float(numFeatureSamples);
+    float blendWeight = float(numSamples) / float(frame + numSamples);
+
+    // Accumulate result
+#ifdef USE_TEMPORAL_ACCUMULATION
+    // The result may reuse (reprojected) history, so the number of accumulated samples is tracked per pixel.
+    vec4 history = getTemporalHistory(acc, frame, numFeatureSamples);
+    float numResultSamples = history.w + float(numSamples);
+    vec3 result = mix(history.xyz, acc.result * invNumSamples, float(numSamples) / numResultSamples);
+
+    vec4 temporalPositionOld = frame == 0 ? vec4(0) : imageLoad(temporalPositionImage, imageCoord);
+    vec4 temporalPosition = mix(temporalPositionOld, acc.position * invNumFeatureSamples, blendWeight);
+    imageStore(temporalPositionImage, imageCoord, temporalPosition);
+    float temporalDensityOld = frame == 0 ? 0.0 : imageLoad(temporalSampleInfoImage, imageCoord).y;
+    float temporalDensity = mix(temporalDensityOld, acc.density.x * invNumFeatureSamples, blendWeight);
+    imageStore(temporalSampleInfoImage, imageCoord, vec4(numResultSamples, temporalDensity, 0, 0));
+#else
+    vec3 resultOld = frame == 0 ? vec3(0) : imageLoad(accImage, imageCoord).xyz;
+    vec3 result = mix(resultOld, acc.result * invNumSamples, blendWeight);
+#endif
+    imageStore(accImage, imageCoord, vec4(result, 1));
+    imageStore(resultImage, imageCoord, vec4(result, 1));
+
+    // Accumulate cloudOnly
+    if ((featureMapMask & FEATURE_MAP_BIT_CLOUD_ONLY) != 0u) {
         vec4 cloudOnlyOld = frame == 0 ? vec4(0) : imageLoad(cloudOnlyImage, imageCoord);
-        vec4 cloudOnly = firstEvent.hasValue ? vec4(result, 1) : vec4(0);
-        cloudOnly = mix(cloudOnlyOld, cloudOnly, 1.0 / float(frame + 1));
+        vec4 cloudOnly = mix(cloudOnlyOld, acc.cloudOnly * invNumSamples, blendWeight);
         imageStore(cloudOnlyImage, imageCoord, cloudOnly);
+    }
 
-        // Accumulate background
+    // Accumulate background
+    if ((featureMapMask & FEATURE_MAP_BIT_BACKGROUND) != 0u) {
         vec4 backgroundOld = frame == 0 ? vec4(0) : imageLoad(backgroundImage, imageCoord);
-        vec4 background = firstEvent.hasValue ? vec4(sampleSkybox(w), 1) : vec4(result, 1);
-        background = mix(backgroundOld, background, 1.0 / float(frame + 1));
+        vec4 background = mix(backgroundOld, acc.background * invNumSamples, blendWeight);
         imageStore(backgroundImage, imageCoord, background);
-
-
-        // Accumulate result
-        vec3 resultOld = frame == 0 ? vec3(0) : imageLoad(accImage, imageCoord).xyz;
-        result = mix(resultOld, result, 1.0 / float(frame + 1));
-        imageStore(accImage, imageCoord, vec4(result, 1));
-        imageStore(resultImage, imageCoord, vec4(result, 1));
     }
 
-    vec4 positionOld = frame == 0 ? vec4(0) : imageLoad(firstX, imageCoord);
-    vec4 position = firstEvent.hasValue ? vec4(firstEvent.x, 1) : vec4(0);
-    position = mix(positionOld, position, 1.0 / float(frame + 1));
-    imageStore(firstX, imageCoord, position);
-
-    vec2 depthOld = frame == 0 ? vec2(0) : imageLoad(depthImage, imageCoord).xy;
-    depthOld.y = depthOld.y * depthOld.y + depthOld.x * depthOld.x;
-    vec2 depth = firstEvent.hasValue ? vec2(firstEvent.depth, firstEvent.depth * firstEvent.depth) : vec2(0);
-    depth = mix(depthOld, depth, 1.0 / float(frame + 1));
-    imageStore(depthImage, imageCoord, vec4(depth.x, sqrt(max(0.,depth.y - depth.x * depth.x)),0,0));
+    if ((featureMapMask & FEATURE_MAP_BIT_FIRST_X) != 0u) {
+        vec4 positionOld = frame == 0 ? vec4(0) : imageLoad(firstX, imageCoord);
+        vec4 position = mix(positionOld, acc.position * invNumFeatureSamples, blendWeight);
+        imageStore(firstX, imageCoord, position);
+    }
 
-    vec2 densityOld = frame == 0 ? vec2(0) : imageLoad(densityImage, imageCoord).xy;
-    densityOld.y = densityOld.y * densityOld.y + densityOld.x * densityOld.x;
-    vec2 density = firstEvent.hasValue ? vec2(firstEvent.density * .001, firstEvent.density * firstEvent.density * .001 * .001) : vec2(0);
-    density = mix(densityOld, density, 1.0 / float(frame + 1));
-    imageStore(densityImage, imageCoord, vec4(density.x, sqrt(max(0.,density.y - density.x * density.x)),0,0));
+    if ((featureMapMask & FEATURE_MAP_BIT_DEPTH) != 0u) {
+        vec2 depthOld = frame == 0 ? vec2(0) : imageLoad(depthImage, imageCoord).xy;
+        depthOld.y = depthOld.y * depthOld.y + depthOld.x * depthOld.x;
+        vec2 depth = mix(depthOld, acc.depth * invNumFeatureSamples, blendWeight);
+        imageStore(depthImage, imageCoord, vec4(depth.x, sqrt(max(0.,depth.y - depth.x * depth.x)),0,0));
+    }
 
-    vec2 oldReprojUV = frame == 0 ? vec2(-1,-1) : imageLoad(reprojUVImage, imageCoord).xy;
-    vec4 prevClip = (parameters.previousViewProjMatrix * vec4(firstEvent.x, 1));
-    vec2 reprojUV = prevClip.xy / prevClip.w;
-    reprojUV = reprojUV * .5 + .5;
-    reprojUV = firstEvent.hasValue? reprojUV : oldReprojUV;
-    imageStore(reprojUVImage, imageCoord, vec4(reprojUV, 0, 0));
+    if ((featureMapMask & FEATURE_MAP_BIT_DENSITY) != 0u) {
+        vec2 densityOld = frame == 0 ? vec2(0) : imageLoad(densityImage, imageCoord).xy;
+        densityOld.y = densityOld.y * densityOld.y + densityOld.x * densityOld.x;
+        vec2 density = mix(densityOld, acc.density * invNumFeatureSamples, blendWeight);
+        imageStore(densityImage, imageCoord, vec4(density.x, sqrt(max(0.,density.y - density.x * density.x)),0,0));
+    }
 
-    // Saving the first scatter position and direction
-    if (firstEvent.hasValue) {
-        vec3 diff = getCloudFiniteDifference(firstEvent.x);
+    if ((featureMapMask & FEATURE_MAP_BIT_REPROJ_UV) != 0u) {
+        vec2 reprojUV = acc.hasReprojUV ? acc.reprojUV : (frame == 0 ? vec2(-1,-1) : imageLoad(reprojUVImage, imageCoord).xy);
+        imageStore(reprojUVImage, imageCoord, vec4(reprojUV, 0, 0));
+    }
 
-        vec3 diffOld = frame == 0 ? vec3(0) : imageLoad(normalImage, imageCoord).xyz;
-        diff = mix(diffOld, diff, 1.0 / float(frame + 1));
-        imageStore(normalImage, imageCoord, vec4(diff,1));
+    if ((featureMapMask & FEATURE_MAP_BIT_NORMAL) != 0u) {
+        if (acc.numNormalSamples > 0u) {
+            vec3 diffOld = frame == 0 ? vec3(0) : imageLoad(normalImage, imageCoord).xyz;
+            vec3 diff = mix(diffOld, acc.normal / float(acc.numNormalSamples), blendWeight);
+            imageStore(normalImage, imageCoord, vec4(diff,1));
+        } else {
+            imageStore(normalImage, imageCoord, vec4(0));
+        }
+    }
 
-        //imageStore(firstX, imageCoord, vec4(firstEvent.x, firstEvent.pdf_x));
-        imageStore(firstW, imageCoord, vec4(firstEvent.w, firstEvent.pdf_w));
-    } else {
-        //imageStore(firstX, imageCoord, vec4(0));
-        imageStore(normalImage, imageCoord, vec4(0));
-        imageStore(firstW, imageCoord, vec4(0));
+    if ((featureMapMask & FEATURE_MAP_BIT_FIRST_W) != 0u) {
+        imageStore(firstW, imageCoord, acc.firstW);
     }
 
 #ifdef COMPUTE_PRIMARY_RAY_ABSORPTION_MOMENTS
-    float primaryRayAbsorptionMoments[NUM_PRIMARY_RAY_ABSORPTION_MOMENTS + 1];
-    computePrimaryRayAbsorptionMoments(x, w, primaryRayAbsorptionMoments);
     for (int i = 0; i <= NUM_PRIMARY_RAY_ABSORPTION_MOMENTS; i++) {
-        float moment = primaryRayAbsorptionMoments[i];
         float momentOld = frame == 0 ? 0.0 : imageLoad(primaryRayAbsorptionMomentsImage, ivec3(imageCoord, i)).x;
-        moment = mix(momentOld, moment, 1.0 / float(frame + 1));
+        float moment = mix(momentOld, primaryRayAbsorptionMomentsSum[i] * invNumFeatureSamples, blendWeight);
         imageStore(primaryRayAbsorptionMomentsImage, ivec3(imageCoord, i), vec4(moment));
     }
 #endif
+
+    return result;
+}
+
+#ifndef USE_ADAPTIVE_SAMPLING
+// Number of strata per dimension used for integrating the environment over the footprint of a background pixel.
+const int BACKGROUND_NUM_STRATA = 8;
+
+/**
+ * Fills a pixel whose rays all miss the cloud box. The environment is integrated over the pixel footprint with
+ * stratified samples, so the pixel is converged after this dispatch and excluded from the following dispatches.
+ */
+void writeBackgroundPixel(uint featureMapMask) {
+    ivec2 dim = imageSize(resultImage);
+    vec3 x, w;
+    vec3 background = vec3(0.0);
+#ifdef USE_FEATURE_MAPS_ONLY
+    // No environment lookups; only the feature maps (which are empty for background pixels) are written.
+    createCameraRay(2.0 * (vec2(pixelCoord) + vec2(0.5) * float(frameInfo.pixelStride)) / dim - 1, x, w);
+#else
+    for (int j = 0; j < BACKGROUND_NUM_STRATA; j++) {
+        for (int i = 0; i < BACKGROUND_NUM_STRATA; i++) {
+            vec2 offset = (vec2(i, j) + vec2(0.5)) / float(BACKGROUND_NUM_STRATA) * float(frameInfo.pixelStride);
+            createCameraRay(2.0 * (vec2(pixelCoord) + offset) / dim - 1, x, w);
+            background += sampleSkybox(w) + sampleLight(w);
+        }
+    }
+    background /= float(BACKGROUND_NUM_STRATA * BACKGROUND_NUM_STRATA);
+#endif
+
+    float backgroundLuminance = luminance(background);
+    SampleAccumulator acc = SampleAccumulator(
+            background, backgroundLuminance * backgroundLuminance, vec4(0), vec4(background, 1), vec4(0),
+            vec2(0), vec2(0), vec3(0), 0u, false, vec2(0), vec4(0));
+#ifdef COMPUTE_PRIMARY_RAY_ABSORPTION_MOMENTS
+    computePrimaryRayAbsorptionMoments(x, w, primaryRayAbsorptionMomentsSum);
+#endif
+    writeAccumulatedSamples(acc, 0u, 1u, 1u, featureMapMask);
 }
+#endif
+
+#ifdef USE_ADAPTIVE_SAMPLING
+shared uint tileNumActivePixelsShared;
+shared uint tileNumSamplesShared;
+shared uint tileNumConvergedPixelsShared;
+
+/// Tests whether the relative standard error of the mean luminance estimate of a pixel is below the threshold.
+bool getIsPixelConverged(float mean, float secondMoment, float numSamples) {
+    if (numSamples < float(parameters.adaptiveSamplingMinNumSamples)) {
+        return false;
+    }
+    float variance = max(secondMoment - mean * mean, 0.0);
+    float standardError = sqrt(variance / numSamples);
+    return standardError <= parameters.adaptiveSamplingErrorThreshold * max(mean, 1e-3);
+}
+#endif
 
 void main() {
-    for (int i = 0; i < parameters.numFeatureMapSamplesPerFrame; i++){
-        ScatterEvent firstEvent;
-        pathTraceSample(i, i > 0, firstEvent);
+    pixelCoord = frameInfo.pixelOffset + ivec2(gl_GlobalInvocationID.xy * frameInfo.pixelStride);
+    uint frame = frameInfo.frameCount;
+    uint numSamples = max(frameInfo.numSamples, 1u);
+
+#ifndef USE_ADAPTIVE_SAMPLING
+    // Pixels outside of the projected cloud box only see the environment. They are filled in the first dispatch of an
+    // accumulation, and the following dispatches only cover the projected box.
+    if (any(lessThan(pixelCoord + ivec2(frameInfo.pixelStride), frameInfo.coveredPixelsMin))
+            || any(greaterThanEqual(pixelCoord, frameInfo.coveredPixelsMax))) {
+        writeBackgroundPixel(parameters.featureMapWriteMask);
+        return;
     }
-}
\ No newline at end of file
+#endif
+
+#ifdef USE_ADAPTIVE_SAMPLING
+    // Tiles without any unconverged pixel after the last dispatch are skipped as a whole (uniform branch).
+    uint tileIdx = gl_WorkGroupID.x + gl_WorkGroupID.y * gl_NumWorkGroups.x;
+    if (frame != 0u && tileNumActivePixels[tileIdx] == 0u) {
+        return;
+    }
+    if (gl_LocalInvocationIndex == 0u) {
+        tileNumActivePixelsShared = 0u;
+        tileNumSamplesShared = 0u;
+        tileNumConvergedPixelsShared = 0u;
+    }
+    barrier();
+
+    ivec2 imageCoord = pixelCoord;
+    bool isPixelActive = all(lessThan(imageCoord, imageSize(resultImage)));
+    vec2 varianceOld = vec2(0.0);
+    if (isPixelActive && frame != 0u) {
+        varianceOld = imageLoad(varianceImage, imageCoord).xy;
+        float meanOld = luminance(imageLoad(accImage, imageCoord).xyz);
+        isPixelActive = !getIsPixelConverged(meanOld, varianceOld.x, varianceOld.y);
+        frame = uint(varianceOld.y);
+    }
+    if (isPixelActive) {
+#endif
+
+    SampleAccumulator acc = SampleAccumulator(
+            vec3(0), 0.0, vec4(0), vec4(0), vec4(0), vec2(0), vec2(0), vec3(0), 0u, false, vec2(0), vec4(0));
+#ifdef COMPUTE_PRIMARY_RAY_ABSORPTION_MOMENTS
+    for (int i = 0; i <= NUM_PRIMARY_RAY_ABSORPTION_MOMENTS; i++) {
+        primaryRayAbsorptionMomentsSum[i] = 0.0;
+    }
+#endif
+
+    // Feature maps converge much faster than the result and are only updated for the first samples if requested.
+    uint featureMapMask = parameters.featureMapWriteMask;
+    if (parameters.featureMapSampleLimit > 0 && frame >= uint(parameters.featureMapSampleLimit)) {
+        featureMapMask = 0u;
+    }
+
+    // Full paths traced in this dispatch. In the feature maps only mode, all samples stop at the first event.
+#ifdef USE_FEATURE_MAPS_ONLY
+    const bool onlyFirstEvent = true;
+#else
+    const bool onlyFirstEvent = false;
+#endif
+    uint sampleIndex = frameInfo.sampleIndexOffset + frameInfo.frameCount;
+    for (uint i = 0; i < numSamples; i++) {
+        pathTraceSample(sampleIndex + i, parameters.customSeedOffset, onlyFirstEvent, featureMapMask, acc);
+    }
+
+    // Additional samples only contributing to the feature maps.
+    uint numFeatureOnlySamples = 0u;
+    if (featureMapMask != 0u) {
+        numFeatureOnlySamples = uint(max(parameters.numFeatureMapSamplesPerFrame - 1, 0));
+    }
+    // They use their own sample stream, where every dispatch has a disjoint range of numFeatureOnlySamples indices.
+    uint featureOnlySeedOffset = parameters.customSeedOffset + FEATURE_ONLY_SAMPLE_STREAM_SEED_OFFSET;
+    for (uint i = 0; i < numFeatureOnlySamples; i++) {
+        pathTraceSample(
+                sampleIndex * numFeatureOnlySamples + i, featureOnlySeedOffset, true, featureMapMask, acc);
+    }
+
+    vec3 result = writeAccumulatedSamples(
+            acc, frame, numSamples, numSamples + numFeatureOnlySamples, featureMapMask);
+
+#ifdef USE_ADAPTIVE_SAMPLING
+        float blendWeight = float(numSamples) / float(frame + numSamples);
+        vec2 variance = vec2(
+                mix(varianceOld.x, acc.luminanceSquared / float(numSamples), blendWeight), float(frame + numSamples));
+        imageStore(varianceImage, imageCoord, vec4(variance, 0.0, 0.0));
+
+        atomicAdd(tileNumSamplesShared, numSamples);
+        if (getIsPixelConverged(luminance(result), variance.x, variance.y)) {
+            atomicAdd(tileNumConvergedPixelsShared, 1u);
+        } else {
+            atomicAdd(tileNumActivePixelsShared, 1u);
+        }
+    }
+
+    barrier();
+    if (gl_LocalInvocationIndex == 0u) {
+        tileNumActivePixels[tileIdx] = tileNumActivePixelsShared;
+        // 64-bit counter emulated with two 32-bit words; the carry is detected by the unsigned overflow.
+        uint numSamplesOld = atomicAdd(numSamplesTracedLow, tileNumSamplesShared);
+        if (numSamplesOld + tileNumSamplesShared < numSamplesOld) {
+            atomicAdd(numSamplesTracedHigh, 1u);
+        }
+        uint numConvergedPixelsOld = atomicAdd(numConvergedPixels, tileNumConvergedPixelsShared);
+        ivec2 resultImageSize = imageSize(resultImage);
+        uint numPixels = uint(resultImageSize.x * resultImageSize.y);
+        if (tileNumConvergedPixelsShared != 0u && numConvergedPixelsOld + tileNumConvergedPixelsShared == numPixels) {
+            // This work group converged the last pixels, so the threshold was reached by this dispatch.
+            convergedFrameCount = frameInfo.frameCount + numSamples;
+        }
+    }
+#endif
+}
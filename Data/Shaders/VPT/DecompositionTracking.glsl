@@ -45,7 +45,7 @@ vec3 analogDecompositionTracking(vec3 x, vec3 w, out ScatterEvent firstEvent) {
         float majorant = parameters.extinction.x;
         float absorptionAlbedo = 1.0 - parameters.scatteringAlbedo.x;
 
-        ivec3 voxelGridSize = textureSize(gridImage, 0);
+        ivec3 voxelGridSize = parameters.gridResolution;
         vec3 boxDelta = parameters.boxMax - parameters.boxMin;
         vec3 superVoxelSize = parameters.superVoxelSize * boxDelta / voxelGridSize;
 
@@ -105,6 +105,7 @@ vec3 analogDecompositionTracking(vec3 x, vec3 w, out ScatterEvent firstEvent) {
                             return vec3(0.0); // absorption event/emission
                         }
 
+                        samplerNextVertex();
                         float pdf_w;
                         w = importanceSamplePhase(parameters.phaseG, w, pdf_w);
                         t_r = 0.0;
@@ -339,6 +340,7 @@ vec3 analogDecompositionTracking(vec3 x, vec3 w, out ScatterEvent firstEvent) {
                         return vec3(0.0); // absorption event/emission
                     }
 
+                    samplerNextVertex();
                     float pdf_w;
                     w = importanceSamplePhase(parameters.phaseG, w, pdf_w);
                     t_r = 0.0;
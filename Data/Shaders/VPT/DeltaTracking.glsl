@@ -104,6 +104,7 @@ vec3 deltaTrackingSpectral(vec3 x, vec3 w, out ScatterEvent firstEvent) {
             }
 
             if (xi < Pa + Ps) { // scattering event
+                samplerNextVertex();
                 float pdf_w;
                 w = importanceSamplePhase(parameters.phaseG, w, pdf_w);
 
@@ -247,6 +248,7 @@ vec3 deltaTracking(
 
             if (xi < 1 - Pn) // scattering event
             {
+                samplerNextVertex();
                 float pdf_w;
                 w = importanceSamplePhase(parameters.phaseG, w, pdf_w);
 
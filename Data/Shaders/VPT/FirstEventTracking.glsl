@@ -0,0 +1,90 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2021-2022, Christoph Neuhauser, Ludwig Leonard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifdef USE_FEATURE_MAPS_ONLY
+/**
+ * Only samples the first collision of the primary ray with the medium, which is all the feature maps (e.g., first
+ * position, depth, density or normal) depend on. The free-flight distances are sampled like in delta tracking, so the
+ * feature maps converge to the same values, but no scattered paths, shadow rays or environment lookups are traced.
+ * The returned radiance is always zero.
+ */
+vec3 firstEventTracking(vec3 x, vec3 w, out ScatterEvent firstEvent) {
+    firstEvent = ScatterEvent(false, x, 0.0, w, 0.0, 0.0, 0.0);
+
+#ifdef USE_NANOVDB
+    pnanovdb_readaccessor_t accessor = createAccessor();
+#endif
+
+    float majorant = parameters.extinction.x;
+    float absorptionAlbedo = 1.0 - parameters.scatteringAlbedo.x;
+
+    float tMin, tMax;
+    if (rayBoxIntersect(parameters.boxMin, parameters.boxMax, x, w, tMin, tMax)) {
+        x += w * tMin;
+        float d = tMax - tMin;
+        float pdf_x = 1;
+
+        while (true) {
+            float t = -log(max(0.0000000001, 1 - random()))/majorant;
+
+            if (t > d) {
+                break;
+            }
+
+            x += w * t;
+            d -= t;
+
+#ifdef USE_NANOVDB
+            float density = sampleCloud(accessor, x);
+#else
+            float density = sampleCloud(x);
+#endif
+
+            // Real collision with probability sigma_t / majorant; absorption and scattering are chosen as in delta
+            // tracking, so that the first scattering direction (FIRST_W) matches as well.
+            float xi = random();
+            if (xi < density) {
+                firstEvent.x = x;
+                firstEvent.hasValue = true;
+                firstEvent.density = density * parameters.extinction.x;
+                firstEvent.depth = tMax - d;
+                if (xi >= absorptionAlbedo * density) {
+                    samplerNextVertex();
+                    float pdf_w;
+                    firstEvent.w = importanceSamplePhase(parameters.phaseG, w, pdf_w);
+                    firstEvent.pdf_w = pdf_w;
+                    pdf_x *= exp(-majorant * t) * majorant * density;
+                    firstEvent.pdf_x = parameters.scatteringAlbedo.x * parameters.extinction.x * density * pdf_x;
+                } else {
+                    firstEvent.w = vec3(0.);
+                }
+                break;
+            }
+            pdf_x *= exp(-majorant * t) * majorant * (1 - density);
+        }
+    }
+
+    return vec3(0);
+}
+#endif
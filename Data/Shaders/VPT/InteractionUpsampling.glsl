@@ -0,0 +1,101 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2021-2022, Christoph Neuhauser, Ludwig Leonard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+-- Compute
+
+#version 450
+
+layout(local_size_x = BLOCK_SIZE, local_size_y = BLOCK_SIZE) in;
+
+layout(push_constant) uniform PushConstants {
+    // Size of the pixel blocks traced by one VPT shader invocation while the camera is moving. For a value of 1,
+    // the upsampled image is blended with the full resolution accumulation instead.
+    int pixelStride;
+    float blendWeight; ///< Weight of the full resolution accumulation (only used for blending).
+};
+
+// The samples traced at reduced resolution are stored in the top left pixel of each block.
+layout(binding = 0, rgba32f) uniform readonly image2D accImage;
+layout(binding = 1, rg32f) uniform readonly image2D depthImage;
+layout(binding = 2, rgba32f) uniform image2D interactionResultImage;
+layout(binding = 3, rgba32f) uniform writeonly image2D resultImage;
+
+// Relative depth difference at which the weight of a neighboring block falls to 1/e.
+const float DEPTH_SIGMA = 0.05;
+
+float getDepthWeight(float depth, float depthReference) {
+    float maxDepth = max(max(depth, depthReference), 1e-6);
+    return exp(-abs(depth - depthReference) / (DEPTH_SIGMA * maxDepth));
+}
+
+/**
+ * Depth-guided bilinear upsampling: The four blocks closest to the pixel are weighted by their bilinear weight and
+ * the similarity of their mean first event depth to the block containing the pixel. Thus, silhouettes of the cloud
+ * are not blurred with the background.
+ */
+vec3 upsampleResult(ivec2 imageCoord, ivec2 imageDim) {
+    ivec2 numBlocks = (imageDim + ivec2(pixelStride - 1)) / pixelStride;
+    ivec2 blockReference = imageCoord / pixelStride;
+    float depthReference = imageLoad(depthImage, blockReference * pixelStride).x;
+
+    vec2 blockPosition = (vec2(imageCoord) + vec2(0.5)) / float(pixelStride) - vec2(0.5);
+    ivec2 block0 = ivec2(floor(blockPosition));
+    vec2 f = blockPosition - vec2(block0);
+
+    vec3 resultSum = vec3(0.0);
+    float weightSum = 0.0;
+    for (int j = 0; j < 2; j++) {
+        for (int i = 0; i < 2; i++) {
+            ivec2 block = clamp(block0 + ivec2(i, j), ivec2(0), numBlocks - ivec2(1));
+            ivec2 blockCoord = block * pixelStride;
+            float bilinearWeight = (i == 0 ? 1.0 - f.x : f.x) * (j == 0 ? 1.0 - f.y : f.y);
+            float weight = bilinearWeight * getDepthWeight(imageLoad(depthImage, blockCoord).x, depthReference);
+            resultSum += weight * imageLoad(accImage, blockCoord).xyz;
+            weightSum += weight;
+        }
+    }
+    if (weightSum < 1e-6) {
+        return imageLoad(accImage, blockReference * pixelStride).xyz;
+    }
+    return resultSum / weightSum;
+}
+
+void main() {
+    ivec2 imageCoord = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 imageDim = imageSize(resultImage);
+    if (any(greaterThanEqual(imageCoord, imageDim))) {
+        return;
+    }
+
+    vec3 result;
+    if (pixelStride > 1) {
+        result = upsampleResult(imageCoord, imageDim);
+        imageStore(interactionResultImage, imageCoord, vec4(result, 1.0));
+    } else {
+        // Fade from the last upsampled image to the full resolution accumulation after the camera stopped moving.
+        vec3 interactionResult = imageLoad(interactionResultImage, imageCoord).xyz;
+        result = mix(interactionResult, imageLoad(accImage, imageCoord).xyz, blendWeight);
+    }
+    imageStore(resultImage, imageCoord, vec4(result, 1.0));
+}
@@ -29,7 +29,6 @@ float calculateTransmittance(vec3 x, vec3 w
         , pnanovdb_readaccessor_t accessor
 #endif
 ) {
-
     float majorant = parameters.extinction.x;
     float absorptionAlbedo = 1.0 - parameters.scatteringAlbedo.x;
     float scatteringAlbedo = parameters.scatteringAlbedo.x;
@@ -94,6 +93,61 @@ float calculateTransmittance(vec3 x, vec3 w
     }
     return transmittance * rr_factor;
 }
+
+#ifdef USE_SUN_TRANSMITTANCE_VOLUME
+/**
+ * Biased preview: Next event estimation only samples the sun lobe and takes the transmittance toward the sun from the
+ * precomputed volume instead of tracking a shadow ray. The sky radiance is only gathered by the path continuation.
+ */
+vec3 sampleNextEventDirection(out float pdf) {
+    return importanceSampleSun(pdf);
+}
+float evaluateNextEventPDF(vec3 sampledDir) {
+    return evaluateSunPDF(sampledDir);
+}
+#else
+vec3 sampleNextEventDirection(out float pdf) {
+    return importanceSampleSkybox(pdf);
+}
+float evaluateNextEventPDF(vec3 sampledDir) {
+    return evaluateSkyboxPDF(sampledDir);
+}
+#endif
+
+/**
+ * Returns the transmittance-weighted radiance arriving at x from the next event direction w.
+ */
+vec3 calculateTransmittedLight(vec3 x, vec3 w
+#ifdef USE_NANOVDB
+        , pnanovdb_readaccessor_t accessor
+#endif
+) {
+#ifdef USE_SUN_TRANSMITTANCE_VOLUME
+    vec3 coord = (x - parameters.boxMin) / (parameters.boxMax - parameters.boxMin);
+    if (parameters.flipYZ != 0) {
+        coord = coord.xzy;
+    }
+    return texture(sunTransmittanceVolume, coord).x * sampleLight(w);
+#else
+#ifdef USE_NANOVDB
+    return calculateTransmittance(x, w, accessor) * (sampleSkybox(w) + sampleLight(w));
+#else
+    return calculateTransmittance(x, w) * (sampleSkybox(w) + sampleLight(w));
+#endif
+#endif
+}
+
+/**
+ * Returns the radiance reached by the path continuation in direction w after leaving the volume. Only the lights that
+ * are also sampled by next event estimation are weighted with the MIS weight bw_phase of the last scattering event.
+ */
+vec3 calculateEscapedLight(vec3 w, float bw_phase) {
+#ifdef USE_SUN_TRANSMITTANCE_VOLUME
+    return sampleSkybox(w) + bw_phase * sampleLight(w);
+#else
+    return bw_phase * (sampleSkybox(w) + sampleLight(w));
+#endif
+}
 #endif
 
 /**
@@ -200,6 +254,7 @@ vec3 nextEventTrackingSpectral(vec3 x, vec3 w, out ScatterEvent firstEvent, bool
                 //float pdf_w;
                 //w = importanceSamplePhase(parameters.phaseG, w, pdf_w);
 
+                samplerNextVertex();
                 float pdf_w, pdf_nee;
                 vec3 next_w = importanceSamplePhase(parameters.phaseG, w, pdf_w);
 
@@ -216,10 +271,10 @@ vec3 nextEventTrackingSpectral(vec3 x, vec3 w, out ScatterEvent firstEvent, bool
                     return vec3(0);
                 }
 
-                vec3 nee_w = importanceSampleSkybox(pdf_nee);
+                vec3 nee_w = sampleNextEventDirection(pdf_nee);
 
                 float pdf_nee_phase = evaluatePhase(parameters.phaseG, w, nee_w);
-                float pdf_phase_nee = evaluateSkyboxPDF(next_w);
+                float pdf_phase_nee = evaluateNextEventPDF(next_w);
                 w = next_w;
 
                 //bw_phase = pdf_w * pdf_w / (pdf_w * pdf_w + pdf_phase_nee * pdf_phase_nee);
@@ -230,11 +285,10 @@ vec3 nextEventTrackingSpectral(vec3 x, vec3 w, out ScatterEvent firstEvent, bool
                 weights *= sigma_s / (majorant * Ps);
                 color += bw_nee * min(weights, vec3(100000, 100000, 100000)) *
 #ifdef USE_NANOVDB
-                    calculateTransmittance(x,nee_w, accessor) *
+                    calculateTransmittedLight(x, nee_w, accessor) * pdf_nee_phase / pdf_nee;
 #else
-                    calculateTransmittance(x,nee_w) *
+                    calculateTransmittedLight(x, nee_w) * pdf_nee_phase / pdf_nee;
 #endif
-                    (sampleSkybox(nee_w) + sampleLight(nee_w)) * pdf_nee_phase / pdf_nee;
 
                 if (rayBoxIntersect(parameters.boxMin, parameters.boxMax, x, w, tMin, tMax)) {
                     x += w*tMin;
@@ -250,7 +304,7 @@ vec3 nextEventTrackingSpectral(vec3 x, vec3 w, out ScatterEvent firstEvent, bool
         }
     }
 
-    return color + bw_phase * min(weights, vec3(100000, 100000, 100000)) * (sampleSkybox(w) + sampleLight(w));
+    return color + min(weights, vec3(100000, 100000, 100000)) * calculateEscapedLight(w, bw_phase);
 }
 #endif
 
@@ -335,6 +389,7 @@ vec3 nextEventTracking(vec3 x, vec3 w, out ScatterEvent firstEvent, bool onlyFir
 
             if (xi < 1 - Pn)// scattering event
             {
+                samplerNextVertex();
                 float pdf_w, pdf_nee;
                 vec3 next_w = importanceSamplePhase(parameters.phaseG, w, pdf_w);
 
@@ -353,12 +408,12 @@ vec3 nextEventTracking(vec3 x, vec3 w, out ScatterEvent firstEvent, bool onlyFir
                     return vec3(0);
                 }
 
-                vec3 nee_w = importanceSampleSkybox(pdf_nee);
+                vec3 nee_w = sampleNextEventDirection(pdf_nee);
 
                 //next_w = importanceSamplePhase(0.5, w, pdf_w);
                 //next_w = importanceSampleSkybox(pdf_w);
                 float pdf_nee_phase = evaluatePhase(parameters.phaseG, w, nee_w);
-                float pdf_phase_nee = evaluateSkyboxPDF(next_w);
+                float pdf_phase_nee = evaluateNextEventPDF(next_w);
                 w = next_w;
                 //transmittance *= pdf_eval / pdf_w;
 
@@ -367,11 +422,10 @@ vec3 nextEventTracking(vec3 x, vec3 w, out ScatterEvent firstEvent, bool onlyFir
 
                 color += bw_nee * transmittance *
 #ifdef USE_NANOVDB
-                    calculateTransmittance(x,nee_w, accessor) *
+                    calculateTransmittedLight(x, nee_w, accessor) * pdf_nee_phase / pdf_nee;
 #else
-                    calculateTransmittance(x,nee_w) *
+                    calculateTransmittedLight(x, nee_w) * pdf_nee_phase / pdf_nee;
 #endif
-                    (sampleSkybox(nee_w) + sampleLight(nee_w)) * pdf_nee_phase / pdf_nee;
                 //color += bw_phase * transmittance * calculateTransmittance(x,next_w) * (sampleSkybox(next_w) + sampleLight(next_w));
 
                 //return color;
@@ -390,7 +444,7 @@ vec3 nextEventTracking(vec3 x, vec3 w, out ScatterEvent firstEvent, bool onlyFir
     if (!firstEvent.hasValue){
         //color += sampleSkybox(w) + sampleLight(w);
     }
-    return color + bw_phase * transmittance * (sampleSkybox(w) + sampleLight(w));
+    return color + transmittance * calculateEscapedLight(w, bw_phase);
     return transmittance * (sampleSkybox(w) + sampleLight(w));
 }
 #endif
\ No newline at end of file
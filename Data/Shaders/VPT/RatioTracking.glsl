@@ -77,6 +77,7 @@ vec3 ratioTracking(vec3 x, vec3 w, out ScatterEvent firstEvent) {
             if (xi < 1 - Pn) // scattering event
             {
                 transmittance *= 1. - Pa / (Pa + Ps);
+                samplerNextVertex();
                 float pdf_w;
                 w = importanceSamplePhase(parameters.phaseG, w, pdf_w);
 
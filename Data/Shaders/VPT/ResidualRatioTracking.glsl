@@ -106,7 +106,7 @@ vec3 residualRatioTracking(vec3 x, vec3 w, out ScatterEvent firstEvent) {
     float tMinVal, tMaxVal;
     vec3 oldX;
 
-    ivec3 voxelGridSize = textureSize(gridImage, 0);
+    ivec3 voxelGridSize = parameters.gridResolution;
     vec3 boxDelta = parameters.boxMax - parameters.boxMin;
 
     float tMaxX, tMaxY, tMaxZ, tDeltaX, tDeltaY, tDeltaZ;
@@ -225,6 +225,7 @@ vec3 residualRatioTracking(vec3 x, vec3 w, out ScatterEvent firstEvent) {
 
         // https://developer.download.nvidia.com//ray-tracing-gems/rtg2-chapter22-preprint.pdf
         T = reservoirT;
+        samplerNextVertex();
         float pdf_w;
         x = oldX + w * reservoirDist;
         w = importanceSamplePhase(parameters.phaseG, w, pdf_w);
@@ -0,0 +1,89 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2021-2022, Christoph Neuhauser, Ludwig Leonard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+-- Compute
+
+#version 450
+
+layout(local_size_x = BLOCK_SIZE, local_size_y = BLOCK_SIZE, local_size_z = BLOCK_SIZE) in;
+
+layout(push_constant) uniform PushConstants {
+    vec3 boxMin;
+    float extinction;
+    vec3 boxMax;
+    float stepSize; ///< Ray marching step size in world space.
+    vec3 sunDirection;
+    int flipYZ;
+};
+
+layout(binding = 0) uniform sampler3D densityImage;
+#ifdef USE_TRANSFER_FUNCTION
+layout(binding = 1) uniform sampler1D transferFunctionTexture;
+#endif
+// Transmittance toward the sun at the voxel centers of the (normalized) density grid.
+layout(binding = 2, r32f) uniform writeonly image3D sunTransmittanceImage;
+
+// Maps between world space and normalized grid coordinates in the same way as sampleCloud in VptUtils.glsl.
+vec3 worldToGridCoord(vec3 pos) {
+    vec3 coord = (pos - boxMin) / (boxMax - boxMin);
+    return flipYZ != 0 ? coord.xzy : coord;
+}
+
+vec3 gridCoordToWorld(vec3 coord) {
+    return mix(boxMin, boxMax, flipYZ != 0 ? coord.xzy : coord);
+}
+
+float sampleDensity(vec3 pos) {
+    float density = texture(densityImage, worldToGridCoord(pos)).x;
+#ifdef USE_TRANSFER_FUNCTION
+    density = texture(transferFunctionTexture, density).a;
+#endif
+    return density;
+}
+
+/**
+ * Integrates the optical depth from the voxel center to the box boundary along the sun direction with the midpoint
+ * rule. In contrast to the ratio tracking shadow rays of next event tracking, the result is deterministic, but biased.
+ */
+void main() {
+    ivec3 voxel = ivec3(gl_GlobalInvocationID);
+    ivec3 resolution = imageSize(sunTransmittanceImage);
+    if (any(greaterThanEqual(voxel, resolution))) {
+        return;
+    }
+
+    vec3 x = gridCoordToWorld((vec3(voxel) + vec3(0.5)) / vec3(resolution));
+    vec3 t0 = (boxMin - x) / sunDirection;
+    vec3 t1 = (boxMax - x) / sunDirection;
+    vec3 tFar = max(t0, t1);
+    float tExit = max(min(min(tFar.x, tFar.y), tFar.z), 0.0);
+
+    int numSteps = max(int(ceil(tExit / stepSize)), 1);
+    float dt = tExit / float(numSteps);
+    float densitySum = 0.0;
+    for (int i = 0; i < numSteps; i++) {
+        densitySum += sampleDensity(x + (float(i) + 0.5) * dt * sunDirection);
+    }
+    imageStore(sunTransmittanceImage, voxel, vec4(exp(-extinction * densitySum * dt)));
+}
@@ -36,16 +36,23 @@ layout (binding = 2) readonly buffer EmissionNanoVdbBuffer {
 };
 #endif
 #else // USE_NANOVDB
+// Dense grid or, if USE_BRICK_MAP is defined, atlas storing the occupied bricks of the brick map.
 layout (binding = 1) uniform sampler3D gridImage;
 #ifdef USE_EMISSION
 layout (binding = 2) uniform sampler3D emissionImage;
 #endif
+#ifdef USE_BRICK_MAP
+// Atlas position of the brick (x | y << 10 | z << 20) or BRICK_MAP_EMPTY_BRICK for bricks containing only zeros.
+layout (binding = 25) uniform usampler3D brickIndirectionImage;
+#endif
 #endif // USE_NANOVDB
 
 layout (binding = 3) uniform Parameters {
     // Transform from normalized device coordinates to world space.
     mat4 inverseViewProjMatrix;
     mat4 previousViewProjMatrix;
+    // View projection matrix of the temporal history (i.e., of the last dispatch before the accumulation restarted).
+    mat4 historyViewProjMatrix;
     // Cloud properties.
     vec3 boxMin;
     vec3 boxMax;
@@ -73,17 +80,46 @@ layout (binding = 3) uniform Parameters {
     ivec3 superVoxelSize;
     ivec3 superVoxelGridSize;
 
-    //ivec3 gridResolution;
-
     // Whether to use linear RGB or sRGB.
     int useLinearRGB;
 
+    // Adaptive sampling: Pixels stop receiving samples when the relative standard error of their mean luminance
+    // falls below the threshold (after a minimum number of samples).
+    float adaptiveSamplingErrorThreshold;
+    int adaptiveSamplingMinNumSamples;
+
+    // Bit mask of the feature maps to update (see FeatureMapTypeVpt) and number of samples after which no feature map
+    // is updated anymore (0 means no limit).
+    uint featureMapWriteMask;
+    int featureMapSampleLimit;
+
+    // Per-render settings that are passed as uniforms so that changing them does not recompile the shader.
+    uint customSeedOffset; ///< Additive offset for the random seed.
+    int flipYZ; ///< Whether to swap the y and z axes of the grid.
+    int envMapImageUsesLinearRgb; ///< Whether the environment map image stores linear RGB values.
+    uint environmentMapAliasTableSize; ///< Side length of the octahedral importance map of the environment map.
+
+    // Number of voxels of the density grid.
+    ivec3 gridResolution;
+
+    // Temporal accumulation: Rejection thresholds for reprojected history and maximum number of reused samples.
+    float temporalPositionTolerance; ///< Relative to the distance of the first event to the camera.
+    float temporalDensityTolerance; ///< Relative to the larger of the two first event densities.
+    int temporalMaxHistoryLength;
 
 } parameters;
 
 layout (binding = 4) uniform FrameInfo {
-    uint frameCount;
-    uvec3 other;
+    uint frameCount; ///< Number of samples accumulated before this dispatch.
+    uint numSamples; ///< Number of samples per pixel traced in this dispatch.
+    uint sampleIndexOffset; ///< Samples traced in earlier accumulations whose history is reused (temporal mode).
+    uint reprojectHistory; ///< Whether to reproject the history of the previous view (temporal mode).
+    uint pixelStride; ///< Size of the pixel blocks traced by one invocation (> 1 while the camera is moving).
+    uint frameInfoPadding;
+    ivec2 pixelOffset; ///< First pixel covered by this dispatch.
+    // Conservative screen space bounds of the cloud box. All rays of pixels outside of them miss the box.
+    ivec2 coveredPixelsMin;
+    ivec2 coveredPixelsMax;
 } frameInfo;
 
 layout (binding = 5, rgba32f) uniform image2D accImage;
@@ -99,7 +135,16 @@ layout (binding = 9) uniform usampler3D superVoxelGridOccupancyImage;
 
 #ifdef USE_ENVIRONMENT_MAP_IMAGE
 layout (binding = 10) uniform sampler2D environmentMapTexture;
-layout (binding = 11) uniform sampler2D environmentMapOctahedralTexture;
+// Alias table over the texels of the equal-area octahedral mapping of the environment map brightness.
+struct EnvironmentMapAliasTableEntry {
+    float probability; ///< Probability of keeping the texel of this entry instead of switching to the alias.
+    uint alias;
+    float pdf; ///< Probability of sampling the texel of this entry.
+    float aliasPdf; ///< Probability of sampling the alias texel.
+};
+layout (binding = 11, std430) readonly buffer EnvironmentMapAliasTableBuffer {
+    EnvironmentMapAliasTableEntry environmentMapAliasTable[];
+};
 #endif
 
 #ifdef COMPUTE_PRIMARY_RAY_ABSORPTION_MOMENTS
@@ -138,6 +183,38 @@ const float ABSORBANCE_MAX_VALUE = 10.0;
 layout(binding = 21) uniform sampler1D transferFunctionTexture;
 #endif
 
+#ifdef USE_ADAPTIVE_SAMPLING
+// x: Running mean of the squared luminance, y: Number of samples accumulated in the pixel.
+layout (binding = 22, rg32f) uniform image2D varianceImage;
+// Number of unconverged pixels in each tile (i.e., work group) after the last dispatch.
+layout (binding = 23) buffer TileActiveBuffer {
+    uint tileNumActivePixels[];
+};
+layout (binding = 24) buffer AdaptiveSamplingStatsBuffer {
+    uint numSamplesTracedLow;
+    uint numSamplesTracedHigh;
+    uint numConvergedPixels;
+    uint adaptiveSamplingAccumulationIndex; // Only used by the host for detecting stale read back data.
+    uint convergedFrameCount; // Frame count after the dispatch converging the last pixel (or 0 if not converged).
+};
+#endif
+
+#ifdef USE_TEMPORAL_ACCUMULATION
+// Mean first event position (w = fraction of samples with a first event) of the current accumulation.
+layout (binding = 26, rgba32f) uniform image2D temporalPositionImage;
+// x: Number of samples accumulated in accImage (including reused history), y: Mean first event density.
+layout (binding = 27, rg32f) uniform image2D temporalSampleInfoImage;
+// Copies of accImage, temporalPositionImage and temporalSampleInfoImage made before reprojecting the history.
+layout (binding = 28, rgba32f) uniform readonly image2D historyAccImage;
+layout (binding = 29, rgba32f) uniform readonly image2D historyPositionImage;
+layout (binding = 30, rg32f) uniform readonly image2D historySampleInfoImage;
+#endif
+
+#ifdef USE_SUN_TRANSMITTANCE_VOLUME
+// Precomputed transmittance toward the sun at the voxels of the density grid (biased next event tracking preview).
+layout (binding = 31) uniform sampler3D sunTransmittanceVolume;
+#endif
+
 vec2 Multiply(vec2 LHS, vec2 RHS) {
     return vec2(LHS.x * RHS.x - LHS.y * RHS.y, LHS.x * RHS.y + LHS.y * RHS.x);
 }
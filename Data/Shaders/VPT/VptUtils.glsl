@@ -45,7 +45,7 @@ uvec4 rngState = uvec4(0);
 uint tausStep(uint z, int S1, int S2, int S3, uint M) { uint b = (((z << S1) ^ z) >> S2); return ((z & M) << S3) ^ b; }
 uint lcgStep(uint z, uint A, uint C) { return A * z + C; }
 
-float random() {
+float randomWhiteNoise() {
     rngState.x = tausStep(rngState.x, 13, 19, 12, 4294967294);
     rngState.y = tausStep(rngState.y, 2, 25, 4, 4294967288);
     rngState.z = tausStep(rngState.z, 3, 11, 17, 4294967280);
@@ -56,10 +56,157 @@ float random() {
 void initializeRandom(uint seed) {
     rngState = uvec4(seed);
     for (int i = 0; i < seed % 7 + 2; i++) {
-        random();
+        randomWhiteNoise();
+    }
+}
+
+
+//--- Low-Discrepancy Samplers
+
+/*
+ * USE_SAMPLER_SOBOL: Owen-scrambled Sobol sequence with a per-pixel scrambling seed. Dimensions are padded in groups
+ * of four with a shuffled sample index (see "Practical Hash-based Owen Scrambling", Burley 2020).
+ * USE_SAMPLER_SOBOL_BLUE_NOISE: The same sequence, but the sample index is made from the sample number and the Morton
+ * code of the pixel in a 64x64 tile, which distributes the error as blue noise in screen space (see "Screen-Space
+ * Blue-Noise Diffusion of Monte Carlo Sampling Error via Hierarchical Ordering of Pixels", Ahmed and Wonka 2020).
+ *
+ * Every path vertex (i.e., camera ray or scattering event) gets a fixed budget of dimensions. Calls to random()
+ * beyond the budget of the current vertex or beyond the last vertex fall back to white noise.
+ *
+ * Only the first four Sobol dimensions are stored. All higher dimensions reuse them in groups of four, where every
+ * group has its own index shuffle and scrambling seed. The groups are thus independent randomized 4D point sets (i.e.,
+ * stratified within a group, but uncorrelated between groups), so scattering events beyond the first vertex do not
+ * repeat the samples of earlier vertices.
+ */
+#if defined(USE_SAMPLER_SOBOL) || defined(USE_SAMPLER_SOBOL_BLUE_NOISE)
+#define USE_LOW_DISCREPANCY_SAMPLER
+
+// Two padded 4D groups per vertex; 64 low-discrepancy dimensions in total before falling back to white noise.
+const uint SAMPLER_NUM_DIMENSIONS_PER_VERTEX = 8u;
+const uint SAMPLER_MAX_NUM_VERTICES = 8u;
+
+// Direction numbers of the first four Sobol dimensions (Joe and Kuo).
+const uint SOBOL_DIRECTIONS[4 * 32] = uint[](
+        0x80000000u, 0x40000000u, 0x20000000u, 0x10000000u, 0x08000000u, 0x04000000u, 0x02000000u, 0x01000000u,
+        0x00800000u, 0x00400000u, 0x00200000u, 0x00100000u, 0x00080000u, 0x00040000u, 0x00020000u, 0x00010000u,
+        0x00008000u, 0x00004000u, 0x00002000u, 0x00001000u, 0x00000800u, 0x00000400u, 0x00000200u, 0x00000100u,
+        0x00000080u, 0x00000040u, 0x00000020u, 0x00000010u, 0x00000008u, 0x00000004u, 0x00000002u, 0x00000001u,
+        0x80000000u, 0xc0000000u, 0xa0000000u, 0xf0000000u, 0x88000000u, 0xcc000000u, 0xaa000000u, 0xff000000u,
+        0x80800000u, 0xc0c00000u, 0xa0a00000u, 0xf0f00000u, 0x88880000u, 0xcccc0000u, 0xaaaa0000u, 0xffff0000u,
+        0x80008000u, 0xc000c000u, 0xa000a000u, 0xf000f000u, 0x88008800u, 0xcc00cc00u, 0xaa00aa00u, 0xff00ff00u,
+        0x80808080u, 0xc0c0c0c0u, 0xa0a0a0a0u, 0xf0f0f0f0u, 0x88888888u, 0xccccccccu, 0xaaaaaaaau, 0xffffffffu,
+        0x80000000u, 0xc0000000u, 0x60000000u, 0x90000000u, 0xe8000000u, 0x5c000000u, 0x8e000000u, 0xc5000000u,
+        0x68800000u, 0x9cc00000u, 0xee600000u, 0x55900000u, 0x80680000u, 0xc09c0000u, 0x60ee0000u, 0x90550000u,
+        0xe8808000u, 0x5cc0c000u, 0x8e606000u, 0xc5909000u, 0x6868e800u, 0x9c9c5c00u, 0xeeee8e00u, 0x5555c500u,
+        0x8000e880u, 0xc0005cc0u, 0x60008e60u, 0x9000c590u, 0xe8006868u, 0x5c009c9cu, 0x8e00eeeeu, 0xc5005555u,
+        0x80000000u, 0xc0000000u, 0x20000000u, 0x50000000u, 0xf8000000u, 0x74000000u, 0xa2000000u, 0x93000000u,
+        0xd8800000u, 0x25400000u, 0x59e00000u, 0xe6d00000u, 0x78080000u, 0xb40c0000u, 0x82020000u, 0xc3050000u,
+        0x208f8000u, 0x51474000u, 0xfbea2000u, 0x75d93000u, 0xa0858800u, 0x914e5400u, 0xdbe79e00u, 0x25db6d00u,
+        0x58800080u, 0xe54000c0u, 0x79e00020u, 0xb6d00050u, 0x800800f8u, 0xc00c0074u, 0x200200a2u, 0x50050093u
+);
+
+uint samplerSampleIndex = 0u;
+uint samplerSeed = 0u;
+uint samplerVertexIdx = 0u;
+uint samplerDimension = 0u;
+uint samplerDimensionEnd = 0u;
+
+uint hashUint(uint x) {
+    x ^= x >> 16u;
+    x *= 0x7feb352du;
+    x ^= x >> 15u;
+    x *= 0x846ca68bu;
+    x ^= x >> 16u;
+    return x;
+}
+
+uint sobol4D(uint index, uint dimension) {
+    uint x = 0u;
+    for (uint bit = 0u; index != 0u; bit++, index >>= 1u) {
+        if ((index & 1u) != 0u) {
+            x ^= SOBOL_DIRECTIONS[dimension * 32u + bit];
+        }
+    }
+    return x;
+}
+
+uint laineKarrasPermutation(uint x, uint seed) {
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+uint nestedUniformScramble(uint x, uint seed) {
+    return bitfieldReverse(laineKarrasPermutation(bitfieldReverse(x), seed));
+}
+
+/// Samples the passed dimension of the padded sequence; dimension / 4 selects the independently scrambled group.
+float sampleLowDiscrepancy(uint dimension) {
+    uint groupSeed = hashUint(samplerSeed ^ hashUint(dimension / 4u));
+    uint index = nestedUniformScramble(samplerSampleIndex, groupSeed);
+    uint x = sobol4D(index, dimension % 4u);
+    x = nestedUniformScramble(x, hashUint(groupSeed ^ (dimension + 1u)));
+    return float(x >> 8u) * (1.0 / 16777216.0);
+}
+
+uint mortonEncode6Bit(uvec2 p) {
+    uint code = 0u;
+    for (uint i = 0u; i < 6u; i++) {
+        code |= ((p.x >> i) & 1u) << (2u * i);
+        code |= ((p.y >> i) & 1u) << (2u * i + 1u);
     }
+    return code;
 }
 
+void initializeSampler(uint sampleIdx, uvec2 pixel, uint seedOffset) {
+#ifdef USE_SAMPLER_SOBOL_BLUE_NOISE
+    // The hierarchical index scrambling in sampleLowDiscrepancy also shuffles the Morton codes hierarchically.
+    // Only 20 bits of the sample number fit next to the Morton code. The higher bits select an independent
+    // scrambling seed, so every block of 2^20 samples is a new randomized sequence instead of repeating the last one.
+    samplerSampleIndex = (sampleIdx << 12u) | mortonEncode6Bit(pixel & uvec2(63u));
+    samplerSeed = hashUint(hashUint((pixel.x >> 6u) ^ hashUint(pixel.y >> 6u)) + seedOffset);
+    samplerSeed = hashUint(samplerSeed ^ hashUint(sampleIdx >> 20u));
+#else
+    samplerSampleIndex = sampleIdx;
+    samplerSeed = hashUint(hashUint(pixel.x ^ hashUint(pixel.y)) + seedOffset);
+#endif
+    samplerVertexIdx = 0u;
+    samplerDimension = 0u;
+    samplerDimensionEnd = SAMPLER_NUM_DIMENSIONS_PER_VERTEX;
+}
+
+/// Switches to the dimensions of the next path vertex. Needs to be called at each scattering event.
+void samplerNextVertex() {
+    samplerVertexIdx++;
+    if (samplerVertexIdx < SAMPLER_MAX_NUM_VERTICES) {
+        samplerDimension = samplerVertexIdx * SAMPLER_NUM_DIMENSIONS_PER_VERTEX;
+        samplerDimensionEnd = samplerDimension + SAMPLER_NUM_DIMENSIONS_PER_VERTEX;
+    } else {
+        samplerDimension = samplerDimensionEnd;
+    }
+}
+
+float random() {
+    if (samplerDimension < samplerDimensionEnd) {
+        return sampleLowDiscrepancy(samplerDimension++);
+    }
+    return randomWhiteNoise();
+}
+
+#else
+
+void initializeSampler(uint sampleIdx, uvec2 pixel, uint seedOffset) {}
+void samplerNextVertex() {}
+
+float random() {
+    return randomWhiteNoise();
+}
+
+#endif
+
 void createOrthonormalBasis(vec3 D, out vec3 B, out vec3 T) {
     vec3 other = abs(D.z) >= 0.9999 ? vec3(1, 0, 0) : vec3(0, 0, 1);
     B = normalize(cross(other, D));
@@ -157,101 +304,41 @@ vec2 worldToOctahedralUV(vec3 dir) {
     return uv * .5 + .5;
 }
 
+/**
+ * Importance samples the environment map using the alias table over the texels of the equal-area octahedral mapping.
+ * As all texels cover the same solid angle, the PDF of a direction is the texel probability times
+ * (number of texels) / (4 pi).
+ */
 vec3 importanceSampleSkybox(out float pdf) {
-    vec2 rnd = vec2(random(), random());
-    ivec2 pos = ivec2(0,0);
-
-    int maxMip = textureQueryLevels(environmentMapOctahedralTexture);
-    int minMip = 0;
-
-    pdf = 0.25 / PI;
-
-    for (int mip = maxMip - 1; mip >= minMip; mip--) {
-        pos *= 2;
-        pdf *= 4;
-        float ul = texelFetch(environmentMapOctahedralTexture, pos + ivec2(0,0), mip).r + .001;
-        float ur = texelFetch(environmentMapOctahedralTexture, pos + ivec2(1,0), mip).r + .001;
-        float dl = texelFetch(environmentMapOctahedralTexture, pos + ivec2(0,1), mip).r + .001;
-        float dr = texelFetch(environmentMapOctahedralTexture, pos + ivec2(1,1), mip).r + .001;
-
-        float l = ul + dl;
-        float r = ur + dr;
-        float total = l + r;
-
-        float hSplit = l / total;
-        float vSplit;
-        if (rnd.x < hSplit) {
-            rnd.x = rnd.x / hSplit;
-            vSplit = ul / l;
-            pdf *= hSplit;
-        } else{
-            pos.x += 1;
-            rnd.x = (rnd.x - hSplit) / (1. - hSplit);
-            vSplit = ur / r;
-            pdf *= (1. - hSplit);
-        }
-
-        if (rnd.y < vSplit) {
-            rnd.y = rnd.y / vSplit;
-            pdf *= vSplit;
-        } else {
-            pos.y += 1;
-            rnd.y = (rnd.y - vSplit) / (1-vSplit);
-            pdf *= (1. - vSplit);
-        }
-
+    const uint tableSize = parameters.environmentMapAliasTableSize;
+    const uint numEntries = tableSize * tableSize;
+    uint entryIdx = min(uint(random() * float(numEntries)), numEntries - 1u);
+    float rndAlias = random();
+    vec2 rnd = vec2(0.0, random());
+
+    EnvironmentMapAliasTableEntry entry = environmentMapAliasTable[entryIdx];
+    uint texelIdx;
+    if (rndAlias < entry.probability) {
+        texelIdx = entryIdx;
+        rnd.x = rndAlias / entry.probability;
+        pdf = entry.pdf;
+    } else {
+        texelIdx = entry.alias;
+        rnd.x = (rndAlias - entry.probability) / (1.0 - entry.probability);
+        pdf = entry.aliasPdf;
     }
-    vec2 uv = (vec2(pos) + rnd) / vec2(1 << (maxMip - minMip));
-    //uv = vec2(random(), random());
-    //pdf = .25 / PI;
+    pdf *= float(numEntries) / (4.0 * PI);
+
+    uvec2 pos = uvec2(texelIdx % tableSize, texelIdx / tableSize);
+    vec2 uv = (vec2(pos) + clamp(rnd, vec2(0.0), vec2(0.99999))) / float(tableSize);
     return octahedralUVToWorld(uv);
 }
 
 float evaluateSkyboxPDF(vec3 sampledDir) {
+    const int tableSize = int(parameters.environmentMapAliasTableSize);
     vec2 uv = worldToOctahedralUV(sampledDir);
-    ivec2 pos = ivec2(0,0);
-
-    float pdf = 0.25 / PI;
-
-    int maxMip = textureQueryLevels(environmentMapOctahedralTexture);
-    int minMip = 0;
-
-    for (int mip = maxMip - 1; mip >= minMip; mip--) {
-        pos *= 2;
-        pdf *= 4;
-        float ul = texelFetch(environmentMapOctahedralTexture, pos + ivec2(0,0), mip).r + .001;
-        float ur = texelFetch(environmentMapOctahedralTexture, pos + ivec2(1,0), mip).r + .001;
-        float dl = texelFetch(environmentMapOctahedralTexture, pos + ivec2(0,1), mip).r + .001;
-        float dr = texelFetch(environmentMapOctahedralTexture, pos + ivec2(1,1), mip).r + .001;
-
-        float l = ul + dl;
-        float r = ur + dr;
-        float total = l + r;
-
-        float hSplit = l / total;
-        float vSplit;
-        if (uv.x < .5) {
-            vSplit = ul / l;
-            pdf *= hSplit;
-            uv.x *= 2;
-        } else{
-            pos.x += 1;
-            vSplit = ur / r;
-            pdf *= (1. - hSplit);
-            uv.x = uv.x * 2. - 1.;
-        }
-
-        if (uv.y < .5) {
-            pdf *= vSplit;
-            uv.y = uv.y * 2.;
-        } else {
-            pos.y += 1;
-            pdf *= (1. - vSplit);
-            uv.y = uv.y * 2. - 1.;
-        }
-
-    }
-    return pdf;
+    ivec2 pos = clamp(ivec2(uv * float(tableSize)), ivec2(0), ivec2(tableSize - 1));
+    return environmentMapAliasTable[pos.x + pos.y * tableSize].pdf * float(tableSize * tableSize) / (4.0 * PI);
 }
 
 #else
@@ -294,19 +381,12 @@ vec3 sampleSkybox(in vec3 dir) {
     // Make sure there is no infinity in the skybox
     textureColor = min(textureColor , vec3(100000, 100000, 100000));
 
-#ifdef ENV_MAP_IMAGE_USES_LINEAR_RGB
-#ifdef USE_LINEAR_RGB
-    return parameters.environmentMapIntensityFactor * textureColor;
-#else
-    return parameters.environmentMapIntensityFactor * linearRGBTosRGB(textureColor);
-#endif
-#else // !ENV_MAP_IMAGE_USES_LINEAR_RGB
-#ifdef USE_LINEAR_RGB
-    return parameters.environmentMapIntensityFactor * sRGBToLinearRGB(textureColor);
-#else
+    if (parameters.envMapImageUsesLinearRgb != 0 && parameters.useLinearRGB == 0) {
+        textureColor = linearRGBTosRGB(textureColor);
+    } else if (parameters.envMapImageUsesLinearRgb == 0 && parameters.useLinearRGB != 0) {
+        textureColor = sRGBToLinearRGB(textureColor);
+    }
     return parameters.environmentMapIntensityFactor * textureColor;
-#endif
-#endif
 }
 vec3 sampleLight(in vec3 dir) {
     return vec3(0.0);
@@ -337,19 +417,39 @@ vec3 sampleSkybox(in vec3 dir) {
     col = mix(col, BG_COLORS[3], vec3(smoothstep(BG_DISTS[2], BG_DISTS[3], L.y)));
     col = mix(col, BG_COLORS[4], vec3(smoothstep(BG_DISTS[3], BG_DISTS[4], L.y)));
 
-#ifdef USE_LINEAR_RGB
-    return sRGBToLinearRGB(col);
-#else
+    if (parameters.useLinearRGB != 0) {
+        col = sRGBToLinearRGB(col);
+    }
     return col;
-#endif
 }
 /*
  * See, e.g.: https://www.cs.princeton.edu/courses/archive/fall16/cos526/papers/importance.pdf
  */
+const float SUN_LOBE_EXPONENT = 10.0;
 vec3 sampleLight(in vec3 dir) {
-    int N = 10;
-    float phongNorm = (N + 1) / (2 * 3.14159);
-    return parameters.sunIntensity * pow(max(0, dot(dir, parameters.sunDirection)), N) * phongNorm;
+    float phongNorm = (SUN_LOBE_EXPONENT + 1) / (2 * 3.14159);
+    return parameters.sunIntensity * pow(max(0, dot(dir, parameters.sunDirection)), SUN_LOBE_EXPONENT) * phongNorm;
+}
+
+/// PDF of @see importanceSampleSun, i.e., the normalized Phong lobe around the sun direction.
+float evaluateSunPDF(vec3 sampledDir) {
+    float cosTheta = max(dot(sampledDir, normalize(parameters.sunDirection)), 0.0);
+    return (SUN_LOBE_EXPONENT + 1.0) / TWO_PI * pow(cosTheta, SUN_LOBE_EXPONENT);
+}
+
+/// Samples a direction proportional to the Phong lobe of the sun used by @see sampleLight.
+vec3 importanceSampleSun(out float pdf) {
+    // The lower bound avoids a zero PDF for directions perpendicular to the sun.
+    float cosTheta = pow(max(random(), 1e-6), 1.0 / (SUN_LOBE_EXPONENT + 1.0));
+    float sinTheta = sqrt(max(0.0, 1.0 - cosTheta * cosTheta));
+    float phi = random() * TWO_PI;
+
+    vec3 sunDirection = normalize(parameters.sunDirection);
+    vec3 t0, t1;
+    createOrthonormalBasis(sunDirection, t0, t1);
+    vec3 dir = sinTheta * cos(phi) * t0 + sinTheta * sin(phi) * t1 + cosTheta * sunDirection;
+    pdf = evaluateSunPDF(dir);
+    return dir;
 }
 #endif
 
@@ -372,8 +472,62 @@ pnanovdb_readaccessor_t createEmissionAccessor() {
     pnanovdb_readaccessor_init(accessor, root);
     return accessor;
 }
+/**
+ * Fetches the 2x2x2 voxel stencil with the lower corner ijk. The values are stored in the order x + 2y + 4z.
+ * If all eight voxels lie in the same 8^3 leaf node, only the first voxel is looked up using the accessor and the
+ * remaining values are read using offsets relative to its address in the leaf value table (which stores the values in
+ * the order z + 8y + 64x, i.e., with a stride of 4 bytes per float).
+ */
+void fetchCloudStencil(inout pnanovdb_readaccessor_t accessor, in ivec3 ijk, out float f[8]) {
+    pnanovdb_buf_t buf = pnanovdb_buf_t(0);
+    pnanovdb_uint32_t level;
+    pnanovdb_address_t address000 = pnanovdb_readaccessor_get_value_address_and_level(
+            PNANOVDB_GRID_TYPE_FLOAT, buf, accessor, ijk, level);
+    if (level == 0u && all(lessThan(ijk & ivec3(7), ivec3(7)))) {
+        f[0] = pnanovdb_read_float(buf, address000);
+        f[1] = pnanovdb_read_float(buf, pnanovdb_address_offset(address000, 256u));
+        f[2] = pnanovdb_read_float(buf, pnanovdb_address_offset(address000, 32u));
+        f[3] = pnanovdb_read_float(buf, pnanovdb_address_offset(address000, 288u));
+        f[4] = pnanovdb_read_float(buf, pnanovdb_address_offset(address000, 4u));
+        f[5] = pnanovdb_read_float(buf, pnanovdb_address_offset(address000, 260u));
+        f[6] = pnanovdb_read_float(buf, pnanovdb_address_offset(address000, 36u));
+        f[7] = pnanovdb_read_float(buf, pnanovdb_address_offset(address000, 292u));
+        return;
+    }
+
+    // The stencil straddles a leaf boundary or lies in a tile of an internal node.
+    f[0] = pnanovdb_read_float(buf, address000);
+    for (int i = 1; i < 8; i++) {
+        ivec3 offset = ivec3(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+        pnanovdb_address_t address = pnanovdb_readaccessor_get_value_address(
+                PNANOVDB_GRID_TYPE_FLOAT, buf, accessor, ijk + offset);
+        f[i] = pnanovdb_read_float(buf, address);
+    }
+}
+
+/**
+ * Fused trilinear value and gradient lookup sharing one stencil fetch. The gradient is returned with respect to
+ * index space coordinates.
+ */
+float sampleCloudRawAndGradient(inout pnanovdb_readaccessor_t accessor, in vec3 pos, out vec3 gradient) {
+    pnanovdb_buf_t buf = pnanovdb_buf_t(0);
+    pnanovdb_grid_handle_t gridHandle = pnanovdb_grid_handle_t(pnanovdb_address_null());
+    vec3 posIndex = pnanovdb_grid_world_to_indexf(buf, gridHandle, pos) - vec3(0.5);
+    ivec3 posIndexInt = ivec3(floor(posIndex));
+    vec3 t = posIndex - vec3(posIndexInt);
+
+    float f[8];
+    fetchCloudStencil(accessor, posIndexInt, f);
+    gradient.x = mix(mix(f[1] - f[0], f[3] - f[2], t.y), mix(f[5] - f[4], f[7] - f[6], t.y), t.z);
+    gradient.y = mix(mix(f[2] - f[0], f[3] - f[1], t.x), mix(f[6] - f[4], f[7] - f[5], t.x), t.z);
+    gradient.z = mix(mix(f[4] - f[0], f[5] - f[1], t.x), mix(f[6] - f[2], f[7] - f[3], t.x), t.y);
+    float f0 = mix(mix(f[0], f[1], t.x), mix(f[2], f[3], t.x), t.y);
+    float f1 = mix(mix(f[4], f[5], t.x), mix(f[6], f[7], t.x), t.y);
+    return mix(f0, f1, t.z);
+}
+
 #if defined(GRID_INTERPOLATION_NEAREST)
-float sampleCloudRaw(pnanovdb_readaccessor_t accessor, in vec3 pos) {
+float sampleCloudRaw(inout pnanovdb_readaccessor_t accessor, in vec3 pos) {
 
     pnanovdb_buf_t buf = pnanovdb_buf_t(0);
     pnanovdb_grid_handle_t gridHandle = pnanovdb_grid_handle_t(pnanovdb_address_null());
@@ -384,7 +538,7 @@ float sampleCloudRaw(pnanovdb_readaccessor_t accessor, in vec3 pos) {
     return pnanovdb_read_float(buf, address);
 }
 #elif defined(GRID_INTERPOLATION_STOCHASTIC)
-float sampleCloudRaw(pnanovdb_readaccessor_t accessor, in vec3 pos) {
+float sampleCloudRaw(inout pnanovdb_readaccessor_t accessor, in vec3 pos) {
 
     pnanovdb_buf_t buf = pnanovdb_buf_t(0);
     pnanovdb_grid_handle_t gridHandle = pnanovdb_grid_handle_t(pnanovdb_address_null());
@@ -395,61 +549,64 @@ float sampleCloudRaw(pnanovdb_readaccessor_t accessor, in vec3 pos) {
     return pnanovdb_read_float(buf, address);
 }
 #elif defined(GRID_INTERPOLATION_TRILINEAR)
-float sampleCloudRaw(pnanovdb_readaccessor_t accessor, in vec3 pos) {
-
+float sampleCloudRaw(inout pnanovdb_readaccessor_t accessor, in vec3 pos) {
     pnanovdb_buf_t buf = pnanovdb_buf_t(0);
     pnanovdb_grid_handle_t gridHandle = pnanovdb_grid_handle_t(pnanovdb_address_null());
     vec3 posIndex = pnanovdb_grid_world_to_indexf(buf, gridHandle, pos) - vec3(0.5);
     ivec3 posIndexInt = ivec3(floor(posIndex));
     vec3 posIndexFrac = posIndex - vec3(posIndexInt);
 
-    pnanovdb_address_t address000 = pnanovdb_readaccessor_get_value_address(
-            PNANOVDB_GRID_TYPE_FLOAT, buf, accessor, posIndexInt + ivec3(0, 0, 0));
-    float f000 = pnanovdb_read_float(buf, address000);
-    pnanovdb_address_t address100 = pnanovdb_readaccessor_get_value_address(
-            PNANOVDB_GRID_TYPE_FLOAT, buf, accessor, posIndexInt + ivec3(1, 0, 0));
-    float f100 = pnanovdb_read_float(buf, address100);
-    float f00 = mix(f000, f100, posIndexFrac.x);
-
-    pnanovdb_address_t address010 = pnanovdb_readaccessor_get_value_address(
-            PNANOVDB_GRID_TYPE_FLOAT, buf, accessor, posIndexInt + ivec3(0, 1, 0));
-    float f010 = pnanovdb_read_float(buf, address010);
-    pnanovdb_address_t address110 = pnanovdb_readaccessor_get_value_address(
-            PNANOVDB_GRID_TYPE_FLOAT, buf, accessor, posIndexInt + ivec3(1, 1, 0));
-    float f110 = pnanovdb_read_float(buf, address110);
-    float f10 = mix(f010, f110, posIndexFrac.x);
-
+    float f[8];
+    fetchCloudStencil(accessor, posIndexInt, f);
+    float f00 = mix(f[0], f[1], posIndexFrac.x);
+    float f10 = mix(f[2], f[3], posIndexFrac.x);
+    float f01 = mix(f[4], f[5], posIndexFrac.x);
+    float f11 = mix(f[6], f[7], posIndexFrac.x);
     float f0 = mix(f00, f10, posIndexFrac.y);
-
-    pnanovdb_address_t address001 = pnanovdb_readaccessor_get_value_address(
-            PNANOVDB_GRID_TYPE_FLOAT, buf, accessor, posIndexInt + ivec3(0, 0, 1));
-    float f001 = pnanovdb_read_float(buf, address001);
-    pnanovdb_address_t address101 = pnanovdb_readaccessor_get_value_address(
-            PNANOVDB_GRID_TYPE_FLOAT, buf, accessor, posIndexInt + ivec3(1, 0, 1));
-    float f101 = pnanovdb_read_float(buf, address101);
-    float f01 = mix(f001, f101, posIndexFrac.x);
-
-    pnanovdb_address_t address011 = pnanovdb_readaccessor_get_value_address(
-            PNANOVDB_GRID_TYPE_FLOAT, buf, accessor, posIndexInt + ivec3(0, 1, 1));
-    float f011 = pnanovdb_read_float(buf, address011);
-    pnanovdb_address_t address111 = pnanovdb_readaccessor_get_value_address(
-            PNANOVDB_GRID_TYPE_FLOAT, buf, accessor, posIndexInt + ivec3(1, 1, 1));
-    float f111 = pnanovdb_read_float(buf, address111);
-    float f11 = mix(f011, f111, posIndexFrac.x);
-
     float f1 = mix(f01, f11, posIndexFrac.y);
-
     return mix(f0, f1, posIndexFrac.z);
 }
 #endif
 #else
+#ifdef USE_BRICK_MAP
+const uint BRICK_MAP_EMPTY_BRICK = 0xFFFFFFFFu;
+const int BRICK_MAP_BRICK_SIZE = 8;
+
+/**
+ * Looks up the brick containing the passed normalized grid coordinate in the indirection texture and samples the
+ * brick atlas. Brick (i, j, k) covers the voxels 8*i-1 to 8*i+7, so the hardware filter never leaves the brick.
+ * The result is identical to sampling the dense grid texture with a zero border.
+ */
+float sampleGridImage(in vec3 coord) {
+    // Voxel space shifted by one voxel due to the apron, i.e., brickPos = coord * gridResolution - 0.5 + 1.
+    vec3 brickPos = coord * vec3(parameters.gridResolution) + vec3(0.5);
+    ivec3 brickIdx = ivec3(floor(brickPos / float(BRICK_MAP_BRICK_SIZE)));
+    if (any(lessThan(brickIdx, ivec3(0))) || any(greaterThanEqual(brickIdx, textureSize(brickIndirectionImage, 0)))) {
+        return 0.0;
+    }
+    uint brickEntry = texelFetch(brickIndirectionImage, brickIdx, 0).x;
+    if (brickEntry == BRICK_MAP_EMPTY_BRICK) {
+        return 0.0;
+    }
+    ivec3 atlasBrickIdx = ivec3(brickEntry & 0x3FFu, (brickEntry >> 10u) & 0x3FFu, brickEntry >> 20u);
+    vec3 atlasPos =
+            vec3(atlasBrickIdx * (BRICK_MAP_BRICK_SIZE + 1)) + brickPos - vec3(brickIdx * BRICK_MAP_BRICK_SIZE)
+            + vec3(0.5);
+    return textureLod(gridImage, atlasPos / vec3(textureSize(gridImage, 0)), 0.0).x;
+}
+#else
+float sampleGridImage(in vec3 coord) {
+    return texture(gridImage, coord).x;
+}
+#endif
+
 float sampleCloudRaw(in vec3 coord) {
 
 #if defined(GRID_INTERPOLATION_STOCHASTIC)
-    ivec3 dim = textureSize(gridImage, 0);
+    ivec3 dim = parameters.gridResolution;
     coord += vec3(random() - 0.5, random() - 0.5, random() - 0.5) / dim;
 #endif
-    return texture(gridImage, coord).x;
+    return sampleGridImage(coord);
 }
 #endif
 
@@ -466,9 +623,9 @@ vec3 sampleEmission(in vec3 pos){
 
     // transform world pos to density grid pos
     vec3 coord = (pos - parameters.emissionBoxMin) / (parameters.emissionBoxMax - parameters.emissionBoxMin);
-#if defined(FLIP_YZ)
-    coord = coord.xzy;
-#endif
+    if (parameters.flipYZ != 0) {
+        coord = coord.xzy;
+    }
     coord = coord * (parameters.gridMax - parameters.gridMin) + parameters.gridMin;
 
     float t = sampleEmissionRaw(coord);
@@ -483,14 +640,14 @@ vec3 sampleEmission(in vec3 pos){
 #ifdef USE_TRANSFER_FUNCTION
 vec4 sampleCloudColorAndDensity(
 #ifdef USE_NANOVDB
-        pnanovdb_readaccessor_t accessor,
+        inout pnanovdb_readaccessor_t accessor,
 #endif
         in vec3 pos) {
     // Idea: Returns (color.rgb, density).
     vec3 coord = (pos - parameters.boxMin) / (parameters.boxMax - parameters.boxMin);
-#if defined(FLIP_YZ)
-    coord = coord.xzy;
-#endif
+    if (parameters.flipYZ != 0) {
+        coord = coord.xzy;
+    }
     coord = coord * (parameters.gridMax - parameters.gridMin) + parameters.gridMin;
     float densityRaw = sampleCloudRaw(
 #ifdef USE_NANOVDB
@@ -503,14 +660,14 @@ vec4 sampleCloudColorAndDensity(
 
 float sampleCloud(
 #ifdef USE_NANOVDB
-        pnanovdb_readaccessor_t accessor,
+        inout pnanovdb_readaccessor_t accessor,
 #endif
         in vec3 pos) {
     // Idea: Returns (color.rgb, density).
     vec3 coord = (pos - parameters.boxMin) / (parameters.boxMax - parameters.boxMin);
-#if defined(FLIP_YZ)
-    coord = coord.xzy;
-#endif
+    if (parameters.flipYZ != 0) {
+        coord = coord.xzy;
+    }
     coord = coord * (parameters.gridMax - parameters.gridMin) + parameters.gridMin;
     float densityRaw = sampleCloudRaw(
 #ifdef USE_NANOVDB
@@ -523,14 +680,14 @@ float sampleCloud(
 #else
 float sampleCloud(
 #ifdef USE_NANOVDB
-        pnanovdb_readaccessor_t accessor,
+        inout pnanovdb_readaccessor_t accessor,
 #endif
         in vec3 pos) {
     // transform world pos to density grid pos
     vec3 coord = (pos - parameters.boxMin) / (parameters.boxMax - parameters.boxMin);
-#if defined(FLIP_YZ)
-    coord = coord.xzy;
-#endif
+    if (parameters.flipYZ != 0) {
+        coord = coord.xzy;
+    }
     coord = coord * (parameters.gridMax - parameters.gridMin) + parameters.gridMin;
 
     return sampleCloudRaw(
@@ -544,19 +701,35 @@ float sampleCloud(
 
 vec3 getCloudFiniteDifference(in vec3 pos) {
 #ifdef USE_NANOVDB
-    return vec3(0);
+    vec3 coord = (pos - parameters.boxMin) / (parameters.boxMax - parameters.boxMin);
+    if (parameters.flipYZ != 0) {
+        coord = coord.xzy;
+    }
+    coord = coord * (parameters.gridMax - parameters.gridMin) + parameters.gridMin;
+
+    pnanovdb_buf_t buf = pnanovdb_buf_t(0);
+    pnanovdb_readaccessor_t accessor = createAccessor();
+    vec3 dim = vec3(
+            pnanovdb_root_get_bbox_max(buf, accessor.root) - pnanovdb_root_get_bbox_min(buf, accessor.root) + ivec3(1));
+    vec3 gradient;
+    sampleCloudRawAndGradient(accessor, coord, gradient);
+    // Same scale as the central differences of the dense grid below, which span two voxels.
+    vec3 dFdpos = -2.0 * gradient / dim * 100;
+    if (parameters.flipYZ != 0) {
+        dFdpos = dFdpos.xzy;
+    }
+    return dFdpos;
 #else
 
     vec3 coord = (pos - parameters.boxMin) / (parameters.boxMax - parameters.boxMin);
-    ivec3 dim = textureSize(gridImage, 0);
+    ivec3 dim = parameters.gridResolution;
 #if defined(GRID_INTERPOLATION_STOCHASTIC)
     coord += vec3(random() - 0.5, random() - 0.5, random() - 0.5) / dim;
 #endif
-    float density = texture(gridImage, coord).x;
     vec3 dFdpos = vec3(
-        texture(gridImage, coord - vec3(1, 0, 0) / dim).x - texture(gridImage, coord + vec3(1, 0, 0) / dim).x,
-        texture(gridImage, coord - vec3(0, 1, 0) / dim).x - texture(gridImage, coord + vec3(0, 1, 0) / dim).x,
-        texture(gridImage, coord - vec3(0, 0, 1) / dim).x - texture(gridImage, coord + vec3(0, 0, 1) / dim).x
+        sampleGridImage(coord - vec3(1, 0, 0) / dim) - sampleGridImage(coord + vec3(1, 0, 0) / dim),
+        sampleGridImage(coord - vec3(0, 1, 0) / dim) - sampleGridImage(coord + vec3(0, 1, 0) / dim),
+        sampleGridImage(coord - vec3(0, 0, 1) / dim) - sampleGridImage(coord + vec3(0, 0, 1) / dim)
     ) / dim * 100;
     return dFdpos;
 #endif
@@ -598,3 +771,7 @@ float maxComponent(vec3 v) {
 float avgComponent(vec3 v) {
     return (v.x + v.y + v.z) / 3.0;
 }
+
+float luminance(vec3 color) {
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
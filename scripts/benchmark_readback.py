@@ -0,0 +1,95 @@
+#!/usr/bin/python3
+
+# BSD 2-Clause License
+# 
+# Copyright (c) 2022, Christoph Neuhauser
+# All rights reserved.
+# 
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+# 
+# 1. Redistributions of source code must retain the above copyright notice, this
+#    list of conditions and the following disclaimer.
+# 
+# 2. Redistributions in binary form must reproduce the above copyright notice,
+#    this list of conditions and the following disclaimer in the documentation
+#    and/or other materials provided with the distribution.
+# 
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+# SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+# OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# Measures the frames per second of the PyTorch module when generating a sequence of CPU frames.
+# The synchronous loop (vpt.render_frame) is compared with the pipelined loop using the readback ring
+# (vpt.submit_render_frame/vpt.collect_render_frame), where frame N is repacked on the host while frame N+1 renders.
+# In both loops, the host additionally consumes every frame (e.g., for writing it to a data set), which is simulated
+# by a sum over the image.
+#
+# Usage: python3 benchmark_readback.py <path/to/libvpt.so> <cloud.xyz> [width] [height] [num_frames] [spp]
+
+import sys
+import time
+import torch
+
+
+def consume_frame(frame):
+    return float(frame.sum())
+
+
+def benchmark_sync(vpt, input_tensor, num_frames, spp):
+    start = time.perf_counter()
+    for i in range(num_frames):
+        vpt.set_seed_offset(i)
+        consume_frame(vpt.render_frame(input_tensor, spp))
+    return num_frames / (time.perf_counter() - start)
+
+
+def benchmark_async(vpt, input_tensor, num_frames, spp):
+    start = time.perf_counter()
+    vpt.set_seed_offset(0)
+    handle = vpt.submit_render_frame(input_tensor, spp)
+    for i in range(1, num_frames + 1):
+        next_handle = None
+        if i < num_frames:
+            vpt.set_seed_offset(i)
+            next_handle = vpt.submit_render_frame(input_tensor, spp)
+        consume_frame(vpt.collect_render_frame(handle))
+        handle = next_handle
+    return num_frames / (time.perf_counter() - start)
+
+
+if __name__ == '__main__':
+    if len(sys.argv) < 3:
+        print('Usage: python3 benchmark_readback.py <path/to/libvpt.so> <cloud.xyz> [width] [height] '
+              '[num_frames] [spp]')
+        sys.exit(1)
+    torch.ops.load_library(sys.argv[1])
+    cloud_filename = sys.argv[2]
+    width = int(sys.argv[3]) if len(sys.argv) > 3 else 1024
+    height = int(sys.argv[4]) if len(sys.argv) > 4 else 1024
+    num_frames = int(sys.argv[5]) if len(sys.argv) > 5 else 64
+    spp = int(sys.argv[6]) if len(sys.argv) > 6 else 4
+
+    vpt = torch.ops.vpt
+    vpt.initialize()
+    vpt.load_cloud_file(cloud_filename)
+    input_tensor = torch.zeros(3, height, width, dtype=torch.float32)
+
+    # Warm-up (shader compilation, allocation of the staging buffers).
+    vpt.render_frame(input_tensor, spp)
+
+    fps_sync = benchmark_sync(vpt, input_tensor, num_frames, spp)
+    fps_async = benchmark_async(vpt, input_tensor, num_frames, spp)
+    print(f'Resolution: {width}x{height}, frames: {num_frames}, spp: {spp}')
+    print(f'Synchronous readback: {fps_sync:.2f} frames/s')
+    print(f'Pipelined readback:   {fps_async:.2f} frames/s')
+    print(f'Speedup: {fps_async / fps_sync:.2f}x')
+
+    vpt.cleanup()
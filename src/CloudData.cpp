@@ -26,6 +26,9 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cmath>
+#include <optional>
+
 #include <boost/algorithm/string/case_conv.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/trim.hpp>
@@ -72,6 +75,7 @@ void CloudData::setDensityField(uint32_t _gridSizeX, uint32_t _gridSizeY, uint32
         densityField = nullptr;
     }
     sparseGridHandle = {};
+    brickMap = {};
 
     gridSizeX = _gridSizeX;
     gridSizeY = _gridSizeY;
@@ -86,6 +90,7 @@ void CloudData::setDensityField(uint32_t _gridSizeX, uint32_t _gridSizeY, uint32
 
 void CloudData::setNanoVdbGridHandle(nanovdb::GridHandle<nanovdb::HostBuffer>&& handle) {
     sparseGridHandle = std::move(handle);
+    brickMap = {};
     computeSparseGridMetadata();
 }
 
@@ -128,6 +133,7 @@ bool CloudData::loadFromFile(const std::string& filename) {
         densityField = nullptr;
     }
     sparseGridHandle = {};
+    brickMap = {};
 
     if (sgl::FileUtils::get()->hasExtension(filename.c_str(), ".xyz")) {
         return loadFromXyzFile(filename);
@@ -588,3 +594,156 @@ void CloudData::getSparseDensityField(uint8_t*& data, uint64_t& size) {
     data = buffer.data();
     size = buffer.size();
 }
+
+const BrickMapPtr& CloudData::getBrickMap() {
+    if (brickMap) {
+        return brickMap;
+    }
+
+    const nanovdb::FloatGrid* grid = nullptr;
+    nanovdb::Coord minGridVal(0);
+    if (!hasDenseData()) {
+        if (sparseGridHandle.empty()) {
+            sgl::Logfile::get()->throwError(
+                    "Fatal error in CloudData::getBrickMap: Neither a dense nor a sparse field are loaded!");
+            return brickMap;
+        }
+        grid = sparseGridHandle.grid<float>();
+        if (!grid) {
+            sgl::Logfile::get()->throwError(
+                    "Fatal error in CloudData::getBrickMap: The sparse grid data from \"" + gridFilename
+                    + "\" does not contain floating point data!");
+            return brickMap;
+        }
+        minGridVal = grid->indexBBox().min();
+    }
+
+    // Reads voxels directly from the dense field or the NanoVDB tree. Voxels outside of the grid are zero.
+    auto fetchVoxel = [this, &minGridVal](
+            std::optional<nanovdb::DefaultReadAccessor<float>>& accessor, int x, int y, int z) -> float {
+        if (x < 0 || y < 0 || z < 0 || x >= int(gridSizeX) || y >= int(gridSizeY) || z >= int(gridSizeZ)) {
+            return 0.0f;
+        }
+        if (densityField) {
+            return densityField[x + (y + z * gridSizeY) * gridSizeX];
+        }
+        return accessor->getValue(nanovdb::Coord(minGridVal[0] + x, minGridVal[1] + y, minGridVal[2] + z));
+    };
+
+    auto newBrickMap = std::make_shared<BrickMap>();
+    auto numBricksX = int(gridSizeX / BrickMap::BRICK_SIZE + 1);
+    auto numBricksY = int(gridSizeY / BrickMap::BRICK_SIZE + 1);
+    auto numBricksZ = int(gridSizeZ / BrickMap::BRICK_SIZE + 1);
+    newBrickMap->indirectionSizeX = uint32_t(numBricksX);
+    newBrickMap->indirectionSizeY = uint32_t(numBricksY);
+    newBrickMap->indirectionSizeZ = uint32_t(numBricksZ);
+    size_t numBricks = size_t(numBricksX) * size_t(numBricksY) * size_t(numBricksZ);
+    newBrickMap->indirectionData.resize(numBricks, BrickMap::EMPTY_BRICK);
+
+    // Pass 1: Find all bricks with at least one non-zero voxel (including the apron).
+    std::vector<uint8_t> brickOccupancy(numBricks, 0);
+#if _OPENMP >= 201107
+    #pragma omp parallel for default(none) shared(grid, fetchVoxel, brickOccupancy, numBricksX, numBricksY, numBricksZ)
+#endif
+    for (int bz = 0; bz < numBricksZ; bz++) {
+        std::optional<nanovdb::DefaultReadAccessor<float>> accessor;
+        if (grid) {
+            accessor.emplace(grid->getAccessor());
+        }
+        for (int by = 0; by < numBricksY; by++) {
+            for (int bx = 0; bx < numBricksX; bx++) {
+                int offsetX = bx * int(BrickMap::BRICK_SIZE) - 1;
+                int offsetY = by * int(BrickMap::BRICK_SIZE) - 1;
+                int offsetZ = bz * int(BrickMap::BRICK_SIZE) - 1;
+                bool isOccupied = false;
+                for (int lz = 0; lz < int(BrickMap::BRICK_SIZE_WITH_APRON) && !isOccupied; lz++) {
+                    for (int ly = 0; ly < int(BrickMap::BRICK_SIZE_WITH_APRON) && !isOccupied; ly++) {
+                        for (int lx = 0; lx < int(BrickMap::BRICK_SIZE_WITH_APRON) && !isOccupied; lx++) {
+                            isOccupied = fetchVoxel(accessor, offsetX + lx, offsetY + ly, offsetZ + lz) != 0.0f;
+                        }
+                    }
+                }
+                brickOccupancy[bx + (by + size_t(bz) * numBricksY) * numBricksX] = isOccupied ? 1 : 0;
+            }
+        }
+    }
+
+    std::vector<size_t> occupiedBricks;
+    for (size_t brickIdx = 0; brickIdx < numBricks; brickIdx++) {
+        if (brickOccupancy[brickIdx]) {
+            occupiedBricks.push_back(brickIdx);
+        }
+    }
+    newBrickMap->numOccupiedBricks = uint32_t(occupiedBricks.size());
+
+    // Use a roughly cubic atlas (with at least one brick, as empty textures are not allowed).
+    auto numAtlasBricks = std::max(uint32_t(occupiedBricks.size()), 1u);
+    auto atlasSide = uint32_t(std::ceil(std::cbrt(double(numAtlasBricks))));
+    newBrickMap->atlasSizeInBricksX = atlasSide;
+    newBrickMap->atlasSizeInBricksY = atlasSide;
+    newBrickMap->atlasSizeInBricksZ = (numAtlasBricks + atlasSide * atlasSide - 1) / (atlasSide * atlasSide);
+    if (newBrickMap->atlasSizeInBricksX > BrickMap::MAX_ATLAS_SIZE_IN_BRICKS
+            || newBrickMap->atlasSizeInBricksZ > BrickMap::MAX_ATLAS_SIZE_IN_BRICKS) {
+        sgl::Logfile::get()->throwError(
+                "Error in CloudData::getBrickMap: The number of occupied bricks exceeds the supported atlas size.");
+        return brickMap;
+    }
+    uint32_t atlasSizeX = newBrickMap->getAtlasSizeX();
+    uint32_t atlasSizeY = newBrickMap->getAtlasSizeY();
+    newBrickMap->atlasData.resize(
+            size_t(atlasSizeX) * size_t(atlasSizeY) * size_t(newBrickMap->getAtlasSizeZ()), 0.0f);
+
+    // Pass 2: Copy the voxels of the occupied bricks to the atlas.
+    auto numOccupiedBricks = int(occupiedBricks.size());
+    BrickMap* brickMapPtr = newBrickMap.get();
+#if _OPENMP >= 201107
+    #pragma omp parallel for default(none) shared(grid, fetchVoxel, occupiedBricks, numOccupiedBricks, brickMapPtr) \
+    shared(numBricksX, numBricksY, atlasSizeX, atlasSizeY)
+#endif
+    for (int atlasIdx = 0; atlasIdx < numOccupiedBricks; atlasIdx++) {
+        std::optional<nanovdb::DefaultReadAccessor<float>> accessor;
+        if (grid) {
+            accessor.emplace(grid->getAccessor());
+        }
+        size_t brickIdx = occupiedBricks.at(atlasIdx);
+        int bx = int(brickIdx % size_t(numBricksX));
+        int by = int((brickIdx / size_t(numBricksX)) % size_t(numBricksY));
+        int bz = int(brickIdx / (size_t(numBricksX) * size_t(numBricksY)));
+        uint32_t ax = uint32_t(atlasIdx) % brickMapPtr->atlasSizeInBricksX;
+        uint32_t ay = (uint32_t(atlasIdx) / brickMapPtr->atlasSizeInBricksX) % brickMapPtr->atlasSizeInBricksY;
+        uint32_t az = uint32_t(atlasIdx) / (brickMapPtr->atlasSizeInBricksX * brickMapPtr->atlasSizeInBricksY);
+        brickMapPtr->indirectionData.at(brickIdx) = ax | (ay << 10) | (az << 20);
+
+        for (uint32_t lz = 0; lz < BrickMap::BRICK_SIZE_WITH_APRON; lz++) {
+            for (uint32_t ly = 0; ly < BrickMap::BRICK_SIZE_WITH_APRON; ly++) {
+                for (uint32_t lx = 0; lx < BrickMap::BRICK_SIZE_WITH_APRON; lx++) {
+                    size_t writeX = ax * BrickMap::BRICK_SIZE_WITH_APRON + lx;
+                    size_t writeY = ay * BrickMap::BRICK_SIZE_WITH_APRON + ly;
+                    size_t writeZ = az * BrickMap::BRICK_SIZE_WITH_APRON + lz;
+                    brickMapPtr->atlasData[writeX + (writeY + writeZ * atlasSizeY) * atlasSizeX] = fetchVoxel(
+                            accessor,
+                            bx * int(BrickMap::BRICK_SIZE) - 1 + int(lx),
+                            by * int(BrickMap::BRICK_SIZE) - 1 + int(ly),
+                            bz * int(BrickMap::BRICK_SIZE) - 1 + int(lz));
+                }
+            }
+        }
+    }
+
+    brickMap = newBrickMap;
+    printBrickMapMetadata();
+    return brickMap;
+}
+
+void CloudData::printBrickMapMetadata() {
+    size_t numBricks =
+            size_t(brickMap->indirectionSizeX) * size_t(brickMap->indirectionSizeY) * size_t(brickMap->indirectionSizeZ);
+    double denseGridSizeMiB = double(gridSizeX) * double(gridSizeY) * double(gridSizeZ) * 4 / (1024.0 * 1024.0);
+    double brickMapSizeMiB =
+            double(brickMap->atlasData.size() + brickMap->indirectionData.size()) * 4 / (1024.0 * 1024.0);
+    sgl::Logfile::get()->writeInfo("Dense grid memory (MiB): " + std::to_string(denseGridSizeMiB));
+    sgl::Logfile::get()->writeInfo("Brick map memory (MiB): " + std::to_string(brickMapSizeMiB));
+    sgl::Logfile::get()->writeInfo("Compression ratio: " + std::to_string(denseGridSizeMiB / brickMapSizeMiB));
+    sgl::Logfile::get()->writeInfo(
+            "Occupied bricks: " + std::to_string(brickMap->numOccupiedBricks) + " of " + std::to_string(numBricks));
+}
@@ -30,6 +30,7 @@
 #define CLOUDRENDERING_CLOUDDATA_HPP
 
 #include <memory>
+#include <vector>
 #include <Math/Geometry/AABB3.hpp>
 #include <Graphics/Color.hpp>
 
@@ -39,6 +40,34 @@ namespace sgl {
     class TransferFunctionWindow;
 }
 
+/**
+ * Sparse representation of the density field storing only occupied bricks of 8^3 voxels.
+ * Each brick additionally stores a one voxel apron, so that hardware trilinear filtering never needs to access a
+ * neighboring brick. Brick (i, j, k) covers the voxels 8*i-1 to 8*i+7 (and analogously for y and z). The voxels
+ * outside of the grid domain are zero, which matches the zero border of the dense grid texture.
+ */
+struct BrickMap {
+    static constexpr uint32_t BRICK_SIZE = 8; ///< Number of voxels per brick side (without the apron).
+    static constexpr uint32_t BRICK_SIZE_WITH_APRON = BRICK_SIZE + 1;
+    static constexpr uint32_t EMPTY_BRICK = 0xFFFFFFFFu; ///< Indirection entry of bricks containing only zeros.
+    static constexpr uint32_t MAX_ATLAS_SIZE_IN_BRICKS = 1024; ///< Atlas positions are packed with 10 bits per axis.
+
+    /// Number of bricks in x, y and z direction (i.e., the size of the indirection grid).
+    uint32_t indirectionSizeX = 0, indirectionSizeY = 0, indirectionSizeZ = 0;
+    /// Number of bricks stored in the atlas in x, y and z direction.
+    uint32_t atlasSizeInBricksX = 0, atlasSizeInBricksY = 0, atlasSizeInBricksZ = 0;
+    uint32_t numOccupiedBricks = 0;
+    /// Atlas brick position (x | y << 10 | z << 20) of each brick or EMPTY_BRICK.
+    std::vector<uint32_t> indirectionData;
+    /// Voxel data of the atlas of size atlasSizeInBricks * BRICK_SIZE_WITH_APRON.
+    std::vector<float> atlasData;
+
+    [[nodiscard]] inline uint32_t getAtlasSizeX() const { return atlasSizeInBricksX * BRICK_SIZE_WITH_APRON; }
+    [[nodiscard]] inline uint32_t getAtlasSizeY() const { return atlasSizeInBricksY * BRICK_SIZE_WITH_APRON; }
+    [[nodiscard]] inline uint32_t getAtlasSizeZ() const { return atlasSizeInBricksZ * BRICK_SIZE_WITH_APRON; }
+};
+typedef std::shared_ptr<BrickMap> BrickMapPtr;
+
 class CloudData {
 public:
     explicit CloudData(sgl::TransferFunctionWindow* transferFunctionWindow = nullptr);
@@ -102,6 +131,14 @@ public:
     [[nodiscard]] inline bool hasSparseData() const { return !sparseGridHandle.empty(); }
     inline void setCacheSparseGrid(bool cache) { cacheSparseGrid = true; }
 
+    /**
+     * @return The brick map representation of the density field.
+     * The brick map is created on the first call from the dense field if it is loaded, or from the sparse field
+     * otherwise (without creating a dense copy of the data).
+     */
+    const BrickMapPtr& getBrickMap();
+    [[nodiscard]] inline bool hasBrickMap() const { return brickMap.get() != nullptr; }
+
 
     /// Called when the transfer function texture was updated.
     void onTransferFunctionMapRebuilt() {}
@@ -167,6 +204,10 @@ private:
     nanovdb::GridHandle<nanovdb::HostBuffer> sparseGridHandle;
     bool cacheSparseGrid = false;
 
+    // --- Brick map. ---
+    void printBrickMapMetadata();
+    BrickMapPtr brickMap;
+
 };
 
 typedef std::shared_ptr<CloudData> CloudDataPtr;
@@ -449,6 +449,7 @@ void MainApp::renderGui() {
         if (transferFunctionWindow.getTransferFunctionMapRebuilt()) {
             if (cloudData) {
                 cloudData->onTransferFunctionMapRebuilt();
+                volumetricPathTracingPass->onTransferFunctionMapRebuilt();
                 hasMoved();
             }
             //sgl::EventManager::get()->triggerEvent(std::make_shared<sgl::Event>(
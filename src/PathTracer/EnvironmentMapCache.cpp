@@ -0,0 +1,139 @@
+/*
+ * BSD 2-Clause License
+ *
+ * Copyright (c) 2022, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <boost/filesystem.hpp>
+
+#include <Utils/File/Logfile.hpp>
+#include <Utils/File/FileUtils.hpp>
+
+#include "EnvironmentMapCache.hpp"
+
+/// Increment when the layout of the cache files changes.
+static const uint32_t ENVIRONMENT_MAP_CACHE_FORMAT_VERSION = 1;
+
+/// 64-bit FNV-1a hash.
+static uint64_t hashFnv1a(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= uint64_t(bytes[i]);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+EnvironmentMapCache::EnvironmentMapCache() {
+    cacheDirectory = sgl::FileUtils::get()->getConfigDirectory() + "EnvironmentMapCache/";
+    sgl::FileUtils::get()->ensureDirectoryExists(cacheDirectory);
+}
+
+bool EnvironmentMapCache::computeSourceKey(const std::string& filename, std::string& key) {
+    boost::system::error_code errorCode;
+    boost::filesystem::path absolutePath = boost::filesystem::canonical(filename, errorCode);
+    if (errorCode) {
+        return false;
+    }
+    uint64_t fileSize = uint64_t(boost::filesystem::file_size(absolutePath, errorCode));
+    if (errorCode) {
+        return false;
+    }
+    auto lastWriteTime = int64_t(boost::filesystem::last_write_time(absolutePath, errorCode));
+    if (errorCode) {
+        return false;
+    }
+
+    std::string pathString = absolutePath.generic_string();
+    uint64_t hash = hashFnv1a(pathString.c_str(), pathString.size() + 1);
+    hash = hashFnv1a(&fileSize, sizeof(uint64_t), hash);
+    hash = hashFnv1a(&lastWriteTime, sizeof(int64_t), hash);
+
+    std::stringstream keyStream;
+    keyStream << sgl::FileUtils::get()->removeExtension(sgl::FileUtils::get()->getPureFilename(filename)) << "_"
+              << std::hex << std::setw(16) << std::setfill('0') << hash;
+    key = keyStream.str();
+    return true;
+}
+
+std::string EnvironmentMapCache::getEntryFilename(const std::string& key, const std::string& entryName) {
+    return cacheDirectory + key + "_" + entryName + "_v" + std::to_string(ENVIRONMENT_MAP_CACHE_FORMAT_VERSION)
+            + ".bin";
+}
+
+bool EnvironmentMapCache::loadEntry(
+        const std::string& key, const std::string& entryName, std::vector<uint8_t>& data) {
+    std::string filename = getEntryFilename(key, entryName);
+    std::ifstream file(filename, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+    auto fileSize = std::streamoff(file.tellg());
+    file.seekg(0, std::ios::beg);
+    data.resize(size_t(fileSize));
+    file.read(reinterpret_cast<char*>(data.data()), std::streamsize(fileSize));
+    if (!file.good()) {
+        data.clear();
+        return false;
+    }
+    return true;
+}
+
+bool EnvironmentMapCache::storeEntry(
+        const std::string& key, const std::string& entryName,
+        const void* header, size_t headerSize, const void* data, size_t dataSize) {
+    std::string filename = getEntryFilename(key, entryName);
+    boost::system::error_code errorCode;
+    boost::filesystem::path tmpPath = boost::filesystem::unique_path(filename + ".%%%%-%%%%-%%%%.tmp", errorCode);
+    if (errorCode) {
+        return false;
+    }
+    {
+        std::ofstream file(tmpPath.string(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        if (headerSize > 0) {
+            file.write(static_cast<const char*>(header), std::streamsize(headerSize));
+        }
+        file.write(static_cast<const char*>(data), std::streamsize(dataSize));
+        if (!file.good()) {
+            file.close();
+            boost::filesystem::remove(tmpPath, errorCode);
+            sgl::Logfile::get()->writeWarning(
+                    "Warning in EnvironmentMapCache::storeEntry: Could not write the file \"" + filename + "\".");
+            return false;
+        }
+    }
+    boost::filesystem::rename(tmpPath, filename, errorCode);
+    if (errorCode) {
+        boost::filesystem::remove(tmpPath, errorCode);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,67 @@
+/*
+ * BSD 2-Clause License
+ *
+ * Copyright (c) 2022, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLOUDRENDERING_ENVIRONMENTMAPCACHE_HPP
+#define CLOUDRENDERING_ENVIRONMENTMAPCACHE_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * On-disk cache for data derived from environment map images (e.g., decoded .exr pixels or importance sampling
+ * tables). All entries of an image share a key that hashes the absolute path, the size and the last modification
+ * time of the image file, so editing or replacing the file automatically results in a cache miss.
+ *
+ * Like PersistentShaderCache, entries are written to a temporary file that is renamed afterwards, so multiple
+ * processes (e.g., parallel dataset generation runs) may safely use the same cache directory.
+ */
+class EnvironmentMapCache {
+public:
+    EnvironmentMapCache();
+
+    /**
+     * @param filename The path to the environment map image file.
+     * @param key The key of the cache entries of the passed file.
+     * @return Whether the file could be accessed. If not, the file should not be cached.
+     */
+    bool computeSourceKey(const std::string& filename, std::string& key);
+
+    /// Loads the entry with the passed name (e.g., "decoded") of the image with the passed key.
+    bool loadEntry(const std::string& key, const std::string& entryName, std::vector<uint8_t>& data);
+    /// Stores an entry consisting of a (optional) header followed by the data.
+    bool storeEntry(
+            const std::string& key, const std::string& entryName,
+            const void* header, size_t headerSize, const void* data, size_t dataSize);
+
+private:
+    std::string getEntryFilename(const std::string& key, const std::string& entryName);
+    std::string cacheDirectory;
+};
+
+#endif //CLOUDRENDERING_ENVIRONMENTMAPCACHE_HPP
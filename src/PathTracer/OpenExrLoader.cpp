@@ -26,6 +26,9 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <thread>
+#include <algorithm>
+
 #include "OpenExrLoader.hpp"
 
 #include <OpenEXR/OpenEXRConfig.h>
@@ -40,7 +43,9 @@
 #endif
 
 bool loadOpenExrImageFile(const std::string& filename, OpenExrImageInfo& imageInfo) {
-    Imf::RgbaInputFile file(filename.c_str());
+    // Decode the line blocks of the file in parallel.
+    int numThreads = int(std::max(std::thread::hardware_concurrency(), 1u));
+    Imf::RgbaInputFile file(filename.c_str(), numThreads);
     Imath::Box2i dw = file.dataWindow();
 
     imageInfo.width = dw.max.x - dw.min.x + 1;
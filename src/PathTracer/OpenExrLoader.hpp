@@ -39,6 +39,7 @@ struct OpenExrImageInfo {
 
 /**
  * Loads an .exr file using OpenEXR. The file is expected to contain RGBA half float data.
+ * The file is decoded using one thread per hardware thread.
  * @param filename The path to the .exr file.
  * @param imageInfo The loaded image data.
  * @return Whether the file was successfully loaded.
@@ -0,0 +1,431 @@
+/*
+ * BSD 2-Clause License
+ *
+ * Copyright (c) 2022, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <mutex>
+#include <boost/filesystem.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <Utils/AppSettings.hpp>
+#include <Utils/File/Logfile.hpp>
+#include <Utils/File/FileUtils.hpp>
+#include <Graphics/Vulkan/Utils/Device.hpp>
+#include <Graphics/Vulkan/Shader/ShaderManager.hpp>
+#include <Graphics/Vulkan/Render/ComputePipeline.hpp>
+
+#ifdef SUPPORT_SPIRV_CACHE
+#include <shaderc/shaderc.hpp>
+#endif
+
+#include "PersistentShaderCache.hpp"
+
+/// Increment when the layout of the cache files or the way the key is computed changes.
+static const uint32_t SHADER_CACHE_FORMAT_VERSION = 1;
+
+/// 64-bit FNV-1a hash.
+static uint64_t hashFnv1a(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= uint64_t(bytes[i]);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static uint64_t hashFnv1a(const std::string& str, uint64_t hash) {
+    // Also hash the terminating null character so that ("ab", "c") and ("a", "bc") produce different keys.
+    return hashFnv1a(str.c_str(), str.size() + 1, hash);
+}
+
+std::shared_ptr<PersistentShaderCache> PersistentShaderCache::getShared(sgl::vk::Device* device) {
+    static std::mutex sharedCacheMutex;
+    static std::weak_ptr<PersistentShaderCache> sharedCacheWeak;
+    std::lock_guard<std::mutex> lock(sharedCacheMutex);
+    std::shared_ptr<PersistentShaderCache> sharedCache = sharedCacheWeak.lock();
+    if (!sharedCache || sharedCache->device != device) {
+        sharedCache = std::make_shared<PersistentShaderCache>(device);
+        sharedCacheWeak = sharedCache;
+    }
+    return sharedCache;
+}
+
+PersistentShaderCache::PersistentShaderCache(sgl::vk::Device* device) : device(device) {
+    cacheDirectory = sgl::FileUtils::get()->getConfigDirectory() + "ShaderCache/";
+    sgl::FileUtils::get()->ensureDirectoryExists(cacheDirectory);
+
+    const VkPhysicalDeviceProperties& properties = device->getPhysicalDeviceProperties();
+    pipelineCacheFilename =
+            cacheDirectory + "PipelineCache_" + std::to_string(properties.vendorID) + "_"
+            + std::to_string(properties.deviceID) + ".bin";
+    if (properties.apiVersion >= VK_API_VERSION_1_2) {
+        targetEnvironmentVersion = VK_API_VERSION_1_2;
+    } else if (properties.apiVersion >= VK_API_VERSION_1_1) {
+        targetEnvironmentVersion = VK_API_VERSION_1_1;
+    } else {
+        targetEnvironmentVersion = VK_API_VERSION_1_0;
+    }
+
+    // Only pass data to the driver that was created by the same device and driver (cf. VkPipelineCacheHeaderVersionOne).
+    std::string pipelineCacheData;
+    if (sgl::FileUtils::get()->exists(pipelineCacheFilename) && readFile(pipelineCacheFilename, pipelineCacheData)) {
+        const size_t headerSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+        uint32_t headerValues[4];
+        bool isCompatible = pipelineCacheData.size() >= headerSize;
+        if (isCompatible) {
+            memcpy(headerValues, pipelineCacheData.data(), sizeof(headerValues));
+            isCompatible =
+                    headerValues[1] == uint32_t(VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+                    && headerValues[2] == properties.vendorID && headerValues[3] == properties.deviceID
+                    && memcmp(
+                            pipelineCacheData.data() + sizeof(headerValues), properties.pipelineCacheUUID,
+                            VK_UUID_SIZE) == 0;
+        }
+        if (!isCompatible) {
+            pipelineCacheData.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo pipelineCacheCreateInfo{};
+    pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    pipelineCacheCreateInfo.initialDataSize = pipelineCacheData.size();
+    pipelineCacheCreateInfo.pInitialData = pipelineCacheData.empty() ? nullptr : pipelineCacheData.data();
+    if (vkCreatePipelineCache(
+            device->getVkDevice(), &pipelineCacheCreateInfo, nullptr, &pipelineCache) != VK_SUCCESS) {
+        sgl::Logfile::get()->writeWarning(
+                "Warning in PersistentShaderCache::PersistentShaderCache: Could not create the pipeline cache.");
+        pipelineCache = VK_NULL_HANDLE;
+    }
+
+    indexShaderFiles();
+}
+
+PersistentShaderCache::~PersistentShaderCache() {
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        isShuttingDown = true;
+        jobQueue.clear();
+    }
+    jobConditionVariable.notify_all();
+    for (std::thread& workerThread : workerThreads) {
+        workerThread.join();
+    }
+    workerThreads.clear();
+
+    if (pipelineCache != VK_NULL_HANDLE) {
+        savePipelineCache();
+        vkDestroyPipelineCache(device->getVkDevice(), pipelineCache, nullptr);
+        pipelineCache = VK_NULL_HANDLE;
+    }
+}
+
+void PersistentShaderCache::savePipelineCache() {
+    if (pipelineCache == VK_NULL_HANDLE) {
+        return;
+    }
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(device->getVkDevice(), pipelineCache, &dataSize, nullptr) != VK_SUCCESS
+            || dataSize == 0) {
+        return;
+    }
+    std::vector<uint8_t> data(dataSize);
+    if (vkGetPipelineCacheData(device->getVkDevice(), pipelineCache, &dataSize, data.data()) != VK_SUCCESS) {
+        return;
+    }
+    writeFileAtomic(pipelineCacheFilename, data.data(), dataSize);
+}
+
+void PersistentShaderCache::indexShaderFiles() {
+    // Same lookup as used by sgl::vk::ShaderManager: Shader files are identified by their file name.
+    const std::string shaderDirectory = sgl::AppSettings::get()->getDataDirectory() + "Shaders/";
+    boost::system::error_code errorCode;
+    boost::filesystem::recursive_directory_iterator it(shaderDirectory, errorCode), end;
+    for (; !errorCode && it != end; it.increment(errorCode)) {
+        if (boost::filesystem::is_regular_file(it->path())) {
+            shaderFileMap.insert({ it->path().filename().string(), it->path().string() });
+        }
+    }
+}
+
+bool PersistentShaderCache::readFile(const std::string& filename, std::string& content) {
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    content = buffer.str();
+    return true;
+}
+
+bool PersistentShaderCache::writeFileAtomic(const std::string& filename, const void* data, size_t size) {
+    boost::system::error_code errorCode;
+    boost::filesystem::path tmpPath = boost::filesystem::unique_path(filename + ".%%%%-%%%%-%%%%.tmp", errorCode);
+    if (errorCode) {
+        return false;
+    }
+    {
+        std::ofstream file(tmpPath.string(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        file.write(static_cast<const char*>(data), std::streamsize(size));
+        if (!file.good()) {
+            file.close();
+            boost::filesystem::remove(tmpPath, errorCode);
+            return false;
+        }
+    }
+    boost::filesystem::rename(tmpPath, filename, errorCode);
+    if (errorCode) {
+        boost::filesystem::remove(tmpPath, errorCode);
+        return false;
+    }
+    return true;
+}
+
+bool PersistentShaderCache::getShaderSource(const std::string& shaderId, std::string& source) {
+    // "Clouds.Compute" refers to the section "-- Compute" in the file "Clouds.glsl".
+    size_t dotPos = shaderId.find('.');
+    if (dotPos == std::string::npos) {
+        return false;
+    }
+    auto it = shaderFileMap.find(shaderId.substr(0, dotPos) + ".glsl");
+    std::string fileContent;
+    if (it == shaderFileMap.end() || !readFile(it->second, fileContent)) {
+        return false;
+    }
+
+    const std::string sectionName = shaderId.substr(dotPos + 1);
+    std::istringstream stream(fileContent);
+    std::string line, sectionContent;
+    bool isInSection = false;
+    while (std::getline(stream, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (boost::starts_with(line, "--")) {
+            std::string name = line.substr(2);
+            name.erase(0, name.find_first_not_of(" \t"));
+            name.erase(name.find_last_not_of(" \t") + 1);
+            if (isInSection) {
+                break;
+            }
+            isInSection = name == sectionName;
+            continue;
+        }
+        if (isInSection) {
+            sectionContent += line;
+            sectionContent += '\n';
+        }
+    }
+    if (!isInSection) {
+        return false;
+    }
+
+    std::unordered_set<std::string> includedFiles;
+    return expandIncludes(sectionContent, includedFiles, source);
+}
+
+bool PersistentShaderCache::expandIncludes(
+        const std::string& fileContent, std::unordered_set<std::string>& includedFiles, std::string& expanded) {
+    std::istringstream stream(fileContent);
+    std::string line;
+    while (std::getline(stream, line)) {
+        std::string trimmedLine = line;
+        trimmedLine.erase(0, trimmedLine.find_first_not_of(" \t"));
+        if (boost::starts_with(trimmedLine, "#include")) {
+            size_t startPos = trimmedLine.find('"');
+            size_t endPos = startPos == std::string::npos ? startPos : trimmedLine.find('"', startPos + 1);
+            if (endPos == std::string::npos) {
+                return false;
+            }
+            std::string includeName = trimmedLine.substr(startPos + 1, endPos - startPos - 1);
+            if (includedFiles.find(includeName) != includedFiles.end()) {
+                continue;
+            }
+            includedFiles.insert(includeName);
+            auto it = shaderFileMap.find(includeName);
+            std::string includeContent;
+            if (it == shaderFileMap.end() || !readFile(it->second, includeContent)) {
+                return false;
+            }
+            if (!expandIncludes(includeContent, includedFiles, expanded)) {
+                return false;
+            }
+            continue;
+        }
+        expanded += line;
+        expanded += '\n';
+    }
+    return true;
+}
+
+std::string PersistentShaderCache::insertPreprocessorDefines(
+        const std::string& source, const std::map<std::string, std::string>& preprocessorDefines) {
+    std::string defines;
+    for (const auto& define : preprocessorDefines) {
+        defines += "#define " + define.first + " " + define.second + "\n";
+    }
+    // The defines need to come after the #version directive.
+    size_t versionPos = source.find("#version");
+    if (versionPos == std::string::npos) {
+        return defines + source;
+    }
+    size_t lineEndPos = source.find('\n', versionPos);
+    if (lineEndPos == std::string::npos) {
+        return source + "\n" + defines;
+    }
+    return source.substr(0, lineEndPos + 1) + defines + source.substr(lineEndPos + 1);
+}
+
+sgl::vk::ShaderStagesPtr PersistentShaderCache::getComputeShaderStages(
+        const std::string& shaderId, const std::map<std::string, std::string>& preprocessorDefines) {
+    sgl::vk::ShaderStagesPtr shaderStages = loadOrCompileComputeShaderStages(shaderId, preprocessorDefines);
+    if (shaderStages) {
+        return shaderStages;
+    }
+
+    // Fall back to the in-memory shader manager, e.g., if the source could not be compiled.
+    sgl::vk::ShaderManager->invalidateShaderCache();
+    return sgl::vk::ShaderManager->getShaderStages({ shaderId }, preprocessorDefines);
+}
+
+sgl::vk::ShaderStagesPtr PersistentShaderCache::loadOrCompileComputeShaderStages(
+        const std::string& shaderId, const std::map<std::string, std::string>& preprocessorDefines) {
+#ifdef SUPPORT_SPIRV_CACHE
+    std::string source;
+    if (!getShaderSource(shaderId, source)) {
+        return {};
+    }
+    source = insertPreprocessorDefines(source, preprocessorDefines);
+
+    uint64_t key = hashFnv1a(&SHADER_CACHE_FORMAT_VERSION, sizeof(uint32_t));
+    key = hashFnv1a(&targetEnvironmentVersion, sizeof(uint32_t), key);
+    key = hashFnv1a(shaderId, key);
+    key = hashFnv1a(source, key);
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        auto it = shaderStagesPool.find(key);
+        if (it != shaderStagesPool.end()) {
+            numCacheHits++;
+            return it->second;
+        }
+    }
+
+    std::stringstream keyStream;
+    keyStream << std::hex << std::setw(16) << std::setfill('0') << key;
+    const std::string spirvFilename = cacheDirectory + shaderId + "_" + keyStream.str() + ".spv";
+
+    std::vector<uint32_t> spirvCode;
+    std::string spirvData;
+    if (sgl::FileUtils::get()->exists(spirvFilename) && readFile(spirvFilename, spirvData)
+            && !spirvData.empty() && spirvData.size() % sizeof(uint32_t) == 0) {
+        spirvCode.resize(spirvData.size() / sizeof(uint32_t));
+        memcpy(spirvCode.data(), spirvData.data(), spirvData.size());
+        numCacheHits++;
+    } else {
+        shaderc::Compiler compiler;
+        shaderc::CompileOptions compileOptions;
+        compileOptions.SetTargetEnvironment(shaderc_target_env_vulkan, targetEnvironmentVersion);
+        compileOptions.SetOptimizationLevel(shaderc_optimization_level_performance);
+        shaderc::SpvCompilationResult compilationResult = compiler.CompileGlslToSpv(
+                source, shaderc_glsl_compute_shader, shaderId.c_str(), compileOptions);
+        if (compilationResult.GetCompilationStatus() != shaderc_compilation_status_success) {
+            return {};
+        }
+        spirvCode.assign(compilationResult.cbegin(), compilationResult.cend());
+        writeFileAtomic(spirvFilename, spirvCode.data(), spirvCode.size() * sizeof(uint32_t));
+        numCacheMisses++;
+    }
+
+    std::vector<sgl::vk::ShaderModulePtr> shaderModules = {
+            std::make_shared<sgl::vk::ShaderModule>(
+                    device, shaderId, sgl::vk::ShaderModuleType::COMPUTE, spirvCode)
+    };
+    auto shaderStages = std::make_shared<sgl::vk::ShaderStages>(device, shaderModules);
+    std::lock_guard<std::mutex> lock(poolMutex);
+    shaderStagesPool.insert({ key, shaderStages });
+    return shaderStages;
+#else
+    return {};
+#endif
+}
+
+void PersistentShaderCache::precompileComputeShaderVariantsAsync(
+        const std::string& shaderId, const std::vector<std::map<std::string, std::string>>& variants) {
+#ifdef SUPPORT_SPIRV_CACHE
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        for (const auto& preprocessorDefines : variants) {
+            std::string variantName = shaderId;
+            for (const auto& define : preprocessorDefines) {
+                variantName += ";" + define.first + "=" + define.second;
+            }
+            if (!requestedVariants.insert(variantName).second) {
+                continue;
+            }
+            jobQueue.push_back({ shaderId, preprocessorDefines });
+        }
+        if (workerThreads.empty() && !jobQueue.empty()) {
+            // Leave some cores for the render thread and the driver.
+            const unsigned int numWorkers = std::clamp(std::thread::hardware_concurrency() / 2u, 1u, 4u);
+            for (unsigned int i = 0; i < numWorkers; i++) {
+                workerThreads.emplace_back(&PersistentShaderCache::workerThreadMain, this);
+            }
+        }
+    }
+    jobConditionVariable.notify_all();
+#endif
+}
+
+void PersistentShaderCache::workerThreadMain() {
+    while (true) {
+        PrecompileJob job;
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            jobConditionVariable.wait(lock, [this] { return isShuttingDown || !jobQueue.empty(); });
+            if (isShuttingDown) {
+                return;
+            }
+            job = std::move(jobQueue.front());
+            jobQueue.pop_front();
+        }
+
+        sgl::vk::ShaderStagesPtr shaderStages = loadOrCompileComputeShaderStages(job.shaderId, job.preprocessorDefines);
+        if (shaderStages && pipelineCache != VK_NULL_HANDLE) {
+            // The pipeline itself is discarded; creating it fills the pipeline cache used by the render thread.
+            sgl::vk::ComputePipelineInfo pipelineInfo(shaderStages);
+            pipelineInfo.setPipelineCache(pipelineCache);
+            auto computePipeline = std::make_shared<sgl::vk::ComputePipeline>(device, pipelineInfo);
+        }
+    }
+}
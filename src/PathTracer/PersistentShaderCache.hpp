@@ -0,0 +1,135 @@
+/*
+ * BSD 2-Clause License
+ *
+ * Copyright (c) 2022, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLOUDRENDERING_PERSISTENTSHADERCACHE_HPP
+#define CLOUDRENDERING_PERSISTENTSHADERCACHE_HPP
+
+#include <map>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <Graphics/Vulkan/Shader/Shader.hpp>
+
+namespace sgl { namespace vk {
+class Device;
+}}
+
+/**
+ * On-disk cache for compiled compute shaders and the Vulkan pipeline cache.
+ *
+ * The SPIR-V code of a shader is stored under a key hashing the fully expanded shader source (i.e., including all
+ * included files), the preprocessor defines and the target environment. Thus, editing any shader file or changing
+ * the define set automatically results in a cache miss. The VkPipelineCache is loaded when the cache is created and
+ * written back to disk when the last user releases it.
+ *
+ * The cache is shared by all passes of a process (see getShared). Writes go to a temporary file that is renamed
+ * afterwards, so multiple processes may safely use the same cache directory at the same time.
+ *
+ * Shader stages are additionally kept in an in-memory pool. Variants that will likely be requested soon (e.g., the
+ * other VPT modes, grid types or grid interpolation types) can be compiled on worker threads using
+ * precompileComputeShaderVariantsAsync. The workers also create the compute pipelines once, so the driver side of the
+ * compilation ends up in the pipeline cache.
+ */
+class PersistentShaderCache {
+public:
+    explicit PersistentShaderCache(sgl::vk::Device* device);
+    ~PersistentShaderCache();
+
+    /// Returns the cache instance of the process (or creates it if no pass currently holds a reference).
+    static std::shared_ptr<PersistentShaderCache> getShared(sgl::vk::Device* device);
+
+    /**
+     * Returns the shader stages for the passed compute shader ID (e.g., "Clouds.Compute"). On a cache miss, the shader
+     * is compiled and the SPIR-V code is written to disk. If the shader cannot be compiled by the cache itself, the
+     * call falls back to sgl::vk::ShaderManager (which also reports compilation errors).
+     */
+    sgl::vk::ShaderStagesPtr getComputeShaderStages(
+            const std::string& shaderId, const std::map<std::string, std::string>& preprocessorDefines);
+
+    /**
+     * Compiles the passed variants of a compute shader on worker threads. Variants that were already requested before
+     * are skipped. Does nothing if the SPIR-V cache is not supported, as sgl::vk::ShaderManager is not thread-safe.
+     */
+    void precompileComputeShaderVariantsAsync(
+            const std::string& shaderId, const std::vector<std::map<std::string, std::string>>& variants);
+
+    /// Pipeline cache to pass to the compute pipeline creation.
+    [[nodiscard]] inline VkPipelineCache getVkPipelineCache() const { return pipelineCache; }
+    /// Writes the current content of the pipeline cache to disk.
+    void savePipelineCache();
+
+    [[nodiscard]] inline size_t getNumCacheHits() const { return numCacheHits; }
+    [[nodiscard]] inline size_t getNumCacheMisses() const { return numCacheMisses; }
+
+private:
+    sgl::vk::ShaderStagesPtr loadOrCompileComputeShaderStages(
+            const std::string& shaderId, const std::map<std::string, std::string>& preprocessorDefines);
+    void workerThreadMain();
+    void indexShaderFiles();
+    bool getShaderSource(const std::string& shaderId, std::string& source);
+    bool expandIncludes(
+            const std::string& fileContent, std::unordered_set<std::string>& includedFiles, std::string& expanded);
+    std::string insertPreprocessorDefines(
+            const std::string& source, const std::map<std::string, std::string>& preprocessorDefines);
+    bool readFile(const std::string& filename, std::string& content);
+    bool writeFileAtomic(const std::string& filename, const void* data, size_t size);
+
+    sgl::vk::Device* device;
+    std::string cacheDirectory;
+    std::string pipelineCacheFilename;
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+    uint32_t targetEnvironmentVersion = 0;
+    std::unordered_map<std::string, std::string> shaderFileMap; ///< File name -> path in the shader directory.
+    std::atomic<size_t> numCacheHits{0};
+    std::atomic<size_t> numCacheMisses{0};
+
+    // In-memory pool of shader stages indexed by the cache key.
+    std::mutex poolMutex;
+    std::unordered_map<uint64_t, sgl::vk::ShaderStagesPtr> shaderStagesPool;
+
+    // Background compilation of likely variants.
+    struct PrecompileJob {
+        std::string shaderId;
+        std::map<std::string, std::string> preprocessorDefines;
+    };
+    std::mutex jobMutex;
+    std::condition_variable jobConditionVariable;
+    std::deque<PrecompileJob> jobQueue;
+    std::unordered_set<std::string> requestedVariants;
+    std::vector<std::thread> workerThreads;
+    bool isShuttingDown = false;
+};
+
+#endif //CLOUDRENDERING_PERSISTENTSHADERCACHE_HPP
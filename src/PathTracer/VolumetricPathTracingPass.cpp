@@ -22,8 +22,13 @@
  * SOFTWARE.
  */
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
 #include <memory>
 #include <utility>
+#include <vector>
 #include <glm/vec3.hpp>
 
 #include <Math/Math.hpp>
@@ -34,6 +39,7 @@
 #include <Graphics/Vulkan/Buffers/Framebuffer.hpp>
 #include <Graphics/Vulkan/Render/RayTracingPipeline.hpp>
 #include <Graphics/Vulkan/Render/Renderer.hpp>
+#include <Graphics/Vulkan/Utils/Swapchain.hpp>
 #include <ImGui/ImGuiWrapper.hpp>
 #include <ImGui/Widgets/PropertyEditor.hpp>
 #include <ImGui/Widgets/TransferFunctionWindow.hpp>
@@ -51,11 +57,14 @@
 
 #include "CloudData.hpp"
 #include "MomentUtils.hpp"
+#include "PersistentShaderCache.hpp"
+#include "EnvironmentMapCache.hpp"
 #include "SuperVoxelGrid.hpp"
 #include "VolumetricPathTracingPass.hpp"
 
 VolumetricPathTracingPass::VolumetricPathTracingPass(sgl::vk::Renderer* renderer, sgl::CameraPtr* camera)
         : ComputePass(renderer), camera(camera) {
+    shaderCache = PersistentShaderCache::getShared(device);
     uniformBuffer = std::make_shared<sgl::vk::Buffer>(
             device, sizeof(UniformData),
             VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
@@ -64,6 +73,10 @@ VolumetricPathTracingPass::VolumetricPathTracingPass(sgl::vk::Renderer* renderer
             device, sizeof(FrameInfo),
             VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
             VMA_MEMORY_USAGE_GPU_ONLY);
+    adaptiveSamplingStatsBuffer = std::make_shared<sgl::vk::Buffer>(
+            device, sizeof(AdaptiveSamplingStatsData),
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VMA_MEMORY_USAGE_GPU_ONLY);
     computeWrappingZoneParameters(momentUniformData.wrapping_zone_parameters);
     momentUniformDataBuffer = std::make_shared<sgl::vk::Buffer>(
             device, sizeof(MomentUniformData), &momentUniformData,
@@ -71,6 +84,9 @@ VolumetricPathTracingPass::VolumetricPathTracingPass(sgl::vk::Renderer* renderer
             VMA_MEMORY_USAGE_GPU_ONLY);
 
     equalAreaPass = std::make_shared<OctahedralMappingPass>(renderer);
+    interactionUpsamplingPass = std::make_shared<InteractionUpsamplingPass>(renderer);
+    sunTransmittancePass = std::make_shared<SunTransmittancePass>(renderer);
+    environmentMapCache = std::make_shared<EnvironmentMapCache>();
 
     if (sgl::AppSettings::get()->getSettings().getValueOpt(
             "vptEnvironmentMapImage", environmentMapFilenameGui)) {
@@ -143,6 +159,22 @@ void VolumetricPathTracingPass::setOutputImage(sgl::vk::ImageViewPtr& imageView)
     depthTexture = std::make_shared<sgl::vk::Texture>(device, imageSettings, samplerSettings);
     densityTexture = std::make_shared<sgl::vk::Texture>(device, imageSettings, samplerSettings);
     reprojUVTexture = std::make_shared<sgl::vk::Texture>(device, imageSettings, samplerSettings);
+    imageSettings.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+    varianceTexture = std::make_shared<sgl::vk::Texture>(device, imageSettings, samplerSettings);
+
+    // Allocated for the smallest supported tile size (i.e., the maximum number of work groups).
+    const int numTiles = sgl::iceil(int(imageSettings.width), 16) * sgl::iceil(int(imageSettings.height), 16);
+    tileActiveBuffer = std::make_shared<sgl::vk::Buffer>(
+            device, sizeof(uint32_t) * numTiles, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+    hasTemporalHistory = false;
+    if (useTemporalAccumulation) {
+        createTemporalAccumulationTextures();
+    }
+
+    interactionUpsamplingPass->setInputImages(accImageTexture, depthTexture);
+    interactionUpsamplingPass->setOutputImage(resultImageView);
+    isBlendingInteractionResult = false;
 
     blitResultRenderPass->setInputTexture(resultTexture);
     blitResultRenderPass->setOutputImage(imageView);
@@ -155,6 +187,23 @@ void VolumetricPathTracingPass::setOutputImage(sgl::vk::ImageViewPtr& imageView)
     setDataDirty();
 }
 
+void VolumetricPathTracingPass::createTemporalAccumulationTextures() {
+    sgl::vk::Device* device = sgl::AppSettings::get()->getPrimaryDevice();
+    sgl::vk::ImageSettings imageSettings = resultImageView->getImage()->getImageSettings();
+    imageSettings.usage =
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    sgl::vk::ImageSamplerSettings samplerSettings;
+
+    imageSettings.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    temporalPositionTexture = std::make_shared<sgl::vk::Texture>(device, imageSettings, samplerSettings);
+    historyAccTexture = std::make_shared<sgl::vk::Texture>(device, imageSettings, samplerSettings);
+    historyPositionTexture = std::make_shared<sgl::vk::Texture>(device, imageSettings, samplerSettings);
+    imageSettings.format = VK_FORMAT_R32G32_SFLOAT;
+    temporalSampleInfoTexture = std::make_shared<sgl::vk::Texture>(device, imageSettings, samplerSettings);
+    historySampleInfoTexture = std::make_shared<sgl::vk::Texture>(device, imageSettings, samplerSettings);
+    hasTemporalHistory = false;
+}
+
 void VolumetricPathTracingPass::setDenoiserFeatureMaps() {
     if (denoiser) {
         if (denoiser->getUseFeatureMap(FeatureMapType::COLOR)) {
@@ -223,14 +272,16 @@ void VolumetricPathTracingPass::recreateSwapchain(uint32_t width, uint32_t heigh
 void VolumetricPathTracingPass::setGridData() {
     nanoVdbBuffer = {};
     densityFieldTexture = {};
+    brickIndirectionTexture = {};
     emissionNanoVdbBuffer = {};
     emissionFieldTexture = {};
+    isSunTransmittanceDataDirty = true;
 
     if (!cloudData) {
         return;
     }
 
-    if (useSparseGrid) {
+    if (gridType == GridType::NANOVDB) {
         uint8_t* sparseDensityField;
         uint64_t sparseDensityFieldSize;
         cloudData->getSparseDensityField(sparseDensityField, sparseDensityFieldSize);
@@ -287,10 +338,41 @@ void VolumetricPathTracingPass::setGridData() {
         }
         sgl::vk::Device* device = sgl::AppSettings::get()->getPrimaryDevice();
 
-        densityFieldTexture = std::make_shared<sgl::vk::Texture>(device, imageSettings, samplerSettings);
-        densityFieldTexture->getImage()->uploadData(
-                cloudData->getGridSizeX() * cloudData->getGridSizeY() * cloudData->getGridSizeZ() * sizeof(float),
-                cloudData->getDenseDensityField());
+        if (gridType == GridType::BRICK_MAP) {
+            const BrickMapPtr& brickMap = cloudData->getBrickMap();
+            imageSettings.width = brickMap->getAtlasSizeX();
+            imageSettings.height = brickMap->getAtlasSizeY();
+            imageSettings.depth = brickMap->getAtlasSizeZ();
+            uint32_t maxImageDimension3D = device->getPhysicalDeviceProperties().limits.maxImageDimension3D;
+            if (imageSettings.width > maxImageDimension3D || imageSettings.depth > maxImageDimension3D) {
+                sgl::Logfile::get()->throwError(
+                        "Error in VolumetricPathTracingPass::setGridData: The brick atlas exceeds the maximum 3D "
+                        "image size supported by the device.");
+            }
+            densityFieldTexture = std::make_shared<sgl::vk::Texture>(device, imageSettings, samplerSettings);
+            densityFieldTexture->getImage()->uploadData(
+                    brickMap->atlasData.size() * sizeof(float), brickMap->atlasData.data());
+
+            sgl::vk::ImageSettings indirectionImageSettings;
+            indirectionImageSettings.width = brickMap->indirectionSizeX;
+            indirectionImageSettings.height = brickMap->indirectionSizeY;
+            indirectionImageSettings.depth = brickMap->indirectionSizeZ;
+            indirectionImageSettings.imageType = VK_IMAGE_TYPE_3D;
+            indirectionImageSettings.format = VK_FORMAT_R32_UINT;
+            indirectionImageSettings.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+            sgl::vk::ImageSamplerSettings indirectionSamplerSettings;
+            indirectionSamplerSettings.minFilter = VK_FILTER_NEAREST;
+            indirectionSamplerSettings.magFilter = VK_FILTER_NEAREST;
+            brickIndirectionTexture = std::make_shared<sgl::vk::Texture>(
+                    device, indirectionImageSettings, indirectionSamplerSettings);
+            brickIndirectionTexture->getImage()->uploadData(
+                    brickMap->indirectionData.size() * sizeof(uint32_t), brickMap->indirectionData.data());
+        } else {
+            densityFieldTexture = std::make_shared<sgl::vk::Texture>(device, imageSettings, samplerSettings);
+            densityFieldTexture->getImage()->uploadData(
+                    cloudData->getGridSizeX() * cloudData->getGridSizeY() * cloudData->getGridSizeZ() * sizeof(float),
+                    cloudData->getDenseDensityField());
+        }
 
         if (emissionData && useEmission) {
             sgl::vk::ImageSettings emissionImageSettings;
@@ -330,11 +412,12 @@ void VolumetricPathTracingPass::updateGridSampler() {
     }
     densityFieldTexture = std::make_shared<sgl::vk::Texture>(
             densityFieldTexture->getImageView(), samplerSettings);
+    isSunTransmittanceDataDirty = true;
 }
 
 void VolumetricPathTracingPass::setCloudData(const CloudDataPtr& data) {
     cloudData = data;
-    frameInfo.frameCount = 0;
+    restartAccumulation();
 
     setGridData();
     setDataDirty();
@@ -358,7 +441,12 @@ void VolumetricPathTracingPass::setVptMode(VptMode vptMode) {
 }
 
 void VolumetricPathTracingPass::setUseSparseGrid(bool useSparse) {
-    this->useSparseGrid = useSparse;
+    setGridType(useSparse ? GridType::NANOVDB : GridType::DENSE);
+}
+
+void VolumetricPathTracingPass::setGridType(GridType type) {
+    this->gridType = type;
+    frameInfo.frameCount = 0;
     setGridData();
     updateVptMode();
     setShaderDirty();
@@ -373,13 +461,218 @@ void VolumetricPathTracingPass::setSparseGridInterpolationType(GridInterpolation
 
 void VolumetricPathTracingPass::setCustomSeedOffset(uint32_t offset) {
     customSeedOffset = offset;
-    setShaderDirty();
+}
+
+void VolumetricPathTracingPass::setSamplerType(VptSamplerType type) {
+    if (samplerType != type) {
+        samplerType = type;
+        frameInfo.frameCount = 0;
+        setShaderDirty();
+    }
 }
 
 void VolumetricPathTracingPass::setUseLinearRGB(bool useLinearRGB) {
     uniformData.useLinearRGB = useLinearRGB;
     frameInfo.frameCount = 0;
-    setShaderDirty();
+}
+
+void VolumetricPathTracingPass::setNumSamplesPerDispatch(int numSamples) {
+    numSamplesPerDispatch = std::max(numSamples, 1);
+}
+
+void VolumetricPathTracingPass::setFeatureMapSampleLimit(int limit) {
+    featureMapSampleLimit = std::max(limit, 0);
+}
+
+void VolumetricPathTracingPass::setOnlyUpdateDenoiserFeatureMaps(bool onlyDenoiserFeatureMaps) {
+    onlyUpdateDenoiserFeatureMaps = onlyDenoiserFeatureMaps;
+}
+
+uint32_t VolumetricPathTracingPass::getFeatureMapWriteMask() {
+    if (!onlyUpdateDenoiserFeatureMaps) {
+        return ~0u;
+    }
+
+    // The result is always written; the displayed feature map also needs to be kept up to date.
+    uint32_t mask = 1u << uint32_t(FeatureMapTypeVpt::RESULT);
+    mask |= 1u << uint32_t(featureMapType);
+    if (useDenoiser && denoiser && denoiser->getIsEnabled()) {
+        const std::pair<FeatureMapType, FeatureMapTypeVpt> featureMapMapping[] = {
+                { FeatureMapType::POSITION, FeatureMapTypeVpt::FIRST_X },
+                { FeatureMapType::NORMAL, FeatureMapTypeVpt::NORMAL },
+                { FeatureMapType::CLOUDONLY, FeatureMapTypeVpt::CLOUD_ONLY },
+                { FeatureMapType::DEPTH, FeatureMapTypeVpt::DEPTH },
+                { FeatureMapType::DENSITY, FeatureMapTypeVpt::DENSITY },
+                { FeatureMapType::BACKGROUND, FeatureMapTypeVpt::BACKGROUND },
+                { FeatureMapType::REPROJ_UV, FeatureMapTypeVpt::REPROJ_UV },
+        };
+        for (const auto& entry : featureMapMapping) {
+            if (denoiser->getUseFeatureMap(entry.first)) {
+                mask |= 1u << uint32_t(entry.second);
+            }
+        }
+    }
+    return mask;
+}
+
+void VolumetricPathTracingPass::setUseAdaptiveSampling(bool useAdaptive) {
+    if (useAdaptiveSampling != useAdaptive) {
+        useAdaptiveSampling = useAdaptive;
+        frameInfo.frameCount = 0;
+        setShaderDirty();
+    }
+}
+
+void VolumetricPathTracingPass::setAdaptiveSamplingErrorThreshold(float threshold) {
+    adaptiveSamplingErrorThreshold = threshold;
+    frameInfo.frameCount = 0;
+}
+
+void VolumetricPathTracingPass::setUseTemporalAccumulation(bool useTemporal) {
+    if (useTemporalAccumulation != useTemporal) {
+        useTemporalAccumulation = useTemporal;
+        if (useTemporalAccumulation && resultImageView && !temporalPositionTexture) {
+            createTemporalAccumulationTextures();
+        }
+        hasTemporalHistory = false;
+        reprojectTemporalHistory = false;
+        frameInfo.frameCount = 0;
+        frameInfo.sampleIndexOffset = 0;
+        setShaderDirty();
+    }
+}
+
+void VolumetricPathTracingPass::setTemporalMaxHistoryLength(int maxHistoryLength) {
+    temporalMaxHistoryLength = std::max(maxHistoryLength, 0);
+}
+
+void VolumetricPathTracingPass::setUseProgressiveResolution(bool useProgressive) {
+    useProgressiveResolution = useProgressive;
+    isBlendingInteractionResult = false;
+}
+
+void VolumetricPathTracingPass::setProgressiveResolutionSettings(int pixelStride, int numSamples) {
+    interactionPixelStride = std::max(pixelStride, 1);
+    interactionNumSamples = std::max(numSamples, 1);
+}
+
+void VolumetricPathTracingPass::setSkipBackgroundPixels(bool skipBackground) {
+    if (skipBackgroundPixels != skipBackground) {
+        skipBackgroundPixels = skipBackground;
+        frameInfo.frameCount = 0;
+        reRender = true;
+    }
+}
+
+void VolumetricPathTracingPass::setUseSunTransmittanceVolume(bool useVolume) {
+    if (useSunTransmittanceVolume != useVolume) {
+        useSunTransmittanceVolume = useVolume;
+        frameInfo.frameCount = 0;
+        setShaderDirty();
+    }
+}
+
+void VolumetricPathTracingPass::onTransferFunctionMapRebuilt() {
+    sunTransmittancePass->setVolumeDirty();
+}
+
+void VolumetricPathTracingPass::updateSunTransmittanceVolume() {
+    sunTransmittancePass->setVolumeSettings(
+            uniformData.boxMin, uniformData.boxMax, uniformData.sunDirection, uniformData.extinction.x,
+            flipYZCoordinates);
+    if (sunTransmittancePass->getIsVolumeDirty()) {
+        sunTransmittancePass->render();
+        renderer->insertMemoryBarrier(
+                VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+    renderer->transitionImageLayout(
+            sunTransmittancePass->getTransmittanceTexture()->getImage(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+void VolumetricPathTracingPass::updateCoveredPixels(const glm::mat4& viewProjectionMatrix, int width, int height) {
+    frameInfo.coveredPixelsMin = glm::ivec2(0);
+    frameInfo.coveredPixelsMax = glm::ivec2(width, height);
+    if (!skipBackgroundPixels || useAdaptiveSampling) {
+        return;
+    }
+
+    std::vector<std::pair<glm::vec3, glm::vec3>> boxes = { { uniformData.boxMin, uniformData.boxMax } };
+    if (useEmission && emissionData) {
+        boxes.emplace_back(uniformData.emissionBoxMin, uniformData.emissionBoxMax);
+    }
+    glm::vec2 screenMin(std::numeric_limits<float>::max());
+    glm::vec2 screenMax(std::numeric_limits<float>::lowest());
+    for (const auto& box : boxes) {
+        for (int cornerIdx = 0; cornerIdx < 8; cornerIdx++) {
+            glm::vec3 corner(
+                    (cornerIdx & 1) != 0 ? box.second.x : box.first.x,
+                    (cornerIdx & 2) != 0 ? box.second.y : box.first.y,
+                    (cornerIdx & 4) != 0 ? box.second.z : box.first.z);
+            glm::vec4 clipPosition = viewProjectionMatrix * glm::vec4(corner, 1.0f);
+            if (clipPosition.w <= 1e-5f) {
+                // The box reaches behind the camera, so its projection may cover the whole screen.
+                return;
+            }
+            glm::vec2 ndcPosition = glm::vec2(clipPosition) / clipPosition.w;
+            glm::vec2 screenPosition = (ndcPosition * 0.5f + glm::vec2(0.5f)) * glm::vec2(width, height);
+            screenMin = glm::min(screenMin, screenPosition);
+            screenMax = glm::max(screenMax, screenPosition);
+        }
+    }
+
+    // The projection of a box lies within the bounding rectangle of its projected corners. One pixel of margin accounts
+    // for the rounding of the camera rays.
+    frameInfo.coveredPixelsMin = glm::clamp(
+            glm::ivec2(glm::floor(screenMin)) - glm::ivec2(1), glm::ivec2(0), glm::ivec2(width, height));
+    frameInfo.coveredPixelsMax = glm::clamp(
+            glm::ivec2(glm::ceil(screenMax)) + glm::ivec2(1), frameInfo.coveredPixelsMin, glm::ivec2(width, height));
+}
+
+void VolumetricPathTracingPass::restartAccumulation() {
+    if (getIsTemporalAccumulationActive() && hasTemporalHistory) {
+        // Continue the sample sequence so that the new samples are not correlated with the reused history.
+        frameInfo.sampleIndexOffset += frameInfo.frameCount;
+        reprojectTemporalHistory = true;
+    }
+    frameInfo.frameCount = 0;
+}
+
+void VolumetricPathTracingPass::updateAdaptiveSamplingStats() {
+    if (useAdaptiveSampling && lastAdaptiveSamplingReadbackIndex < adaptiveSamplingStatsReadbackBuffers.size()) {
+        readAdaptiveSamplingStats(lastAdaptiveSamplingReadbackIndex);
+    }
+}
+
+void VolumetricPathTracingPass::readAdaptiveSamplingStats(uint32_t readbackIndex) {
+    if (!resultImageView) {
+        return;
+    }
+    AdaptiveSamplingStatsData statsData{};
+    const sgl::vk::BufferPtr& readbackBuffer = adaptiveSamplingStatsReadbackBuffers.at(readbackIndex);
+    auto* mappedData = readbackBuffer->mapMemory();
+    memcpy(&statsData, mappedData, sizeof(AdaptiveSamplingStatsData));
+    readbackBuffer->unmapMemory();
+    if (statsData.accumulationIndex != adaptiveSamplingAccumulationIndex) {
+        // The buffer holds the data of an earlier accumulation.
+        return;
+    }
+
+    auto& imageSettings = resultImageView->getImage()->getImageSettings();
+    auto numPixels = double(imageSettings.width) * double(imageSettings.height);
+    auto numSamplesTraced =
+            double(uint64_t(statsData.numSamplesTracedHigh) << 32u | uint64_t(statsData.numSamplesTracedLow));
+    adaptiveSamplingStats.effectiveSpp = numSamplesTraced / numPixels;
+    adaptiveSamplingStats.convergedFraction = double(statsData.numConvergedPixels) / numPixels;
+    if (statsData.convergedFrameCount != 0 && adaptiveSamplingStats.numSamplesToThreshold < 0) {
+        adaptiveSamplingStats.numSamplesToThreshold = int64_t(statsData.convergedFrameCount);
+        auto it = adaptiveSamplingDispatchTimes.find(statsData.convergedFrameCount);
+        if (it != adaptiveSamplingDispatchTimes.end()) {
+            adaptiveSamplingStats.timeToThresholdSeconds =
+                    std::chrono::duration<double>(it->second - accumulationStartTime).count();
+        }
+        isAdaptiveSamplingConverged = true;
+    }
 }
 
 void VolumetricPathTracingPass::setPreviousViewProjMatrix(glm::mat4 previousViewProjectionMatrix) {
@@ -387,7 +680,11 @@ void VolumetricPathTracingPass::setPreviousViewProjMatrix(glm::mat4 previousView
 }
 
 void VolumetricPathTracingPass::setUseEmission(bool emission){
-    useEmission = emission;
+    if (useEmission != emission) {
+        useEmission = emission;
+        frameInfo.frameCount = 0;
+        setShaderDirty();
+    }
 }
 void VolumetricPathTracingPass::setEmissionStrength(float emissionStrength){
     this->emissionStrength = emissionStrength;
@@ -397,7 +694,10 @@ void VolumetricPathTracingPass::setEmissionCap(float emissionCap){
 }
 
 void VolumetricPathTracingPass::flipYZ(bool flip) {
-    this->flipYZCoordinates = flip;
+    if (flipYZCoordinates != flip) {
+        flipYZCoordinates = flip;
+        frameInfo.frameCount = 0;
+    }
 }
 
 void VolumetricPathTracingPass::setFileDialogInstance(ImGuiFileDialog* _fileDialogInstance) {
@@ -405,21 +705,28 @@ void VolumetricPathTracingPass::setFileDialogInstance(ImGuiFileDialog* _fileDial
 }
 
 void VolumetricPathTracingPass::onHasMoved() {
+    restartAccumulation();
+    hasMovedSinceLastFrame = true;
+}
+
+void VolumetricPathTracingPass::discardAccumulation() {
     frameInfo.frameCount = 0;
+    hasTemporalHistory = false;
+    reprojectTemporalHistory = false;
 }
 
 void VolumetricPathTracingPass::updateVptMode() {
     if (accumulationTimer && !reachedTarget) {
         createNewAccumulationTimer = true;
     }
-    if (vptMode == VptMode::RESIDUAL_RATIO_TRACKING && cloudData && !useSparseGrid) {
+    if (vptMode == VptMode::RESIDUAL_RATIO_TRACKING && cloudData && gridType != GridType::NANOVDB) {
         superVoxelGridDecompositionTracking = {};
         superVoxelGridResidualRatioTracking = std::make_shared<SuperVoxelGridResidualRatioTracking>(
                 device, cloudData->getGridSizeX(), cloudData->getGridSizeY(),
                 cloudData->getGridSizeZ(), cloudData->getDenseDensityField(),
                 superVoxelSize, clampToZeroBorder, gridInterpolationType);
         superVoxelGridResidualRatioTracking->setExtinction((cloudExtinctionBase * cloudExtinctionScale).x);
-    } else if (vptMode == VptMode::DECOMPOSITION_TRACKING && cloudData && !useSparseGrid) {
+    } else if (vptMode == VptMode::DECOMPOSITION_TRACKING && cloudData && gridType != GridType::NANOVDB) {
         superVoxelGridResidualRatioTracking = {};
         superVoxelGridDecompositionTracking = std::make_shared<SuperVoxelGridDecompositionTracking>(
                 device, cloudData->getGridSizeX(), cloudData->getGridSizeY(),
@@ -432,13 +739,21 @@ void VolumetricPathTracingPass::updateVptMode() {
 }
 
 void VolumetricPathTracingPass::setUseEnvironmentMapFlag(bool useEnvironmentMap) {
-    this->useEnvironmentMapImage = useEnvironmentMap;
+    if (useEnvironmentMapImage != useEnvironmentMap) {
+        useEnvironmentMapImage = useEnvironmentMap;
+        frameInfo.frameCount = 0;
+        setShaderDirty();
+    }
 }
 
 void VolumetricPathTracingPass::setEnvironmentMapIntensityFactor(float intensityFactor) {
     this->environmentMapIntensityFactor = intensityFactor;
 }
 
+void VolumetricPathTracingPass::setSunlightIntensity(float intensity) {
+    this->sunlightIntensity = intensity;
+}
+
 void VolumetricPathTracingPass::setScatteringAlbedo(glm::vec3 albedo) {
     this->cloudScatteringAlbedo = albedo;
 }
@@ -459,18 +774,17 @@ void VolumetricPathTracingPass::setFeatureMapType(FeatureMapTypeVpt type) {
 }
 
 
-void VolumetricPathTracingPass::createEnvironmentMapOctahedralTexture(uint32_t mip_levels) {
+void VolumetricPathTracingPass::createEnvironmentMapOctahedralTexture(
+        uint32_t resolutionLog2, std::vector<EnvironmentMapAliasTableEntry>& aliasTable) {
     sgl::vk::Device* device = sgl::AppSettings::get()->getPrimaryDevice();
 
     sgl::vk::ImageSettings imageSettings;
     imageSettings.imageType = VK_IMAGE_TYPE_2D;
-    imageSettings.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
-            | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL | VK_IMAGE_USAGE_STORAGE_BIT;
-    
-    // Resolution of 2^mip_level
-    imageSettings.width = 1 << mip_levels;
-    imageSettings.height = 1 << mip_levels;
-    imageSettings.mipLevels = mip_levels;
+    imageSettings.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+
+    // Resolution of 2^resolutionLog2
+    imageSettings.width = 1 << resolutionLog2;
+    imageSettings.height = 1 << resolutionLog2;
     imageSettings.format = VK_FORMAT_R32_SFLOAT;
 
     sgl::vk::ImageSamplerSettings samplerSettings;
@@ -480,6 +794,9 @@ void VolumetricPathTracingPass::createEnvironmentMapOctahedralTexture(uint32_t m
     equalAreaPass->setInputImage(environmentMapTexture);
     equalAreaPass->setOutputImage(environmentMapOctahedralTexture->getImageView());
 
+    uint32_t numTexels = imageSettings.width * imageSettings.height;
+    sgl::vk::BufferPtr stagingBuffer = std::make_shared<sgl::vk::Buffer>(
+            device, sizeof(float) * numTexels, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
 
     VkCommandBuffer commandBuffer = device->beginSingleTimeCommands(0xFFFFFFFF, false);
     renderer->setCustomCommandBuffer(commandBuffer);
@@ -489,13 +806,81 @@ void VolumetricPathTracingPass::createEnvironmentMapOctahedralTexture(uint32_t m
     renderer->transitionImageLayout(environmentMapTexture->getImage(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
     renderer->transitionImageLayout(environmentMapOctahedralTexture->getImage(), VK_IMAGE_LAYOUT_GENERAL);
     equalAreaPass->render();
-    renderer->transitionImageLayout(environmentMapOctahedralTexture->getImage(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-    
-    environmentMapOctahedralTexture->getImage()->generateMipmaps(commandBuffer);
+    renderer->transitionImageLayout(environmentMapOctahedralTexture->getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    environmentMapOctahedralTexture->getImage()->copyToBuffer(stagingBuffer, commandBuffer);
 
     renderer->endCommandBuffer();
     renderer->resetCustomCommandBuffer();
     device->endSingleTimeCommands(commandBuffer, 0xFFFFFFFF, false);
+
+    auto* brightnessData = reinterpret_cast<float*>(stagingBuffer->mapMemory());
+    createEnvironmentMapAliasTable(brightnessData, numTexels, aliasTable);
+    stagingBuffer->unmapMemory();
+}
+
+/**
+ * Builds an alias table (using Vose's method) over the texels of the equal-area octahedral environment map.
+ * Sampling a texel then only needs a single buffer access, and so does evaluating the PDF of a direction.
+ * Like the previous hierarchical sampling, a small constant is added to the brightness of each texel so that all
+ * directions can be sampled.
+ */
+void VolumetricPathTracingPass::createEnvironmentMapAliasTable(
+        const float* brightnessData, uint32_t numTexels, std::vector<EnvironmentMapAliasTableEntry>& aliasTable) {
+    std::vector<double> scaledProbabilities(numTexels);
+    double weightSum = 0.0;
+    for (uint32_t i = 0; i < numTexels; i++) {
+        double weight = double(std::max(brightnessData[i], 0.0f)) + 0.001;
+        scaledProbabilities[i] = weight;
+        weightSum += weight;
+    }
+
+    aliasTable.resize(numTexels);
+    std::vector<uint32_t> smallEntries, largeEntries;
+    for (uint32_t i = 0; i < numTexels; i++) {
+        aliasTable[i].pdf = float(scaledProbabilities[i] / weightSum);
+        scaledProbabilities[i] = scaledProbabilities[i] / weightSum * double(numTexels);
+        if (scaledProbabilities[i] < 1.0) {
+            smallEntries.push_back(i);
+        } else {
+            largeEntries.push_back(i);
+        }
+    }
+    while (!smallEntries.empty() && !largeEntries.empty()) {
+        uint32_t smallIdx = smallEntries.back();
+        smallEntries.pop_back();
+        uint32_t largeIdx = largeEntries.back();
+        largeEntries.pop_back();
+        aliasTable[smallIdx].probability = float(scaledProbabilities[smallIdx]);
+        aliasTable[smallIdx].alias = largeIdx;
+        scaledProbabilities[largeIdx] = (scaledProbabilities[largeIdx] + scaledProbabilities[smallIdx]) - 1.0;
+        if (scaledProbabilities[largeIdx] < 1.0) {
+            smallEntries.push_back(largeIdx);
+        } else {
+            largeEntries.push_back(largeIdx);
+        }
+    }
+    // Entries left over due to rounding errors are always kept.
+    for (uint32_t i : largeEntries) {
+        aliasTable[i].probability = 1.0f;
+        aliasTable[i].alias = i;
+    }
+    for (uint32_t i : smallEntries) {
+        aliasTable[i].probability = 1.0f;
+        aliasTable[i].alias = i;
+    }
+    for (uint32_t i = 0; i < numTexels; i++) {
+        aliasTable[i].aliasPdf = aliasTable[aliasTable[i].alias].pdf;
+    }
+}
+
+/**
+ * The importance map only needs to resolve the brightness distribution coarsely, so it uses about half of the
+ * resolution of the source image per axis (clamped to 64^2 to 2048^2 texels).
+ */
+static uint32_t getEnvironmentMapImportanceResolutionLog2(uint32_t width, uint32_t height) {
+    double sideLength = std::sqrt(double(width) * double(height)) * 0.5;
+    auto resolutionLog2 = int(std::ceil(std::log2(std::max(sideLength, 1.0))));
+    return uint32_t(std::clamp(resolutionLog2, 6, 11));
 }
 
 void VolumetricPathTracingPass::loadEnvironmentMapImage(const std::string& filename) {
@@ -506,6 +891,9 @@ void VolumetricPathTracingPass::loadEnvironmentMapImage(const std::string& filen
         return;
     }
 
+    std::string cacheKey;
+    bool useCache = useEnvironmentMapDiskCache && environmentMapCache->computeSourceKey(filename, cacheKey);
+
     bool newEnvMapImageUsesLinearRgb = true;
     sgl::BitmapPtr bitmap;
 #ifdef SUPPORT_OPENEXR
@@ -518,7 +906,31 @@ void VolumetricPathTracingPass::loadEnvironmentMapImage(const std::string& filen
     }
 #ifdef SUPPORT_OPENEXR
     else if (sgl::FileUtils::get()->hasExtension(filename.c_str(), ".exr")) {
-        bool isLoaded = loadOpenExrImageFile(filename, imageInfo);
+        bool isLoaded = false;
+        std::vector<uint8_t> cachedImageData;
+        const size_t headerSize = 2 * sizeof(uint32_t);
+        if (useCache && environmentMapCache->loadEntry(cacheKey, "decoded", cachedImageData)
+                && cachedImageData.size() >= headerSize) {
+            uint32_t header[2];
+            memcpy(header, cachedImageData.data(), headerSize);
+            size_t numPixelValues = size_t(header[0]) * size_t(header[1]) * 4;
+            if (cachedImageData.size() == headerSize + numPixelValues * sizeof(uint16_t)) {
+                imageInfo.width = header[0];
+                imageInfo.height = header[1];
+                imageInfo.pixelData = new uint16_t[numPixelValues];
+                memcpy(imageInfo.pixelData, cachedImageData.data() + headerSize, numPixelValues * sizeof(uint16_t));
+                isLoaded = true;
+            }
+        }
+        if (!isLoaded) {
+            isLoaded = loadOpenExrImageFile(filename, imageInfo);
+            if (isLoaded && useCache) {
+                uint32_t header[2] = { imageInfo.width, imageInfo.height };
+                environmentMapCache->storeEntry(
+                        cacheKey, "decoded", header, headerSize, imageInfo.pixelData,
+                        size_t(imageInfo.width) * size_t(imageInfo.height) * 4 * sizeof(uint16_t));
+            }
+        }
         if (!isLoaded) {
             sgl::Logfile::get()->writeError(
                     "Error in VolumetricPathTracingPass::loadEnvironmentMapImage: The file \""
@@ -572,10 +984,7 @@ void VolumetricPathTracingPass::loadEnvironmentMapImage(const std::string& filen
     isEnvironmentMapLoaded = true;
     frameInfo.frameCount = 0;
 
-    if (envMapImageUsesLinearRgb != newEnvMapImageUsesLinearRgb) {
-        envMapImageUsesLinearRgb = newEnvMapImageUsesLinearRgb;
-        setShaderDirty();
-    }
+    envMapImageUsesLinearRgb = newEnvMapImageUsesLinearRgb;
 
 #ifdef SUPPORT_OPENEXR
     if (!bitmap) {
@@ -583,47 +992,92 @@ void VolumetricPathTracingPass::loadEnvironmentMapImage(const std::string& filen
     }
 #endif
 
-    createEnvironmentMapOctahedralTexture(12);
+    // The resolution of the importance map is passed to the shader in the uniform data, so no recompilation is needed.
+    uint32_t resolutionLog2 = getEnvironmentMapImportanceResolutionLog2(width, height);
+    environmentMapAliasTableResolutionLog2 = resolutionLog2;
+    uint32_t numTexels = 1u << (2 * resolutionLog2);
+    std::string aliasTableEntryName = "alias_table_" + std::to_string(1u << resolutionLog2);
+    std::vector<EnvironmentMapAliasTableEntry> aliasTable;
+    std::vector<uint8_t> cachedAliasTableData;
+    if (useCache && environmentMapCache->loadEntry(cacheKey, aliasTableEntryName, cachedAliasTableData)
+            && cachedAliasTableData.size() == numTexels * sizeof(EnvironmentMapAliasTableEntry)) {
+        aliasTable.resize(numTexels);
+        memcpy(aliasTable.data(), cachedAliasTableData.data(), cachedAliasTableData.size());
+    } else {
+        createEnvironmentMapOctahedralTexture(resolutionLog2, aliasTable);
+        if (useCache) {
+            environmentMapCache->storeEntry(
+                    cacheKey, aliasTableEntryName, nullptr, 0, aliasTable.data(),
+                    aliasTable.size() * sizeof(EnvironmentMapAliasTableEntry));
+        }
+    }
+    environmentMapAliasTableBuffer = std::make_shared<sgl::vk::Buffer>(
+            device, sizeof(EnvironmentMapAliasTableEntry) * numTexels, aliasTable.data(),
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VMA_MEMORY_USAGE_GPU_ONLY);
+    setDataDirty();
 }
 
-void VolumetricPathTracingPass::loadShader() {
-    sgl::vk::ShaderManager->invalidateShaderCache();
-    std::map<std::string, std::string> customPreprocessorDefines;
-    if (customSeedOffset != 0) {
-        customPreprocessorDefines.insert({ "CUSTOM_SEED_OFFSET", std::to_string(customSeedOffset) });
-    }
-    if (vptMode == VptMode::DELTA_TRACKING) {
-        customPreprocessorDefines.insert({ "USE_DELTA_TRACKING", "" });
-    } else if (vptMode == VptMode::SPECTRAL_DELTA_TRACKING) {
-        customPreprocessorDefines.insert({ "USE_SPECTRAL_DELTA_TRACKING", "" });
+void VolumetricPathTracingPass::addVptModePreprocessorDefines(
+        VptMode mode, std::map<std::string, std::string>& preprocessorDefines) {
+    if (mode == VptMode::DELTA_TRACKING) {
+        preprocessorDefines.insert({ "USE_DELTA_TRACKING", "" });
+    } else if (mode == VptMode::SPECTRAL_DELTA_TRACKING) {
+        preprocessorDefines.insert({ "USE_SPECTRAL_DELTA_TRACKING", "" });
         if (sdtCollisionProbability == SpectralDeltaTrackingCollisionProbability::MAX_BASED) {
-            customPreprocessorDefines.insert({ "MAX_BASED_PROBABILITY", "" });
+            preprocessorDefines.insert({ "MAX_BASED_PROBABILITY", "" });
         } else if (sdtCollisionProbability == SpectralDeltaTrackingCollisionProbability::AVG_BASED) {
-            customPreprocessorDefines.insert({ "AVG_BASED_PROBABILITY", "" });
+            preprocessorDefines.insert({ "AVG_BASED_PROBABILITY", "" });
         } else { // SpectralDeltaTrackingCollisionProbability::PATH_HISTORY_AVG_BASED
-            customPreprocessorDefines.insert({ "PATH_HISTORY_AVG_BASED_PROBABILITY", "" });
-        }
-    } else if (vptMode == VptMode::RATIO_TRACKING) {
-        customPreprocessorDefines.insert({ "USE_RATIO_TRACKING", "" });
-    } else if (vptMode == VptMode::RESIDUAL_RATIO_TRACKING) {
-        customPreprocessorDefines.insert({ "USE_RESIDUAL_RATIO_TRACKING", "" });
-    } else if (vptMode == VptMode::DECOMPOSITION_TRACKING) {
-        customPreprocessorDefines.insert({ "USE_DECOMPOSITION_TRACKING", "" });
-    }else if (vptMode == VptMode::NEXT_EVENT_TRACKING) {
-        customPreprocessorDefines.insert({ "USE_NEXT_EVENT_TRACKING", "" });
-    } else if (vptMode == VptMode::NEXT_EVENT_TRACKING_SPECTRAL) {
-        customPreprocessorDefines.insert({ "USE_NEXT_EVENT_TRACKING_SPECTRAL", "" });
-    }
-    if (gridInterpolationType == GridInterpolationType::NEAREST) {
-        customPreprocessorDefines.insert({ "GRID_INTERPOLATION_NEAREST", "" });
-    } else if (gridInterpolationType == GridInterpolationType::STOCHASTIC) {
-        customPreprocessorDefines.insert({ "GRID_INTERPOLATION_STOCHASTIC", "" });
-    } else if (gridInterpolationType == GridInterpolationType::TRILINEAR) {
-        customPreprocessorDefines.insert({ "GRID_INTERPOLATION_TRILINEAR", "" });
-    }
-    if (useSparseGrid) {
-        customPreprocessorDefines.insert({ "USE_NANOVDB", "" });
+            preprocessorDefines.insert({ "PATH_HISTORY_AVG_BASED_PROBABILITY", "" });
+        }
+    } else if (mode == VptMode::RATIO_TRACKING) {
+        preprocessorDefines.insert({ "USE_RATIO_TRACKING", "" });
+    } else if (mode == VptMode::RESIDUAL_RATIO_TRACKING) {
+        preprocessorDefines.insert({ "USE_RESIDUAL_RATIO_TRACKING", "" });
+    } else if (mode == VptMode::DECOMPOSITION_TRACKING) {
+        preprocessorDefines.insert({ "USE_DECOMPOSITION_TRACKING", "" });
+    } else if (mode == VptMode::NEXT_EVENT_TRACKING) {
+        preprocessorDefines.insert({ "USE_NEXT_EVENT_TRACKING", "" });
+    } else if (mode == VptMode::NEXT_EVENT_TRACKING_SPECTRAL) {
+        preprocessorDefines.insert({ "USE_NEXT_EVENT_TRACKING_SPECTRAL", "" });
+    } else if (mode == VptMode::FEATURE_MAPS_ONLY) {
+        preprocessorDefines.insert({ "USE_FEATURE_MAPS_ONLY", "" });
+    }
+}
+
+void VolumetricPathTracingPass::addGridPreprocessorDefines(
+        GridType type, GridInterpolationType interpolationType,
+        std::map<std::string, std::string>& preprocessorDefines) {
+    if (interpolationType == GridInterpolationType::NEAREST) {
+        preprocessorDefines.insert({ "GRID_INTERPOLATION_NEAREST", "" });
+    } else if (interpolationType == GridInterpolationType::STOCHASTIC) {
+        preprocessorDefines.insert({ "GRID_INTERPOLATION_STOCHASTIC", "" });
+    } else if (interpolationType == GridInterpolationType::TRILINEAR) {
+        preprocessorDefines.insert({ "GRID_INTERPOLATION_TRILINEAR", "" });
+    }
+    if (type == GridType::NANOVDB) {
+        preprocessorDefines.insert({ "USE_NANOVDB", "" });
+    } else if (type == GridType::BRICK_MAP) {
+        preprocessorDefines.insert({ "USE_BRICK_MAP", "" });
     }
+}
+
+std::map<std::string, std::string> VolumetricPathTracingPass::getVariantPreprocessorDefines(
+        const std::map<std::string, std::string>& baseDefines,
+        VptMode mode, GridType type, GridInterpolationType interpolationType) {
+    std::map<std::string, std::string> preprocessorDefines = baseDefines;
+    addGridPreprocessorDefines(type, interpolationType, preprocessorDefines);
+    addVptModePreprocessorDefines(mode, preprocessorDefines);
+    if (getIsSunTransmittanceVolumeActive(mode, type)) {
+        preprocessorDefines.insert({ "USE_SUN_TRANSMITTANCE_VOLUME", "" });
+    }
+    return preprocessorDefines;
+}
+
+void VolumetricPathTracingPass::loadShader() {
+    // Defines that do not depend on the VPT mode, the grid type or the grid interpolation type.
+    std::map<std::string, std::string> customPreprocessorDefines;
     if (useEmission && (emissionFieldTexture || emissionNanoVdbBuffer)) {
         customPreprocessorDefines.insert({ "USE_EMISSION", "" });
     }
@@ -648,21 +1102,25 @@ void VolumetricPathTracingPass::loadShader() {
     if (useEnvironmentMapImage) {
         customPreprocessorDefines.insert({ "USE_ENVIRONMENT_MAP_IMAGE", "" });
     }
-    if (uniformData.useLinearRGB) {
-        customPreprocessorDefines.insert({ "USE_LINEAR_RGB", "" });
+
+    if (useAdaptiveSampling) {
+        customPreprocessorDefines.insert({ "USE_ADAPTIVE_SAMPLING", "" });
     }
-    if (envMapImageUsesLinearRgb) {
-        customPreprocessorDefines.insert({ "ENV_MAP_IMAGE_USES_LINEAR_RGB", "" });
+    if (getIsTemporalAccumulationActive()) {
+        customPreprocessorDefines.insert({ "USE_TEMPORAL_ACCUMULATION", "" });
     }
-    if (flipYZCoordinates) {
-        customPreprocessorDefines.insert({ "FLIP_YZ", "" });
+    if (samplerType == VptSamplerType::SOBOL) {
+        customPreprocessorDefines.insert({ "USE_SAMPLER_SOBOL", "" });
+    } else if (samplerType == VptSamplerType::SOBOL_BLUE_NOISE) {
+        customPreprocessorDefines.insert({ "USE_SAMPLER_SOBOL_BLUE_NOISE", "" });
     }
 
     if (device->getPhysicalDeviceProperties().limits.maxComputeWorkGroupInvocations >= 1024) {
-        customPreprocessorDefines.insert({ "LOCAL_SIZE", "32" });
+        blockSize2D = glm::ivec2(32, 32);
     } else {
-        customPreprocessorDefines.insert({ "LOCAL_SIZE", "16" });
+        blockSize2D = glm::ivec2(16, 16);
     }
+    customPreprocessorDefines.insert({ "LOCAL_SIZE", std::to_string(blockSize2D.x) });
     sgl::TransferFunctionWindow* tfWindow = cloudData->getTransferFunctionWindow();
     bool useTransferFunction = tfWindow && tfWindow->getShowWindow();
     if (useTransferFunction) {
@@ -672,21 +1130,58 @@ void VolumetricPathTracingPass::loadShader() {
         useTransferFunctionCached = useTransferFunction;
         frameInfo.frameCount = 0;
     }
+    if (getIsSunTransmittanceVolumeActive()) {
+        sunTransmittancePass->setUseTransferFunction(useTransferFunction);
+    }
 
-    shaderStages = sgl::vk::ShaderManager->getShaderStages({"Clouds.Compute"}, customPreprocessorDefines);
+    shaderStages = shaderCache->getComputeShaderStages(
+            "Clouds.Compute", getVariantPreprocessorDefines(
+                    customPreprocessorDefines, vptMode, gridType, gridInterpolationType));
+
+    if (precompileShaderVariants) {
+        // Switching the VPT mode, the grid interpolation or the grid type are the most likely next changes, so
+        // compile the variants differing from the current one in one of these settings in the background.
+        std::vector<std::map<std::string, std::string>> variants;
+        for (int i = 0; i < IM_ARRAYSIZE(VPT_MODE_NAMES); i++) {
+            if (VptMode(i) != vptMode) {
+                variants.push_back(getVariantPreprocessorDefines(
+                        customPreprocessorDefines, VptMode(i), gridType, gridInterpolationType));
+            }
+        }
+        for (int i = 0; i < IM_ARRAYSIZE(GRID_INTERPOLATION_TYPE_NAMES); i++) {
+            if (GridInterpolationType(i) != gridInterpolationType) {
+                variants.push_back(getVariantPreprocessorDefines(
+                        customPreprocessorDefines, vptMode, gridType, GridInterpolationType(i)));
+            }
+        }
+        for (int i = 0; i < IM_ARRAYSIZE(GRID_TYPE_NAMES); i++) {
+            if (GridType(i) != gridType) {
+                variants.push_back(getVariantPreprocessorDefines(
+                        customPreprocessorDefines, vptMode, GridType(i), gridInterpolationType));
+            }
+        }
+        shaderCache->precompileComputeShaderVariantsAsync("Clouds.Compute", variants);
+    }
+}
+
+void VolumetricPathTracingPass::setComputePipelineInfo(sgl::vk::ComputePipelineInfo& pipelineInfo) {
+    pipelineInfo.setPipelineCache(shaderCache->getVkPipelineCache());
 }
 
 void VolumetricPathTracingPass::createComputeData(
         sgl::vk::Renderer* renderer, sgl::vk::ComputePipelinePtr& computePipeline) {
     computeData = std::make_shared<sgl::vk::ComputeData>(renderer, computePipeline);
     computeData->setStaticImageView(resultImageView, "resultImage");
-    if (useSparseGrid) {
+    if (gridType == GridType::NANOVDB) {
         computeData->setStaticBuffer(nanoVdbBuffer, "NanoVdbBuffer");
         if (useEmission && emissionNanoVdbBuffer){
             computeData->setStaticBuffer(emissionNanoVdbBuffer, "EmissionNanoVdbBuffer");
         }
     } else {
         computeData->setStaticTexture(densityFieldTexture, "gridImage");
+        if (gridType == GridType::BRICK_MAP) {
+            computeData->setStaticTexture(brickIndirectionTexture, "brickIndirectionImage");
+        }
         if (useEmission && emissionFieldTexture){
             std::cout << "setting emission image" << std::endl;
             computeData->setStaticTexture(emissionFieldTexture, "emissionImage");
@@ -718,10 +1213,22 @@ void VolumetricPathTracingPass::createComputeData(
     computeData->setStaticImageView(densityTexture->getImageView(), "densityImage");
     computeData->setStaticImageView(backgroundTexture->getImageView(), "backgroundImage");
     computeData->setStaticImageView(reprojUVTexture->getImageView(), "reprojUVImage");
+    if (useAdaptiveSampling) {
+        computeData->setStaticImageView(varianceTexture->getImageView(), "varianceImage");
+        computeData->setStaticBuffer(tileActiveBuffer, "TileActiveBuffer");
+        computeData->setStaticBuffer(adaptiveSamplingStatsBuffer, "AdaptiveSamplingStatsBuffer");
+    }
+    if (getIsTemporalAccumulationActive()) {
+        computeData->setStaticImageView(temporalPositionTexture->getImageView(), "temporalPositionImage");
+        computeData->setStaticImageView(temporalSampleInfoTexture->getImageView(), "temporalSampleInfoImage");
+        computeData->setStaticImageView(historyAccTexture->getImageView(), "historyAccImage");
+        computeData->setStaticImageView(historyPositionTexture->getImageView(), "historyPositionImage");
+        computeData->setStaticImageView(historySampleInfoTexture->getImageView(), "historySampleInfoImage");
+    }
 
     if (useEnvironmentMapImage) {
         computeData->setStaticTexture(environmentMapTexture, "environmentMapTexture");
-        computeData->setStaticTexture(environmentMapOctahedralTexture, "environmentMapOctahedralTexture");
+        computeData->setStaticBuffer(environmentMapAliasTableBuffer, "EnvironmentMapAliasTableBuffer");
     }
     if (blitPrimaryRayMomentTexturePass->getMomentType() != BlitMomentTexturePass::MomentType::NONE) {
         computeData->setStaticImageView(
@@ -734,6 +1241,13 @@ void VolumetricPathTracingPass::createComputeData(
                 "scatterRayAbsorptionMomentsImage");
     }
     computeData->setStaticBuffer(momentUniformDataBuffer, "MomentUniformData");
+    if (getIsSunTransmittanceVolumeActive()) {
+        if (isSunTransmittanceDataDirty) {
+            sunTransmittancePass->setDensityField(cloudData, densityFieldTexture);
+            isSunTransmittanceDataDirty = false;
+        }
+        computeData->setStaticTexture(sunTransmittancePass->getTransmittanceTexture(), "sunTransmittanceVolume");
+    }
 
 
     sgl::TransferFunctionWindow* tfWindow = cloudData->getTransferFunctionWindow();
@@ -743,7 +1257,8 @@ void VolumetricPathTracingPass::createComputeData(
 }
 
 std::string VolumetricPathTracingPass::getCurrentEventName() {
-    return std::string() + VPT_MODE_NAMES[int(vptMode)] + " " + std::to_string(targetNumSamples) + "spp";
+    return std::string() + VPT_MODE_NAMES[int(vptMode)] + " (" + GRID_TYPE_NAMES[int(gridType)] + ") "
+            + std::to_string(targetNumSamples) + "spp";
 }
 
 void VolumetricPathTracingPass::_render() {
@@ -783,9 +1298,16 @@ void VolumetricPathTracingPass::_render() {
         accumulationTimer->startGPU(eventName);
     }
 
+    // While the camera is moving, blocks of pixels are traced at reduced resolution and the result is upsampled.
+    const bool isInteractionFrame =
+            getIsProgressiveResolutionActive() && hasMovedSinceLastFrame && interactionPixelStride > 1
+            && frameInfo.frameCount == 0;
+    hasMovedSinceLastFrame = false;
+
     if (!changedDenoiserSettings && !timerStopped) {
         uniformData.inverseViewProjMatrix = glm::inverse(
                 (*camera)->getProjectionMatrix() * (*camera)->getViewMatrix());
+        uniformData.historyViewProjMatrix = temporalHistoryViewProjMatrix;
 
         uniformData.previousViewProjMatrix = previousViewProjMatrix;
         if (previousViewProjMatrix[3][3] == 0){
@@ -812,7 +1334,7 @@ void VolumetricPathTracingPass::_render() {
         }
         uniformData.gridMin = cloudData->getWorldSpaceGridMin();
         uniformData.gridMax = cloudData->getWorldSpaceGridMax();
-        if (!useSparseGrid){
+        if (gridType != GridType::NANOVDB){
             uniformData.gridMin = glm::vec3 (0,0,0);
             uniformData.gridMax = glm::vec3 (1,1,1);
         }
@@ -825,7 +1347,24 @@ void VolumetricPathTracingPass::_render() {
         uniformData.sunIntensity = sunlightIntensity * sunlightColor;
         uniformData.environmentMapIntensityFactor = environmentMapIntensityFactor;
         uniformData.numFeatureMapSamplesPerFrame = numFeatureMapSamplesPerFrame;
-        if (useSparseGrid) {
+        uniformData.adaptiveSamplingErrorThreshold = adaptiveSamplingErrorThreshold;
+        uniformData.adaptiveSamplingMinNumSamples = adaptiveSamplingMinNumSamples;
+        uniformData.featureMapWriteMask = getFeatureMapWriteMask();
+        if (isInteractionFrame) {
+            // Guides the upsampling filter.
+            uniformData.featureMapWriteMask |= 1u << uint32_t(FeatureMapTypeVpt::DEPTH);
+        }
+        uniformData.featureMapSampleLimit = featureMapSampleLimit;
+        uniformData.customSeedOffset = customSeedOffset;
+        uniformData.flipYZ = flipYZCoordinates ? 1 : 0;
+        uniformData.envMapImageUsesLinearRgb = envMapImageUsesLinearRgb ? 1 : 0;
+        uniformData.environmentMapAliasTableSize = 1u << environmentMapAliasTableResolutionLog2;
+        uniformData.gridResolution = glm::ivec3(
+                cloudData->getGridSizeX(), cloudData->getGridSizeY(), cloudData->getGridSizeZ());
+        uniformData.temporalPositionTolerance = temporalPositionTolerance;
+        uniformData.temporalDensityTolerance = temporalDensityTolerance;
+        uniformData.temporalMaxHistoryLength = temporalMaxHistoryLength;
+        if (gridType == GridType::NANOVDB) {
             if (cloudData->getGridSizeX() >= 8 && cloudData->getGridSizeY() >= 8 && cloudData->getGridSizeZ() >= 8) {
                 uniformData.superVoxelSize = glm::ivec3(8);
             } else {
@@ -841,19 +1380,124 @@ void VolumetricPathTracingPass::_render() {
         uniformBuffer->updateData(
                 sizeof(UniformData), &uniformData, renderer->getVkCommandBuffer());
 
+        // Clamp the last dispatch so that the accumulation stops exactly at the target number of samples.
+        frameInfo.numSamples = uint32_t(std::max(numSamplesPerDispatch, 1));
+        if (!reachedTarget) {
+            frameInfo.numSamples = std::min(frameInfo.numSamples, uint32_t(targetNumSamples) - frameInfo.frameCount);
+        }
+        frameInfo.pixelStride = 1;
+        if (isInteractionFrame) {
+            frameInfo.numSamples = uint32_t(interactionNumSamples);
+            frameInfo.pixelStride = uint32_t(interactionPixelStride);
+        }
+        // The first dispatch of an accumulation covers the whole image and fills the background pixels, all following
+        // dispatches only cover the projected bounds of the cloud box. The setters of the camera and the lighting do
+        // not necessarily restart the accumulation, so a change of them also leads to a dispatch over the whole image.
+        auto& imageSettings = resultImageView->getImage()->getImageSettings();
+        const bool isFirstDispatch = frameInfo.frameCount == 0;
+        BackgroundCoverageState coverageState;
+        coverageState.viewProjectionMatrix = (*camera)->getProjectionMatrix() * (*camera)->getViewMatrix();
+        coverageState.boxMin = uniformData.boxMin;
+        coverageState.boxMax = uniformData.boxMax;
+        coverageState.emissionBoxMin = uniformData.emissionBoxMin;
+        coverageState.emissionBoxMax = uniformData.emissionBoxMax;
+        coverageState.sunDirection = uniformData.sunDirection;
+        coverageState.sunIntensity = uniformData.sunIntensity;
+        coverageState.environmentMapIntensityFactor = uniformData.environmentMapIntensityFactor;
+        coverageState.useEmission = useEmission;
+        const bool isFullFrameDispatch = isFirstDispatch || coverageState != backgroundCoverageState;
+        if (isFullFrameDispatch) {
+            backgroundCoverageState = coverageState;
+            updateCoveredPixels(
+                    coverageState.viewProjectionMatrix, int(imageSettings.width), int(imageSettings.height));
+            frameInfo.pixelOffset = glm::ivec2(0);
+        } else {
+            frameInfo.pixelOffset = frameInfo.coveredPixelsMin;
+        }
+        const glm::ivec2 dispatchSize =
+                isFullFrameDispatch ? glm::ivec2(imageSettings.width, imageSettings.height)
+                : frameInfo.coveredPixelsMax - frameInfo.coveredPixelsMin;
+        if (getIsSunTransmittanceVolumeActive()) {
+            updateSunTransmittanceVolume();
+        }
+        const bool isTemporalAccumulationActive = getIsTemporalAccumulationActive();
+        frameInfo.reprojectHistory =
+                isTemporalAccumulationActive && reprojectTemporalHistory && frameInfo.frameCount == 0 ? 1 : 0;
+        reprojectTemporalHistory = false;
         frameInfoBuffer->updateData(
                 sizeof(FrameInfo), &frameInfo, renderer->getVkCommandBuffer());
-        frameInfo.frameCount++;
+        uint32_t adaptiveSamplingReadbackIndex = 0;
+        if (useAdaptiveSampling) {
+            sgl::vk::Swapchain* swapchain = sgl::AppSettings::get()->getSwapchain();
+            size_t numImages = swapchain ? swapchain->getNumImages() : 1;
+            adaptiveSamplingReadbackIndex = swapchain ? swapchain->getImageIndex() : 0;
+            if (adaptiveSamplingStatsReadbackBuffers.size() != numImages) {
+                AdaptiveSamplingStatsData zeroData{};
+                adaptiveSamplingStatsReadbackBuffers.clear();
+                for (size_t i = 0; i < numImages; i++) {
+                    adaptiveSamplingStatsReadbackBuffers.push_back(std::make_shared<sgl::vk::Buffer>(
+                            device, sizeof(AdaptiveSamplingStatsData), &zeroData,
+                            VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU));
+                }
+                lastAdaptiveSamplingReadbackIndex = std::numeric_limits<uint32_t>::max();
+            }
+            // The swapchain waited for the fence of the last frame using this image, so its copy has finished. If the
+            // pass is rendered more than once per frame, the buffer was written by this frame and is not read yet.
+            if (swapchain && adaptiveSamplingReadbackIndex != lastAdaptiveSamplingReadbackIndex) {
+                readAdaptiveSamplingStats(adaptiveSamplingReadbackIndex);
+            }
+        }
+        if (useAdaptiveSampling && frameInfo.frameCount == 0) {
+            adaptiveSamplingAccumulationIndex++;
+            AdaptiveSamplingStatsData statsData{};
+            statsData.accumulationIndex = adaptiveSamplingAccumulationIndex;
+            adaptiveSamplingStatsBuffer->updateData(
+                    sizeof(AdaptiveSamplingStatsData), &statsData, renderer->getVkCommandBuffer());
+            adaptiveSamplingStats = {};
+            isAdaptiveSamplingConverged = false;
+            adaptiveSamplingDispatchTimes.clear();
+            accumulationStartTime = std::chrono::steady_clock::now();
+        }
+        // Once all pixels converged, further dispatches of the accumulation would not change the image.
+        const bool isAdaptiveSamplingDone = useAdaptiveSampling && isAdaptiveSamplingConverged;
+        if (!isInteractionFrame) {
+            // The samples of interaction frames are not part of the full resolution accumulation.
+            frameInfo.frameCount += frameInfo.numSamples;
+        }
+        if (useAdaptiveSampling && !isAdaptiveSamplingDone) {
+            adaptiveSamplingDispatchTimes[frameInfo.frameCount] = std::chrono::steady_clock::now();
+        }
 
         renderer->insertMemoryBarrier(
-                VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_UNIFORM_READ_BIT,
+                VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
                 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
 
+        if (frameInfo.reprojectHistory) {
+            // The shader reads the history at reprojected positions, so it cannot be updated in place.
+            const std::pair<sgl::vk::TexturePtr, sgl::vk::TexturePtr> historyCopies[] = {
+                    { accImageTexture, historyAccTexture },
+                    { temporalPositionTexture, historyPositionTexture },
+                    { temporalSampleInfoTexture, historySampleInfoTexture },
+            };
+            for (const auto& historyCopy : historyCopies) {
+                renderer->transitionImageLayout(
+                        historyCopy.first->getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+                renderer->transitionImageLayout(
+                        historyCopy.second->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+                historyCopy.first->getImage()->copyToImage(
+                        historyCopy.second->getImage(), VK_IMAGE_ASPECT_COLOR_BIT, renderer->getVkCommandBuffer());
+            }
+        }
+
         renderer->transitionImageLayout(resultImageView->getImage(), VK_IMAGE_LAYOUT_GENERAL);
-        if (!useSparseGrid) {
+        if (gridType != GridType::NANOVDB) {
             renderer->transitionImageLayout(
                     densityFieldTexture->getImage(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
         }
+        if (gridType == GridType::BRICK_MAP) {
+            renderer->transitionImageLayout(
+                    brickIndirectionTexture->getImage(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        }
         renderer->transitionImageLayout(accImageTexture->getImage(), VK_IMAGE_LAYOUT_GENERAL);
         renderer->transitionImageLayout(firstXTexture->getImage(), VK_IMAGE_LAYOUT_GENERAL);
         renderer->transitionImageLayout(firstWTexture->getImage(), VK_IMAGE_LAYOUT_GENERAL);
@@ -863,22 +1507,67 @@ void VolumetricPathTracingPass::_render() {
         renderer->transitionImageLayout(reprojUVTexture->getImage(), VK_IMAGE_LAYOUT_GENERAL);
         renderer->transitionImageLayout(depthTexture->getImage(), VK_IMAGE_LAYOUT_GENERAL);
         renderer->transitionImageLayout(densityTexture->getImage(), VK_IMAGE_LAYOUT_GENERAL);
+        if (useAdaptiveSampling) {
+            renderer->transitionImageLayout(varianceTexture->getImage(), VK_IMAGE_LAYOUT_GENERAL);
+        }
+        if (isTemporalAccumulationActive) {
+            renderer->transitionImageLayout(temporalPositionTexture->getImage(), VK_IMAGE_LAYOUT_GENERAL);
+            renderer->transitionImageLayout(temporalSampleInfoTexture->getImage(), VK_IMAGE_LAYOUT_GENERAL);
+            renderer->transitionImageLayout(historyAccTexture->getImage(), VK_IMAGE_LAYOUT_GENERAL);
+            renderer->transitionImageLayout(historyPositionTexture->getImage(), VK_IMAGE_LAYOUT_GENERAL);
+            renderer->transitionImageLayout(historySampleInfoTexture->getImage(), VK_IMAGE_LAYOUT_GENERAL);
+        }
+        hasTemporalHistory = isTemporalAccumulationActive;
+        if (isTemporalAccumulationActive) {
+            temporalHistoryViewProjMatrix = (*camera)->getProjectionMatrix() * (*camera)->getViewMatrix();
+        }
         renderer->transitionImageLayout(
                 blitPrimaryRayMomentTexturePass->getMomentTexture()->getImage(), VK_IMAGE_LAYOUT_GENERAL);
         renderer->transitionImageLayout(
                 blitScatterRayMomentTexturePass->getMomentTexture()->getImage(), VK_IMAGE_LAYOUT_GENERAL);
-        auto& imageSettings = resultImageView->getImage()->getImageSettings();
-        renderer->dispatch(
-                computeData,
-                sgl::iceil(int(imageSettings.width), blockSize2D.x),
-                sgl::iceil(int(imageSettings.height), blockSize2D.y),
-                1);
+        const auto pixelStride = int(frameInfo.pixelStride);
+        if (dispatchSize.x > 0 && dispatchSize.y > 0 && !isAdaptiveSamplingDone) {
+            renderer->dispatch(
+                    computeData,
+                    sgl::iceil(sgl::iceil(dispatchSize.x, pixelStride), blockSize2D.x),
+                    sgl::iceil(sgl::iceil(dispatchSize.y, pixelStride), blockSize2D.y),
+                    1);
+        }
+
+        if (isInteractionFrame || isBlendingInteractionResult) {
+            if (isInteractionFrame) {
+                interactionUpsamplingPass->setPixelStride(pixelStride);
+                isBlendingInteractionResult = true;
+            } else {
+                // Fade out the last upsampled image until the accumulation has as many samples per pixel.
+                float blendWeight = std::min(float(frameInfo.frameCount) / float(interactionNumSamples), 1.0f);
+                interactionUpsamplingPass->setPixelStride(1);
+                interactionUpsamplingPass->setBlendWeight(blendWeight);
+                isBlendingInteractionResult = blendWeight < 1.0f;
+                reRender = reRender || isBlendingInteractionResult;
+            }
+            renderer->insertMemoryBarrier(
+                    VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+            interactionUpsamplingPass->render();
+        }
+
+        if (useAdaptiveSampling && !isAdaptiveSamplingDone) {
+            renderer->insertMemoryBarrier(
+                    VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+            adaptiveSamplingStatsBuffer->copyDataTo(
+                    adaptiveSamplingStatsReadbackBuffers.at(adaptiveSamplingReadbackIndex),
+                    renderer->getVkCommandBuffer());
+            lastAdaptiveSamplingReadbackIndex = adaptiveSamplingReadbackIndex;
+        }
     }
     changedDenoiserSettings = false;
     timerStopped = false;
 
     if (featureMapType == FeatureMapTypeVpt::RESULT) {
-        if (useDenoiser && denoiser && denoiser->getIsEnabled()) {
+        // The feature maps of interaction frames are only valid for one pixel per block.
+        if (useDenoiser && denoiser && denoiser->getIsEnabled() && !isInteractionFrame) {
             if (!reachedTarget){
                 denoiseTimer->startGPU("denoise");
                 accumulationTimer->startGPU("denoise");
@@ -1044,6 +1733,84 @@ bool VolumetricPathTracingPass::renderGuiPropertyEditorNodes(sgl::PropertyEditor
 
         propertyEditor.addCustomWidgets("#Feature Samples");
         ImGui::InputInt("##samplesPerFrame", &numFeatureMapSamplesPerFrame);
+        if (propertyEditor.addSliderInt("Feature Sample Limit", &featureMapSampleLimit, 0, 256)) {
+            optionChanged = true;
+        }
+        if (propertyEditor.addCheckbox("Only Denoiser Features", &onlyUpdateDenoiserFeatureMaps)) {
+            optionChanged = true;
+        }
+
+        if (propertyEditor.addSliderInt("#Samples/Dispatch", &numSamplesPerDispatch, 1, 64)) {
+            reRender = true;
+        }
+
+        if (propertyEditor.addCheckbox("Adaptive Sampling", &useAdaptiveSampling)) {
+            setShaderDirty();
+            optionChanged = true;
+        }
+        if (useAdaptiveSampling) {
+            if (propertyEditor.addSliderFloat(
+                    "Error Threshold", &adaptiveSamplingErrorThreshold, 0.001f, 0.1f, "%.4f")) {
+                optionChanged = true;
+            }
+            if (propertyEditor.addSliderInt("Min. #Samples", &adaptiveSamplingMinNumSamples, 1, 256)) {
+                optionChanged = true;
+            }
+            const AdaptiveSamplingStats& stats = getAdaptiveSamplingStats();
+            propertyEditor.addCustomWidgets("Effective spp");
+            ImGui::Text(
+                    "%.1f (%.1f%% converged)", stats.effectiveSpp, stats.convergedFraction * 100.0);
+            propertyEditor.addCustomWidgets("Time to Threshold");
+            if (stats.numSamplesToThreshold >= 0) {
+                ImGui::Text(
+                        "%.3fs (%d spp)", std::max(stats.timeToThresholdSeconds, 0.0),
+                        int(stats.numSamplesToThreshold));
+            } else {
+                ImGui::Text("-");
+            }
+        }
+
+        bool useTemporal = useTemporalAccumulation;
+        if (!useAdaptiveSampling && propertyEditor.addCheckbox("Temporal Accumulation", &useTemporal)) {
+            setUseTemporalAccumulation(useTemporal);
+            optionChanged = true;
+        }
+        if (getIsTemporalAccumulationActive()) {
+            propertyEditor.addSliderInt("Max. History Length", &temporalMaxHistoryLength, 1, 256);
+            propertyEditor.addSliderFloat(
+                    "Position Tolerance", &temporalPositionTolerance, 0.001f, 0.1f, "%.3f");
+            propertyEditor.addSliderFloat("Density Tolerance", &temporalDensityTolerance, 0.01f, 1.0f);
+        }
+
+        if (!useAdaptiveSampling && !getIsTemporalAccumulationActive()) {
+            if (propertyEditor.addCheckbox("Progressive Resolution", &useProgressiveResolution)) {
+                isBlendingInteractionResult = false;
+            }
+        }
+        if ((vptMode == VptMode::NEXT_EVENT_TRACKING || vptMode == VptMode::NEXT_EVENT_TRACKING_SPECTRAL)
+                && gridType == GridType::DENSE && !useEnvironmentMapImage) {
+            bool useVolume = useSunTransmittanceVolume;
+            if (propertyEditor.addCheckbox("Sun Shadow Volume (Biased)", &useVolume)) {
+                setUseSunTransmittanceVolume(useVolume);
+                optionChanged = true;
+            }
+        }
+
+        if (!useAdaptiveSampling) {
+            bool skipBackground = skipBackgroundPixels;
+            if (propertyEditor.addCheckbox("Skip Background Pixels", &skipBackground)) {
+                setSkipBackgroundPixels(skipBackground);
+            }
+        }
+
+        if (getIsProgressiveResolutionActive()) {
+            const char* const resolutionNames[] = { "1/2", "1/4" };
+            int resolutionIdx = interactionPixelStride <= 2 ? 0 : 1;
+            if (propertyEditor.addCombo("Moving Resolution", &resolutionIdx, resolutionNames, 2)) {
+                interactionPixelStride = resolutionIdx == 0 ? 2 : 4;
+            }
+            propertyEditor.addSliderInt("Moving #Samples", &interactionNumSamples, 1, 64);
+        }
 
         if (propertyEditor.addSliderFloat("Extinction Scale", &cloudExtinctionScale, 1.0f, 2048.0f)) {
             optionChanged = true;
@@ -1085,6 +1852,13 @@ bool VolumetricPathTracingPass::renderGuiPropertyEditorNodes(sgl::PropertyEditor
             }
         }
 
+        if (propertyEditor.addCombo(
+                "Sampler", (int*)&samplerType, VPT_SAMPLER_TYPE_NAMES,
+                IM_ARRAYSIZE(VPT_SAMPLER_TYPE_NAMES))) {
+            optionChanged = true;
+            setShaderDirty();
+        }
+
         if (vptMode == VptMode::RESIDUAL_RATIO_TRACKING || vptMode == VptMode::DECOMPOSITION_TRACKING) {
             if (propertyEditor.addSliderInt("Super Voxel Size", &superVoxelSize, 1, 64)) {
                 optionChanged = true;
@@ -1094,7 +1868,8 @@ bool VolumetricPathTracingPass::renderGuiPropertyEditorNodes(sgl::PropertyEditor
             }
         }
 
-        if (propertyEditor.addCheckbox("Use Sparse Grid", &useSparseGrid)) {
+        if (propertyEditor.addCombo(
+                "Grid Type", (int*)&gridType, GRID_TYPE_NAMES, IM_ARRAYSIZE(GRID_TYPE_NAMES))) {
             optionChanged = true;
             setGridData();
             updateVptMode();
@@ -1102,11 +1877,8 @@ bool VolumetricPathTracingPass::renderGuiPropertyEditorNodes(sgl::PropertyEditor
             setDataDirty();
         }
         if (propertyEditor.addCheckbox("Flip YZ", &flipYZCoordinates)) {
-            optionChanged = true;
-            setGridData();
-            updateVptMode();
-            setShaderDirty();
-            setDataDirty();
+            reRender = true;
+            frameInfo.frameCount = 0;
         }
 
         if (propertyEditor.addCombo(
@@ -1157,7 +1929,6 @@ bool VolumetricPathTracingPass::renderGuiPropertyEditorNodes(sgl::PropertyEditor
                     "Env. Map Linear RGB", &envMapImageUsesLinearRgb)) {
                 reRender = true;
                 frameInfo.frameCount = 0;
-                setShaderDirty();
             }
         }else{
             if (propertyEditor.addColorEdit3("Sunlight Color", &sunlightColor.x)) {
@@ -1262,6 +2033,9 @@ bool VolumetricPathTracingPass::renderGuiPropertyEditorNodes(sgl::PropertyEditor
     }
 
     if (optionChanged) {
+        // The history was rendered with different settings and must not be reprojected or blended.
+        reprojectTemporalHistory = false;
+        isBlendingInteractionResult = false;
         frameInfo.frameCount = 0;
         reRender = true;
     }
@@ -1357,6 +2131,54 @@ void BlitMomentTexturePass::_render() {
 OctahedralMappingPass::OctahedralMappingPass(sgl::vk::Renderer* renderer) : ComputePass(renderer) {
 }
 
+InteractionUpsamplingPass::InteractionUpsamplingPass(sgl::vk::Renderer* renderer) : ComputePass(renderer) {
+}
+
+void InteractionUpsamplingPass::setInputImages(
+        const sgl::vk::TexturePtr& _accTexture, const sgl::vk::TexturePtr& _depthTexture) {
+    accTexture = _accTexture;
+    depthTexture = _depthTexture;
+    setDataDirty();
+}
+
+void InteractionUpsamplingPass::setOutputImage(sgl::vk::ImageViewPtr& colorImage) {
+    outputImage = colorImage;
+    sgl::vk::ImageSettings imageSettings = outputImage->getImage()->getImageSettings();
+    imageSettings.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    imageSettings.usage = VK_IMAGE_USAGE_STORAGE_BIT;
+    interactionResultTexture = std::make_shared<sgl::vk::Texture>(
+            device, imageSettings, sgl::vk::ImageSamplerSettings());
+    setDataDirty();
+}
+
+void InteractionUpsamplingPass::loadShader() {
+    std::map<std::string, std::string> preprocessorDefines;
+    preprocessorDefines.insert(std::make_pair("BLOCK_SIZE", std::to_string(BLOCK_SIZE)));
+    shaderStages = sgl::vk::ShaderManager->getShaderStages(
+            { "InteractionUpsampling.Compute" }, preprocessorDefines);
+}
+
+void InteractionUpsamplingPass::createComputeData(
+        sgl::vk::Renderer* renderer, sgl::vk::ComputePipelinePtr& computePipeline) {
+    computeData = std::make_shared<sgl::vk::ComputeData>(renderer, computePipeline);
+    computeData->setStaticImageView(accTexture->getImageView(), "accImage");
+    computeData->setStaticImageView(depthTexture->getImageView(), "depthImage");
+    computeData->setStaticImageView(interactionResultTexture->getImageView(), "interactionResultImage");
+    computeData->setStaticImageView(outputImage, "resultImage");
+}
+
+void InteractionUpsamplingPass::_render() {
+    renderer->transitionImageLayout(interactionResultTexture->getImage(), VK_IMAGE_LAYOUT_GENERAL);
+    renderer->pushConstants(
+            std::static_pointer_cast<sgl::vk::Pipeline>(computeData->getComputePipeline()),
+            VK_SHADER_STAGE_COMPUTE_BIT, 0, pushConstants);
+    auto width = int(outputImage->getImage()->getImageSettings().width);
+    auto height = int(outputImage->getImage()->getImageSettings().height);
+    renderer->dispatch(
+            computeData,
+            sgl::iceil(width, BLOCK_SIZE), sgl::iceil(height, BLOCK_SIZE), 1);
+}
+
 void OctahedralMappingPass::setInputImage(const sgl::vk::TexturePtr& _inputImage) {
     inputImage = _inputImage;
     setDataDirty();
@@ -1386,4 +2208,106 @@ void OctahedralMappingPass::_render() {
     renderer->dispatch(
             computeData,
             sgl::iceil(width, BLOCK_SIZE), sgl::iceil(height, BLOCK_SIZE), 1);
-}
\ No newline at end of file
+}
+
+
+SunTransmittancePass::SunTransmittancePass(sgl::vk::Renderer* renderer) : ComputePass(renderer) {
+}
+
+void SunTransmittancePass::setDensityField(const CloudDataPtr& data, const sgl::vk::TexturePtr& densityField) {
+    cloudData = data;
+    densityTexture = densityField;
+
+    sgl::vk::ImageSettings imageSettings = densityTexture->getImage()->getImageSettings();
+    imageSettings.width = std::min(imageSettings.width, MAX_RESOLUTION);
+    imageSettings.height = std::min(imageSettings.height, MAX_RESOLUTION);
+    imageSettings.depth = std::min(imageSettings.depth, MAX_RESOLUTION);
+    imageSettings.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+    sgl::vk::ImageSamplerSettings samplerSettings;
+    samplerSettings.addressModeU = samplerSettings.addressModeV = samplerSettings.addressModeW =
+            VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerSettings.minFilter = VK_FILTER_LINEAR;
+    samplerSettings.magFilter = VK_FILTER_LINEAR;
+    bool isResolutionChanged = true;
+    if (transmittanceTexture) {
+        const auto& oldImageSettings = transmittanceTexture->getImage()->getImageSettings();
+        isResolutionChanged =
+                oldImageSettings.width != imageSettings.width || oldImageSettings.height != imageSettings.height
+                || oldImageSettings.depth != imageSettings.depth;
+    }
+    if (isResolutionChanged) {
+        transmittanceTexture = std::make_shared<sgl::vk::Texture>(device, imageSettings, samplerSettings);
+    }
+
+    isVolumeDirty = true;
+    setDataDirty();
+}
+
+void SunTransmittancePass::setUseTransferFunction(bool _useTransferFunction) {
+    if (useTransferFunction != _useTransferFunction) {
+        useTransferFunction = _useTransferFunction;
+        isVolumeDirty = true;
+        setShaderDirty();
+    }
+}
+
+void SunTransmittancePass::setVolumeSettings(
+        const glm::vec3& boxMin, const glm::vec3& boxMax, const glm::vec3& sunDirection, float extinction,
+        bool flipYZ) {
+    PushConstants newPushConstants{};
+    newPushConstants.boxMin = boxMin;
+    newPushConstants.boxMax = boxMax;
+    newPushConstants.sunDirection = glm::normalize(sunDirection);
+    newPushConstants.extinction = extinction;
+    newPushConstants.flipYZ = flipYZ ? 1 : 0;
+
+    // Two steps per voxel of the transmittance volume.
+    const auto& imageSettings = transmittanceTexture->getImage()->getImageSettings();
+    glm::vec3 resolution(imageSettings.width, imageSettings.height, imageSettings.depth);
+    if (flipYZ) {
+        resolution = glm::vec3(resolution.x, resolution.z, resolution.y);
+    }
+    glm::vec3 voxelSize = (boxMax - boxMin) / resolution;
+    newPushConstants.stepSize = 0.5f * std::min(voxelSize.x, std::min(voxelSize.y, voxelSize.z));
+
+    if (std::memcmp(&newPushConstants, &pushConstants, sizeof(PushConstants)) != 0) {
+        pushConstants = newPushConstants;
+        isVolumeDirty = true;
+    }
+}
+
+void SunTransmittancePass::loadShader() {
+    std::map<std::string, std::string> preprocessorDefines;
+    preprocessorDefines.insert(std::make_pair("BLOCK_SIZE", std::to_string(BLOCK_SIZE)));
+    if (useTransferFunction) {
+        preprocessorDefines.insert(std::make_pair("USE_TRANSFER_FUNCTION", ""));
+    }
+    shaderStages = sgl::vk::ShaderManager->getShaderStages(
+            { "SunTransmittance.Compute" }, preprocessorDefines);
+}
+
+void SunTransmittancePass::createComputeData(
+        sgl::vk::Renderer* renderer, sgl::vk::ComputePipelinePtr& computePipeline) {
+    computeData = std::make_shared<sgl::vk::ComputeData>(renderer, computePipeline);
+    computeData->setStaticTexture(densityTexture, "densityImage");
+    if (useTransferFunction) {
+        computeData->setStaticTexture(
+                cloudData->getTransferFunctionWindow()->getTransferFunctionMapTextureVulkan(),
+                "transferFunctionTexture");
+    }
+    computeData->setStaticImageView(transmittanceTexture->getImageView(), "sunTransmittanceImage");
+}
+
+void SunTransmittancePass::_render() {
+    renderer->transitionImageLayout(densityTexture->getImage(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    renderer->transitionImageLayout(transmittanceTexture->getImage(), VK_IMAGE_LAYOUT_GENERAL);
+    renderer->pushConstants(
+            std::static_pointer_cast<sgl::vk::Pipeline>(computeData->getComputePipeline()),
+            VK_SHADER_STAGE_COMPUTE_BIT, 0, pushConstants);
+    const auto& imageSettings = transmittanceTexture->getImage()->getImageSettings();
+    renderer->dispatch(
+            computeData,
+            sgl::iceil(int(imageSettings.width), BLOCK_SIZE), sgl::iceil(int(imageSettings.height), BLOCK_SIZE),
+            sgl::iceil(int(imageSettings.depth), BLOCK_SIZE));
+    isVolumeDirty = false;
+}
@@ -25,6 +25,9 @@
 #ifndef CLOUDRENDERING_VOLUMETRICPATHTRACINGPASS_HPP
 #define CLOUDRENDERING_VOLUMETRICPATHTRACINGPASS_HPP
 
+#include <chrono>
+#include <limits>
+#include <map>
 #include <glm/vec3.hpp>
 #include <glm/mat4x4.hpp>
 #include <Graphics/Scene/Camera.hpp>
@@ -44,6 +47,10 @@ class BlitMomentTexturePass;
 class SuperVoxelGridResidualRatioTracking;
 class SuperVoxelGridDecompositionTracking;
 class OctahedralMappingPass;
+class InteractionUpsamplingPass;
+class SunTransmittancePass;
+class PersistentShaderCache;
+class EnvironmentMapCache;
 
 namespace IGFD {
 class FileDialog;
@@ -57,14 +64,18 @@ const char* const VPT_FEATURE_MAP_NAMES[] = {
         "Result", "First X", "First W", "Normal", "Cloud Only", "Depth", "Density", "Background", "Reprojected UV"
 };
 
+/**
+ * FEATURE_MAPS_ONLY only traces the primary rays up to their first collision and fills the feature maps depending on
+ * it (e.g., first position, normal, depth, density or reprojected UV). The result image stays black.
+ */
 enum class VptMode {
     DELTA_TRACKING, SPECTRAL_DELTA_TRACKING, RATIO_TRACKING, DECOMPOSITION_TRACKING, RESIDUAL_RATIO_TRACKING,
-    NEXT_EVENT_TRACKING, NEXT_EVENT_TRACKING_SPECTRAL
+    NEXT_EVENT_TRACKING, NEXT_EVENT_TRACKING_SPECTRAL, FEATURE_MAPS_ONLY
 };
 const char* const VPT_MODE_NAMES[] = {
         "Delta Tracking", "Delta Tracking (Spectral)", "Ratio Tracking",
         "Decomposition Tracking", "Residual Ratio Tracking", "Next Event Tracking",
-        "Next Event Tracking (Spectral)"
+        "Next Event Tracking (Spectral)", "Feature Maps Only"
 };
 
 enum class GridInterpolationType {
@@ -76,6 +87,29 @@ const char* const GRID_INTERPOLATION_TYPE_NAMES[] = {
         "Nearest", "Stochastic", "Trilinear"
 };
 
+/// Representation of the density grid on the GPU.
+enum class GridType {
+    DENSE, //< 3D texture storing all voxels.
+    NANOVDB, //< NanoVDB tree in a storage buffer.
+    BRICK_MAP //< Occupied 8^3 bricks in a 3D atlas texture and a low-resolution indirection texture (see BrickMap).
+};
+const char* const GRID_TYPE_NAMES[] = {
+        "Dense", "NanoVDB", "Brick Map"
+};
+
+/**
+ * Sample generators used by the path tracer. The low-discrepancy samplers assign a fixed budget of dimensions to the
+ * camera ray and each scattering event and fall back to white noise for all further random numbers.
+ */
+enum class VptSamplerType {
+    WHITE_NOISE, //< Hybrid Tausworthe generator.
+    SOBOL, //< Owen-scrambled Sobol sequence.
+    SOBOL_BLUE_NOISE //< Owen-scrambled Sobol sequence with Z-ordered pixels (blue noise error distribution).
+};
+const char* const VPT_SAMPLER_TYPE_NAMES[] = {
+        "White Noise", "Sobol (Owen-scrambled)", "Sobol (Blue Noise)"
+};
+
 /**
  * Choices of collision probabilities for spectral delta tracking.
  * For more details see: https://jannovak.info/publications/SDTracking/SDTracking.pdf
@@ -87,6 +121,16 @@ const char* const SPECTRAL_DELTA_TRACKING_COLLISION_PROBABILITY_NAMES[] = {
         "Max-based", "Avg-based", "Path History Avg-based"
 };
 
+/// Statistics of the adaptive sampling mode for the current accumulation.
+struct AdaptiveSamplingStats {
+    double effectiveSpp = 0.0; ///< Average number of samples per pixel actually traced.
+    double convergedFraction = 0.0; ///< Fraction of pixels below the error threshold.
+    /// Time between recording the first and the converging dispatch (or -1 if not converged yet).
+    double timeToThresholdSeconds = -1.0;
+    /// Samples per pixel dispatched until all pixels converged (or -1 if not converged yet).
+    int64_t numSamplesToThreshold = -1;
+};
+
 class VolumetricPathTracingPass : public sgl::vk::ComputePass {
 public:
     explicit VolumetricPathTracingPass(sgl::vk::Renderer* renderer, sgl::CameraPtr* camera);
@@ -96,23 +140,78 @@ public:
     void setOutputImage(sgl::vk::ImageViewPtr& colorImage);
     void recreateSwapchain(uint32_t width, uint32_t height) override;
     void setCloudData(const CloudDataPtr& data);
+    /// Called when the transfer function changed; the sun transmittance volume depends on the mapped densities.
+    void onTransferFunctionMapRebuilt();
     void setEmissionData(const CloudDataPtr& data);
     void setVptMode(VptMode vptMode);
-    void setUseSparseGrid(bool useSparse);
+    void setUseSparseGrid(bool useSparse); //< Switches between GridType::NANOVDB and GridType::DENSE.
+    void setGridType(GridType type);
+    [[nodiscard]] inline GridType getGridType() const { return gridType; }
     void setSparseGridInterpolationType(GridInterpolationType type);
     void setCustomSeedOffset(uint32_t offset); //< Additive offset for the random seed in the VPT shader.
+    void setSamplerType(VptSamplerType type);
+    /// Whether to compile the shaders of the other VPT modes, grid types and grid interpolation types on worker
+    /// threads after a shader was loaded.
+    inline void setPrecompileShaderVariants(bool precompile) { precompileShaderVariants = precompile; }
     void setUseLinearRGB(bool useLinearRGB);
+    /// Sets the number of full path samples per pixel traced and accumulated in registers by a single dispatch.
+    void setNumSamplesPerDispatch(int numSamples);
+    [[nodiscard]] inline int getNumSamplesPerDispatch() const { return numSamplesPerDispatch; }
+    /// Pixels stop receiving samples when the relative error of their mean falls below the error threshold.
+    void setUseAdaptiveSampling(bool useAdaptive);
+    void setAdaptiveSamplingErrorThreshold(float threshold);
+    /// Returns the adaptive sampling statistics of the last frame that was read back.
+    [[nodiscard]] inline const AdaptiveSamplingStats& getAdaptiveSamplingStats() const { return adaptiveSamplingStats; }
+    /**
+     * Reads back the adaptive sampling statistics when rendering without a swapchain. Must only be called after the
+     * fences of all submitted frames were waited on. With a swapchain, this happens automatically in render().
+     */
+    void updateAdaptiveSamplingStats();
+    /**
+     * Temporal accumulation: When the camera moves or the cloud data changes, the accumulated samples are reprojected
+     * into the new view instead of being discarded. Reprojected history is rejected where the first scattering event
+     * differs in position or density, and at most 'maxHistoryLength' samples of history are reused per pixel.
+     * Not supported together with adaptive sampling (which takes precedence).
+     */
+    void setUseTemporalAccumulation(bool useTemporal);
+    void setTemporalMaxHistoryLength(int maxHistoryLength);
+    /**
+     * Progressive resolution: While the camera is moving (i.e., onHasMoved is called every frame), blocks of
+     * pixelStride^2 pixels are traced with numSamples samples by one invocation and the result is upsampled. When the
+     * camera stops, the upsampled image is faded out while the full resolution accumulation catches up.
+     * Not supported together with adaptive sampling or temporal accumulation.
+     */
+    void setUseProgressiveResolution(bool useProgressive);
+    void setProgressiveResolutionSettings(int pixelStride, int numSamples);
+    /**
+     * Pixels outside of the projected bounds of the cloud box are filled with the environment by the first dispatch of
+     * an accumulation and skipped by all following dispatches. Not used together with adaptive sampling.
+     */
+    void setSkipBackgroundPixels(bool skipBackground);
+    /**
+     * Biased preview mode for next event tracking: The shadow rays are replaced by a single lookup in a precomputed
+     * volume storing the transmittance toward the sun, which approximates the transmittance toward all light
+     * directions. The volume is only recomputed when the sun direction, the extinction or the cloud data changes.
+     */
+    void setUseSunTransmittanceVolume(bool useVolume);
     void setFileDialogInstance(ImGuiFileDialog* _fileDialogInstance);
 
     void loadEnvironmentMapImage(const std::string& filename);
+    /// Whether to cache decoded .exr images and the importance sampling data of environment maps on disk.
+    inline void setUseEnvironmentMapDiskCache(bool useCache) { useEnvironmentMapDiskCache = useCache; }
     void setUseEnvironmentMapFlag(bool useEnvironmentMap);
     void setEnvironmentMapIntensityFactor(float intensityFactor);
+    void setSunlightIntensity(float intensity);
 
     void setScatteringAlbedo(glm::vec3 albedo);
     void setExtinctionScale(double extinctionScale);
     void setPhaseG(double phaseG);
     void setExtinctionBase(glm::vec3 extinctionBase);
     void setFeatureMapType(FeatureMapTypeVpt type);
+    /// Feature maps are only updated for the first 'limit' samples (0 means no limit).
+    void setFeatureMapSampleLimit(int limit);
+    /// Whether to only update the feature maps used by the active denoiser and the displayed feature map.
+    void setOnlyUpdateDenoiserFeatureMaps(bool onlyDenoiserFeatureMaps);
     void setPreviousViewProjMatrix(glm::mat4 previousViewProjMatrix);
 
     void setUseEmission(bool emission);
@@ -122,6 +221,8 @@ public:
 
     // Called when the camera has moved.
     void onHasMoved();
+    /// Restarts the accumulation without reusing any history (e.g., when rendering unrelated views one by one).
+    void discardAccumulation();
     /// Returns if the data needs to be re-rendered, but the visualization mapping is valid.
     bool needsReRender() { bool tmp = reRender; reRender = false; return tmp; }
     /// Renders the GUI. The "reRender" flag might be set depending on the user's actions.
@@ -133,15 +234,26 @@ private:
     std::shared_ptr<OctahedralMappingPass> equalAreaPass;
 
     void loadShader() override;
-    void setComputePipelineInfo(sgl::vk::ComputePipelineInfo& pipelineInfo) override {}
+    void addVptModePreprocessorDefines(VptMode mode, std::map<std::string, std::string>& preprocessorDefines);
+    static void addGridPreprocessorDefines(
+            GridType type, GridInterpolationType interpolationType,
+            std::map<std::string, std::string>& preprocessorDefines);
+    /// Returns the defines of the shader variant with the passed settings given the remaining (shared) defines.
+    std::map<std::string, std::string> getVariantPreprocessorDefines(
+            const std::map<std::string, std::string>& baseDefines,
+            VptMode mode, GridType type, GridInterpolationType interpolationType);
+    void setComputePipelineInfo(sgl::vk::ComputePipelineInfo& pipelineInfo) override;
     void createComputeData(sgl::vk::Renderer* renderer, sgl::vk::ComputePipelinePtr& computePipeline) override;
     void _render() override;
 
     sgl::CameraPtr* camera;
+    std::shared_ptr<PersistentShaderCache> shaderCache; ///< Compiled SPIR-V and pipeline cache persisted on disk.
+    bool precompileShaderVariants = true; ///< Compile the neighboring shader variants on worker threads.
     uint32_t customSeedOffset = 0;
+    VptSamplerType samplerType = VptSamplerType::WHITE_NOISE;
     bool reRender = true;
 
-    const glm::ivec2 blockSize2D = glm::ivec2(16, 16);
+    glm::ivec2 blockSize2D = glm::ivec2(16, 16); ///< Must match LOCAL_SIZE in the shader.
     sgl::vk::ImageViewPtr sceneImageView;
     CloudDataPtr cloudData;
     CloudDataPtr emissionData;
@@ -159,11 +271,12 @@ private:
 
     void setGridData();
     void updateGridSampler();
-    bool useSparseGrid = false; ///< Use NanoVDB or a dense grid texture?
+    GridType gridType = GridType::DENSE;
 
     GridInterpolationType gridInterpolationType = GridInterpolationType::STOCHASTIC;
-    sgl::vk::TexturePtr densityFieldTexture; /// < Dense grid texture.
+    sgl::vk::TexturePtr densityFieldTexture; /// < Dense grid texture (or brick atlas texture).
     sgl::vk::BufferPtr nanoVdbBuffer; /// < Sparse grid buffer.
+    sgl::vk::TexturePtr brickIndirectionTexture; /// < Atlas position of each brick of the brick map.
 
     sgl::vk::TexturePtr emissionFieldTexture; /// < Dense grid texture.
     sgl::vk::BufferPtr emissionNanoVdbBuffer; /// < Sparse grid buffer.
@@ -186,9 +299,105 @@ private:
     sgl::vk::TexturePtr  backgroundTexture;
     sgl::vk::TexturePtr  reprojUVTexture;
 
+    // Adaptive sampling data.
+    bool useAdaptiveSampling = false;
+    float adaptiveSamplingErrorThreshold = 0.01f;
+    int adaptiveSamplingMinNumSamples = 16;
+    sgl::vk::TexturePtr varianceTexture; ///< Second moment of the luminance and per-pixel sample count.
+    sgl::vk::BufferPtr tileActiveBuffer; ///< Number of unconverged pixels per tile.
+    sgl::vk::BufferPtr adaptiveSamplingStatsBuffer;
+    /// One readback buffer per swapchain image, which is only read after the frame fence of the image was waited on.
+    std::vector<sgl::vk::BufferPtr> adaptiveSamplingStatsReadbackBuffers;
+    uint32_t lastAdaptiveSamplingReadbackIndex = std::numeric_limits<uint32_t>::max();
+    struct AdaptiveSamplingStatsData {
+        uint32_t numSamplesTracedLow;
+        uint32_t numSamplesTracedHigh;
+        uint32_t numConvergedPixels;
+        uint32_t accumulationIndex; ///< Used for detecting stale read back data.
+        uint32_t convergedFrameCount; ///< Frame count after the dispatch converging the last pixel (or 0).
+    };
+    void readAdaptiveSamplingStats(uint32_t readbackIndex);
+    uint32_t adaptiveSamplingAccumulationIndex = 0;
+    std::chrono::steady_clock::time_point accumulationStartTime;
+    /// Recording time of the dispatches of the current accumulation by the frame count after the dispatch.
+    std::map<uint32_t, std::chrono::steady_clock::time_point> adaptiveSamplingDispatchTimes;
+    bool isAdaptiveSamplingConverged = false; ///< All pixels converged, so the remaining dispatches are skipped.
+    AdaptiveSamplingStats adaptiveSamplingStats;
+
+    // Temporal accumulation data.
+    [[nodiscard]] inline bool getIsTemporalAccumulationActive() const {
+        return useTemporalAccumulation && !useAdaptiveSampling;
+    }
+    void createTemporalAccumulationTextures();
+    void restartAccumulation(); ///< Resets the accumulation, but keeps the history for reprojection if possible.
+    bool useTemporalAccumulation = false;
+    int temporalMaxHistoryLength = 32;
+    float temporalPositionTolerance = 0.02f;
+    float temporalDensityTolerance = 0.25f;
+    bool reprojectTemporalHistory = false; ///< Whether the next dispatch reprojects the history of the last view.
+    bool hasTemporalHistory = false; ///< Whether the temporal images hold data of the last dispatch.
+    glm::mat4 temporalHistoryViewProjMatrix{}; ///< View projection matrix the temporal history was rendered with.
+    sgl::vk::TexturePtr temporalPositionTexture; ///< Mean first event position and coverage.
+    sgl::vk::TexturePtr temporalSampleInfoTexture; ///< Per-pixel sample count and mean first event density.
+    sgl::vk::TexturePtr historyAccTexture;
+    sgl::vk::TexturePtr historyPositionTexture;
+    sgl::vk::TexturePtr historySampleInfoTexture;
+
+    // Progressive resolution during camera movement.
+    [[nodiscard]] inline bool getIsProgressiveResolutionActive() const {
+        return useProgressiveResolution && !useAdaptiveSampling && !getIsTemporalAccumulationActive();
+    }
+    bool useProgressiveResolution = false;
+    int interactionPixelStride = 2;
+    int interactionNumSamples = 4;
+    bool hasMovedSinceLastFrame = false;
+    bool isBlendingInteractionResult = false; ///< Whether the last upsampled image is still faded out.
+    std::shared_ptr<InteractionUpsamplingPass> interactionUpsamplingPass;
+
+    // Pixels only seeing the environment are skipped after the first dispatch (opt-in).
+    void updateCoveredPixels(const glm::mat4& viewProjectionMatrix, int width, int height);
+    bool skipBackgroundPixels = false;
+    /// Inputs the covered pixels and the background pixels depend on. If any of them changes without restarting the
+    /// accumulation, the next dispatch covers the whole image again.
+    struct BackgroundCoverageState {
+        glm::mat4 viewProjectionMatrix{};
+        glm::vec3 boxMin{}, boxMax{}, emissionBoxMin{}, emissionBoxMax{};
+        glm::vec3 sunDirection{}, sunIntensity{};
+        float environmentMapIntensityFactor = 0.0f;
+        bool useEmission = false;
+        bool operator!=(const BackgroundCoverageState& other) const {
+            return viewProjectionMatrix != other.viewProjectionMatrix
+                    || boxMin != other.boxMin || boxMax != other.boxMax
+                    || emissionBoxMin != other.emissionBoxMin || emissionBoxMax != other.emissionBoxMax
+                    || sunDirection != other.sunDirection || sunIntensity != other.sunIntensity
+                    || environmentMapIntensityFactor != other.environmentMapIntensityFactor
+                    || useEmission != other.useEmission;
+        }
+    };
+    BackgroundCoverageState backgroundCoverageState;
+
+    // Precomputed sun transmittance for biased next event tracking.
+    /// The volume is computed from the dense density grid texture, so it is not supported for sparse grids.
+    /// Environment map images have no sun lobe, so next event estimation would never sample the volume.
+    [[nodiscard]] inline bool getIsSunTransmittanceVolumeActive(VptMode mode, GridType type) const {
+        return useSunTransmittanceVolume && type == GridType::DENSE && !useEnvironmentMapImage
+                && (mode == VptMode::NEXT_EVENT_TRACKING || mode == VptMode::NEXT_EVENT_TRACKING_SPECTRAL);
+    }
+    [[nodiscard]] inline bool getIsSunTransmittanceVolumeActive() const {
+        return getIsSunTransmittanceVolumeActive(vptMode, gridType);
+    }
+    void updateSunTransmittanceVolume();
+    bool useSunTransmittanceVolume = false;
+    bool isSunTransmittanceDataDirty = true; ///< Whether the density grid of the volume pass needs to be updated.
+    std::shared_ptr<SunTransmittancePass> sunTransmittancePass;
+
     std::string getCurrentEventName();
     int targetNumSamples = 1024;
     int numFeatureMapSamplesPerFrame = 1;
+    int numSamplesPerDispatch = 1;
+    int featureMapSampleLimit = 0;
+    bool onlyUpdateDenoiserFeatureMaps = false;
+    uint32_t getFeatureMapWriteMask();
     bool reachedTarget = true;
     bool changedDenoiserSettings = false;
     bool timerStopped = false;
@@ -213,9 +422,23 @@ private:
     bool envMapImageUsesLinearRgb = false;
     std::string environmentMapFilenameGui;
     std::string loadedEnvironmentMapFilename;
-    void createEnvironmentMapOctahedralTexture(uint32_t mip_levels);
+    /// Entry of the alias table for importance sampling the texels of environmentMapOctahedralTexture (std430).
+    struct EnvironmentMapAliasTableEntry {
+        float probability; ///< Probability of keeping the texel of this entry instead of switching to the alias.
+        uint32_t alias;
+        float pdf; ///< Probability of sampling the texel of this entry.
+        float aliasPdf; ///< Probability of sampling the alias texel.
+    };
+    void createEnvironmentMapOctahedralTexture(
+            uint32_t resolutionLog2, std::vector<EnvironmentMapAliasTableEntry>& aliasTable);
+    void createEnvironmentMapAliasTable(
+            const float* brightnessData, uint32_t numTexels, std::vector<EnvironmentMapAliasTableEntry>& aliasTable);
     sgl::vk::TexturePtr environmentMapTexture;
-    sgl::vk::TexturePtr environmentMapOctahedralTexture;
+    sgl::vk::TexturePtr environmentMapOctahedralTexture; ///< Brightness of the equal-area octahedral mapping.
+    uint32_t environmentMapAliasTableResolutionLog2 = 10; ///< Derived from the size of the environment map image.
+    sgl::vk::BufferPtr environmentMapAliasTableBuffer;
+    bool useEnvironmentMapDiskCache = true;
+    std::shared_ptr<EnvironmentMapCache> environmentMapCache;
     float environmentMapIntensityFactor = 1;
     bool useTransferFunctionCached = false;
     ImGuiFileDialog* fileDialogInstance = nullptr;
@@ -239,6 +462,7 @@ private:
     struct UniformData {
         glm::mat4 inverseViewProjMatrix;
         glm::mat4 previousViewProjMatrix;
+        glm::mat4 historyViewProjMatrix;
 
         // Cloud properties
         glm::vec3 boxMin; float pad0;
@@ -261,7 +485,7 @@ private:
         float emissionCap;
         float emissionStrength;
 
-        int numFeatureMapSamplesPerFrame;
+        int numFeatureMapSamplesPerFrame; int pad9;
 
         // For decomposition and residual ratio tracking.
         glm::ivec3 superVoxelSize; int pad8;
@@ -270,13 +494,42 @@ private:
         // Whether to use linear RGB or sRGB.
         int useLinearRGB;
 
+        // Adaptive sampling.
+        float adaptiveSamplingErrorThreshold;
+        int adaptiveSamplingMinNumSamples;
+
+        // Feature map decimation.
+        uint32_t featureMapWriteMask;
+        int featureMapSampleLimit;
+
+        // Per-render settings (no shader recompilation necessary).
+        uint32_t customSeedOffset;
+        int flipYZ;
+        int envMapImageUsesLinearRgb;
+        uint32_t environmentMapAliasTableSize;
+
+        // Number of voxels of the density grid.
+        glm::ivec3 gridResolution;
+
+        // Temporal accumulation.
+        float temporalPositionTolerance;
+        float temporalDensityTolerance;
+        int temporalMaxHistoryLength;
     };
     UniformData uniformData{};
     sgl::vk::BufferPtr uniformBuffer;
 
     struct FrameInfo {
-        uint32_t frameCount;
-        glm::uvec3 padding;
+        uint32_t frameCount; ///< Number of samples accumulated so far.
+        uint32_t numSamples; ///< Number of samples traced by the current dispatch.
+        uint32_t sampleIndexOffset; ///< Samples of earlier accumulations whose history is reused (temporal mode).
+        uint32_t reprojectHistory; ///< Whether the current dispatch reprojects the history of the last view.
+        uint32_t pixelStride; ///< Size of the pixel blocks traced by one invocation (> 1 while the camera moves).
+        uint32_t padding;
+        glm::ivec2 pixelOffset; ///< First pixel covered by the current dispatch.
+        // Conservative screen space bounds of the cloud box. All rays of pixels outside of them miss the box.
+        glm::ivec2 coveredPixelsMin;
+        glm::ivec2 coveredPixelsMax;
     };
     FrameInfo frameInfo{};
     sgl::vk::BufferPtr frameInfoBuffer;
@@ -348,4 +601,76 @@ private:
     sgl::vk::ImageViewPtr outputImage;
 };
 
+/**
+ * Upsamples the result traced at reduced resolution while the camera is moving using a depth-guided bilinear filter.
+ * Afterwards, the upsampled image can be blended with the full resolution accumulation.
+ */
+class InteractionUpsamplingPass : public sgl::vk::ComputePass {
+public:
+    explicit InteractionUpsamplingPass(sgl::vk::Renderer* renderer);
+    void setInputImages(const sgl::vk::TexturePtr& _accTexture, const sgl::vk::TexturePtr& _depthTexture);
+    void setOutputImage(sgl::vk::ImageViewPtr& colorImage);
+    /// A pixel stride > 1 upsamples the blocks traced by the VPT pass, a stride of 1 blends with the accumulation.
+    inline void setPixelStride(int stride) { pushConstants.pixelStride = stride; }
+    inline void setBlendWeight(float weight) { pushConstants.blendWeight = weight; }
+protected:
+    void loadShader() override;
+    void createComputeData(sgl::vk::Renderer* renderer, sgl::vk::ComputePipelinePtr& computePipeline) override;
+    void _render() override;
+
+private:
+    const int BLOCK_SIZE = 16;
+    sgl::vk::TexturePtr accTexture;
+    sgl::vk::TexturePtr depthTexture;
+    sgl::vk::TexturePtr interactionResultTexture; ///< Last upsampled image.
+    sgl::vk::ImageViewPtr outputImage;
+    struct PushConstants {
+        int pixelStride = 2;
+        float blendWeight = 0.0f;
+    };
+    PushConstants pushConstants{};
+};
+
+/**
+ * Precomputes the transmittance toward the sun at the voxels of the density grid by ray marching (i.e., a deep shadow
+ * volume). Used by the biased next event tracking preview mode of the VPT pass.
+ */
+class SunTransmittancePass : public sgl::vk::ComputePass {
+public:
+    explicit SunTransmittancePass(sgl::vk::Renderer* renderer);
+    /// Uses the dense density grid texture of the VPT pass and (re)creates the transmittance volume if necessary.
+    void setDensityField(const CloudDataPtr& data, const sgl::vk::TexturePtr& densityField);
+    void setUseTransferFunction(bool useTransferFunction);
+    /// Marks the volume as outdated if any of the settings changed.
+    void setVolumeSettings(
+            const glm::vec3& boxMin, const glm::vec3& boxMax, const glm::vec3& sunDirection, float extinction,
+            bool flipYZ);
+    inline void setVolumeDirty() { isVolumeDirty = true; }
+    [[nodiscard]] inline bool getIsVolumeDirty() const { return isVolumeDirty; }
+    inline const sgl::vk::TexturePtr& getTransmittanceTexture() { return transmittanceTexture; }
+protected:
+    void loadShader() override;
+    void createComputeData(sgl::vk::Renderer* renderer, sgl::vk::ComputePipelinePtr& computePipeline) override;
+    void _render() override;
+
+private:
+    const int BLOCK_SIZE = 4;
+    /// Maximum resolution of the volume along each axis. Shadows are smooth, so the grid is downsampled if necessary.
+    const uint32_t MAX_RESOLUTION = 128;
+    CloudDataPtr cloudData;
+    bool useTransferFunction = false;
+    bool isVolumeDirty = true;
+    sgl::vk::TexturePtr densityTexture;
+    sgl::vk::TexturePtr transmittanceTexture;
+    struct PushConstants {
+        glm::vec3 boxMin;
+        float extinction;
+        glm::vec3 boxMax;
+        float stepSize;
+        glm::vec3 sunDirection;
+        int flipYZ;
+    };
+    PushConstants pushConstants{};
+};
+
 #endif //CLOUDRENDERING_VOLUMETRICPATHTRACINGPASS_HPP
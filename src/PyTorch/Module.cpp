@@ -28,23 +28,31 @@
 
 #include <Utils/AppSettings.hpp>
 #include <Utils/File/FileUtils.hpp>
+#include <Utils/File/Logfile.hpp>
 #include <Graphics/Vulkan/Utils/Instance.hpp>
+#include <Graphics/Vulkan/Utils/Device.hpp>
 #include <Graphics/Vulkan/Utils/InteropCuda.hpp>
 #include <Graphics/Vulkan/Image/Image.hpp>
 #include <Graphics/Vulkan/Render/CommandBuffer.hpp>
 
-#include "nanovdb/NanoVDB.h"
-#include "nanovdb/util/Primitives.h"
-#include "CloudData.hpp"
-
 #include "Config.hpp"
-#include "VolumetricPathTracingModuleRenderer.hpp"
 #include "Module.hpp"
+#include "RendererObject.hpp"
 
 TORCH_LIBRARY(vpt, m) {
+    // Custom classes need to be registered before they can be used in the signature of an operator.
+    m.class_<VptRenderFuture>("RenderFuture")
+            .def("wait", &VptRenderFuture::wait)
+            .def("done", &VptRenderFuture::done);
+
     m.def("vpt::initialize", initialize);
     m.def("vpt::cleanup", cleanup);
     m.def("vpt::render_frame", renderFrame);
+    m.def("vpt::submit_render_frame", submitRenderFrame);
+    m.def("vpt::collect_render_frame", collectRenderFrame);
+    m.def("vpt::render_frame_async", renderFrameAsync);
+    m.def("vpt::render_batch", renderBatch);
+    m.def("vpt::render_sweep", renderSweep);
     m.def("vpt::load_cloud_file", loadCloudFile);
     m.def("vpt::load_emission_file", loadEmissionFile);
     m.def("vpt::load_environment_map", loadEnvironmentMap);
@@ -53,12 +61,21 @@ TORCH_LIBRARY(vpt, m) {
     m.def("vpt::set_extinction_base", setExtinctionBase);
     m.def("vpt::set_extinction_scale", setExtinctionScale);
     m.def("vpt::set_vpt_mode", setVPTMode);
+    m.def("vpt::set_sampler_type", setSamplerType);
+    m.def("vpt::set_grid_type", setGridType);
     m.def("vpt::set_camera_position", setCameraPosition);
     m.def("vpt::set_camera_target", setCameraTarget);
     m.def("vpt::set_camera_FOVy", setCameraFOVy);
     m.def("vpt::set_feature_map_type", setFeatureMapType);
     m.def("vpt::set_seed_offset", setSeedOffset);
+    m.def("vpt::set_max_samples_per_dispatch", setMaxSamplesPerDispatch);
+    m.def("vpt::set_use_adaptive_sampling", setUseAdaptiveSampling);
+    m.def("vpt::set_feature_map_sample_limit", setFeatureMapSampleLimit);
+    m.def("vpt::get_adaptive_sampling_stats", getAdaptiveSamplingStats);
+    m.def("vpt::set_use_temporal_accumulation", setUseTemporalAccumulation);
+    m.def("vpt::set_use_sun_transmittance_volume", setUseSunTransmittanceVolume);
     m.def("vpt::get_feature_map", getFeatureMap);
+    m.def("vpt::get_feature_maps", getFeatureMaps);
     m.def("vpt::set_phase_g", setPhaseG);
     m.def("vpt::set_view_projection_matrix_as_previous",setViewProjectionMatrixAsPrevious);
     m.def("vpt::set_use_emission", setUseEmission);
@@ -68,225 +85,63 @@ TORCH_LIBRARY(vpt, m) {
     m.def("vpt::forget_current_bounds", forgetCurrentBounds);
     m.def("vpt::flip_yz_coordinates", flipYZ);
 
+    m.class_<VptRendererObject>("Renderer")
+            .def(torch::init<>())
+            .def("render_frame", &VptRendererObject::renderFrame)
+            .def("submit_render_frame", &VptRendererObject::submitRenderFrame)
+            .def("collect_render_frame", &VptRendererObject::collectRenderFrame)
+            .def("render_frame_async", &VptRendererObject::renderFrameAsync)
+            .def("render_batch", &VptRendererObject::renderBatch)
+            .def("render_sweep", &VptRendererObject::renderSweep)
+            .def("load_cloud_file", &VptRendererObject::loadCloudFile)
+            .def("load_emission_file", &VptRendererObject::loadEmissionFile)
+            .def("load_environment_map", &VptRendererObject::loadEnvironmentMap)
+            .def("set_environment_map_intensity", &VptRendererObject::setEnvironmentMapIntensityFactor)
+            .def("set_scattering_albedo", &VptRendererObject::setScatteringAlbedo)
+            .def("set_extinction_base", &VptRendererObject::setExtinctionBase)
+            .def("set_extinction_scale", &VptRendererObject::setExtinctionScale)
+            .def("set_vpt_mode", &VptRendererObject::setVPTMode)
+            .def("set_sampler_type", &VptRendererObject::setSamplerType)
+            .def("set_grid_type", &VptRendererObject::setGridType)
+            .def("set_camera_position", &VptRendererObject::setCameraPosition)
+            .def("set_camera_target", &VptRendererObject::setCameraTarget)
+            .def("set_camera_FOVy", &VptRendererObject::setCameraFOVy)
+            .def("set_feature_map_type", &VptRendererObject::setFeatureMapType)
+            .def("set_seed_offset", &VptRendererObject::setSeedOffset)
+            .def("set_max_samples_per_dispatch", &VptRendererObject::setMaxSamplesPerDispatch)
+            .def("set_use_adaptive_sampling", &VptRendererObject::setUseAdaptiveSampling)
+            .def("set_feature_map_sample_limit", &VptRendererObject::setFeatureMapSampleLimit)
+            .def("get_adaptive_sampling_stats", &VptRendererObject::getAdaptiveSamplingStats)
+            .def("set_use_temporal_accumulation", &VptRendererObject::setUseTemporalAccumulation)
+            .def("set_use_sun_transmittance_volume", &VptRendererObject::setUseSunTransmittanceVolume)
+            .def("get_feature_map", &VptRendererObject::getFeatureMap)
+            .def("get_feature_maps", &VptRendererObject::getFeatureMaps)
+            .def("set_phase_g", &VptRendererObject::setPhaseG)
+            .def("set_view_projection_matrix_as_previous", &VptRendererObject::setViewProjectionMatrixAsPrevious)
+            .def("set_use_emission", &VptRendererObject::setUseEmission)
+            .def("set_emission_strength", &VptRendererObject::setEmissionStrength)
+            .def("set_emission_cap", &VptRendererObject::setEmissionCap)
+            .def("remember_next_bounds", &VptRendererObject::rememberNextBounds)
+            .def("forget_current_bounds", &VptRendererObject::forgetCurrentBounds)
+            .def("flip_yz_coordinates", &VptRendererObject::flipYZ);
 }
 
-static sgl::vk::Renderer* renderer = nullptr;
-VolumetricPathTracingModuleRenderer* vptRenderer = nullptr;
-
-torch::Tensor renderFrame(torch::Tensor inputTensor, int64_t frameCount) {
-    if (inputTensor.sizes().size() != 3) {
-        sgl::Logfile::get()->throwError(
-                "Error in renderFrame: inputTensor.sizes().size() != 3.", false);
-    }
-    if (inputTensor.size(0) != 3 && inputTensor.size(0) != 4) {
-        sgl::Logfile::get()->throwError(
-                "Error in renderFrame: The number of image channels is not equal to 3 or 4.",
-                false);
-    }
-    if (inputTensor.dtype() != torch::kFloat32) {
-        sgl::Logfile::get()->throwError(
-                "Error in renderFrame: The only data type currently supported is 32-bit float.",
-                false);
-    }
-
-    if (inputTensor.device().type() == torch::DeviceType::CPU) {
-        return renderFrameCpu(inputTensor, frameCount);
-    } else if (inputTensor.device().type() == torch::DeviceType::Vulkan) {
-        return renderFrameVulkan(inputTensor, frameCount);
-    }
-#ifdef SUPPORT_CUDA_INTEROP
-    else if (inputTensor.device().type() == torch::DeviceType::CUDA) {
-        return renderFrameCuda(inputTensor, frameCount);
-    }
-#endif
-    else {
-        sgl::Logfile::get()->throwError("Unsupported PyTorch device type.", false);
-    }
-
-    return {};
-}
-
-torch::Tensor getFeatureMap(torch::Tensor inputTensor, int64_t featureMap) {
-
-    if (inputTensor.sizes().size() != 3) {
-        std::cout << "err" << std::endl;
-
-        sgl::Logfile::get()->throwError(
-                "Error in renderFrame: inputTensor.sizes().size() != 3.", false);
-    }
-    if (inputTensor.size(0) != 3 && inputTensor.size(0) != 4) {
-        std::cout << "err" << std::endl;
-
-        sgl::Logfile::get()->throwError(
-                "Error in renderFrame: The number of image channels is not equal to 3 or 4.",
-                false);
-    }
-    if (inputTensor.dtype() != torch::kFloat32) {
-        std::cout << "err" << std::endl;
-
-        sgl::Logfile::get()->throwError(
-                "Error in renderFrame: The only data type currently supported is 32-bit float.",
-                false);
-    }
-
-    // Expecting tensor of size CxHxW (channels x height x width).
-    const size_t channels = inputTensor.size(0);
-    const size_t height = inputTensor.size(1);
-    const size_t width = inputTensor.size(2);
-
-    if (!inputTensor.is_contiguous()) {
-        inputTensor = inputTensor.contiguous();
-    }
-    //inputTensor.data_ptr();
-
-    if (vptRenderer->settingsDiffer(
-            width, height, uint32_t(channels), inputTensor.device(), inputTensor.dtype())) {
-        vptRenderer->setRenderingResolution(
-                width, height, uint32_t(channels), inputTensor.device(), inputTensor.dtype());
-    }
-
-    if (inputTensor.device().type() == torch::DeviceType::CPU) {
-        void* imageDataPtr = vptRenderer->getFeatureMapCpu(FeatureMapTypeVpt(featureMap));
-
-        torch::Tensor outputTensor = torch::from_blob(
-                imageDataPtr, { int(height), int(width), int(channels) },
-                torch::TensorOptions().dtype(torch::kFloat32).device(inputTensor.device()));
-
-        return outputTensor.permute({2, 0, 1}).detach().clone();//.clone()
-    }
-#ifdef SUPPORT_CUDA_INTEROP
-    else if (inputTensor.device().type() == torch::DeviceType::CUDA) {
-        void* imageDataDevicePtr = vptRenderer->getFeatureMapCuda(FeatureMapTypeVpt(featureMap));
-
-        torch::Tensor outputTensor = torch::from_blob(
-                imageDataDevicePtr, { int(height), int(width), int(channels) },
-                torch::TensorOptions().dtype(torch::kFloat32).device(inputTensor.device()));
-
-        //return outputTensor.permute({2, 0, 1}).detach().clone();
-        return outputTensor.permute({2, 0, 1}).detach();
-    }
-#endif
-    else {
-        sgl::Logfile::get()->throwError("Unsupported PyTorch device type.", false);
-    }
-
-    return {};    
-}
-
-
-torch::Tensor renderFrameCpu(torch::Tensor inputTensor, int64_t frameCount) {
-    std::cout << "Device type CPU." << std::endl;
-
-    // Expecting tensor of size CxHxW (channels x height x width).
-    const size_t channels = inputTensor.size(0);
-    const size_t height = inputTensor.size(1);
-    const size_t width = inputTensor.size(2);
-
-    if (!inputTensor.is_contiguous()) {
-        inputTensor = inputTensor.contiguous();
-    }
-    //inputTensor.data_ptr();
-
-    if (vptRenderer->settingsDiffer(
-            width, height, uint32_t(channels), inputTensor.device(), inputTensor.dtype())) {
-        vptRenderer->setRenderingResolution(
-                width, height, uint32_t(channels), inputTensor.device(), inputTensor.dtype());
-    }
-
-    void* imageDataPtr = vptRenderer->renderFrameCpu(frameCount);
-
-    torch::Tensor outputTensor = torch::from_blob(
-            imageDataPtr, { int(height), int(width), int(channels) },
-            torch::TensorOptions().dtype(torch::kFloat32).device(inputTensor.device()));
-
-    return outputTensor.permute({2, 0, 1}).detach().clone();//.clone()
-}
-
-torch::Tensor renderFrameVulkan(torch::Tensor inputTensor, int64_t frameCount) {
-    std::cout << "Device type Vulkan." << std::endl;
-
-    // Expecting tensor of size CxHxW (channels x height x width).
-    const size_t channels = inputTensor.size(0);
-    const size_t height = inputTensor.size(1);
-    const size_t width = inputTensor.size(2);
-
-    if (!inputTensor.is_contiguous()) {
-        inputTensor = inputTensor.contiguous();
-    }
-    //inputTensor.data_ptr();
-
-    if (vptRenderer->settingsDiffer(
-            width, height, uint32_t(channels), inputTensor.device(), inputTensor.dtype())) {
-        vptRenderer->setRenderingResolution(
-                width, height, uint32_t(channels), inputTensor.device(), inputTensor.dtype());
-    }
-
-    // TODO: Add support for not going the GPU->CPU->GPU route.
-    void* imageDataPtr = vptRenderer->renderFrameCpu(frameCount);
-
-    torch::Tensor outputTensor = torch::from_blob(
-            imageDataPtr, { int(height), int(width), int(channels) },
-            torch::TensorOptions().dtype(torch::kFloat32).device(at::kCPU)).to(inputTensor.device());
-
-    return outputTensor.permute({2, 0, 1}).detach().clone();
-}
-
-#ifdef SUPPORT_CUDA_INTEROP
-torch::Tensor renderFrameCuda(torch::Tensor inputTensor, int64_t frameCount) {
-    std::cout << "Device type CUDA." << std::endl;
-
-    // Expecting tensor of size CxHxW (channels x height x width).
-    const size_t channels = inputTensor.size(0);
-    const size_t height = inputTensor.size(1);
-    const size_t width = inputTensor.size(2);
-
-    if (!inputTensor.is_contiguous()) {
-        inputTensor = inputTensor.contiguous();
-    }
-    //inputTensor.data_ptr();
-
-    if (true || vptRenderer->settingsDiffer(
-            width, height, uint32_t(channels), inputTensor.device(), inputTensor.dtype())) {
-        vptRenderer->setRenderingResolution(
-                width, height, uint32_t(channels), inputTensor.device(), inputTensor.dtype());
-    }
-
-    void* imageDataDevicePtr = vptRenderer->renderFrameCuda(frameCount);
-
-    /*auto* hostData = new float[channels * width * height];
-    cudaMemcpy(hostData, imageDataDevicePtr, sizeof(float) * channels * width * height, cudaMemcpyKind::cudaMemcpyDeviceToHost);
-    sgl::BitmapPtr bitmap(new sgl::Bitmap(int(width), int(height), 32));
-    uint8_t* bitmapData = bitmap->getPixels();
-    for (uint32_t y = 0; y < height; y++) {
-        for (uint32_t x = 0; x < width; x++) {
-            for (uint32_t c = 0; c < 3; c++) {
-                float value = hostData[(x + y * width) * 4 + c];
-                bitmapData[(x + y * width) * 4 + c] = uint8_t(std::clamp(value * 255.0f, 0.0f, 255.0f));
-            }
-            bitmapData[(x + y * width) * 4 + 3] = 255;
-        }
-    }
-    bitmap->savePNG("cuda_test.png", false);
-    delete[] hostData;*/
-
-    torch::Tensor outputTensor = torch::from_blob(
-            imageDataDevicePtr, { int(height), int(width), int(channels) },
-            torch::TensorOptions().dtype(torch::kFloat32).device(inputTensor.device()));
-
-    //return outputTensor.permute({2, 0, 1}).detach().clone();
-    return outputTensor.permute({2, 0, 1}).detach();
-}
-#endif
 
 void vulkanErrorCallback() {
     std::cerr << "Application callback" << std::endl;
 }
 
 const char* argv[] = { "." }; //< Just pass something as argv.
-int libraryReferenceCount = 0;
+int vulkanContextReferenceCount = 0;
 
-void initialize() {
-    if (libraryReferenceCount == 0) {
+std::mutex& getVulkanDeviceMutex() {
+    static std::mutex deviceMutex;
+    return deviceMutex;
+}
+
+void acquireVulkanContext() {
+    std::lock_guard<std::mutex> deviceLock(getVulkanDeviceMutex());
+    if (vulkanContextReferenceCount == 0) {
         // Initialize the filesystem utilities.
         sgl::FileUtils::get()->initialize("CloudRendering", 1, argv);
 
@@ -320,153 +175,197 @@ void initialize() {
                 optionalDeviceExtensions);
         sgl::AppSettings::get()->setPrimaryDevice(device);
         sgl::AppSettings::get()->initializeSubsystems();
+    }
+
+    vulkanContextReferenceCount++;
+}
 
-        renderer = new sgl::vk::Renderer(sgl::AppSettings::get()->getPrimaryDevice());
-        vptRenderer = new VolumetricPathTracingModuleRenderer(renderer);
+void releaseVulkanContext() {
+    std::lock_guard<std::mutex> deviceLock(getVulkanDeviceMutex());
+    vulkanContextReferenceCount--;
 
-        // TODO: Make this configurable.
-        CloudDataPtr cloudData = std::make_shared<CloudData>();
-        cloudData->setNanoVdbGridHandle(nanovdb::createFogVolumeSphere<float>(
-                0.25f, nanovdb::Vec3<float>(0), 0.01f));
-        vptRenderer->setCloudData(cloudData);
-        vptRenderer->setVptMode(VptMode::DELTA_TRACKING);
-        vptRenderer->setUseLinearRGB(true);
+    if (vulkanContextReferenceCount == 0) {
+        sgl::AppSettings::get()->release();
+    }
+}
+
+/// Renderer object used by the free functions of the module (e.g., vpt::render_frame).
+static c10::intrusive_ptr<VptRendererObject> defaultRendererObject;
+static std::mutex defaultRendererObjectMutex;
+int libraryReferenceCount = 0;
+
+void initialize() {
+    std::lock_guard<std::mutex> lock(defaultRendererObjectMutex);
+    if (libraryReferenceCount == 0) {
+        defaultRendererObject = c10::make_intrusive<VptRendererObject>();
     }
 
     libraryReferenceCount++;
 }
 
 void cleanup() {
+    std::lock_guard<std::mutex> lock(defaultRendererObjectMutex);
     libraryReferenceCount--;
 
     if (libraryReferenceCount == 0) {
-        sgl::AppSettings::get()->getPrimaryDevice()->waitIdle();
-        delete vptRenderer;
-        delete renderer;
-        sgl::AppSettings::get()->release();
+        // Threads still using the object keep it (and thus the Vulkan device) alive until they are done.
+        defaultRendererObject.reset();
     }
 }
 
+static c10::intrusive_ptr<VptRendererObject> getDefaultRendererObject() {
+    std::lock_guard<std::mutex> lock(defaultRendererObjectMutex);
+    if (!defaultRendererObject) {
+        sgl::Logfile::get()->throwError(
+                "Error in getDefaultRendererObject: vpt::initialize needs to be called first.", false);
+    }
+    return defaultRendererObject;
+}
+
+torch::Tensor renderFrame(torch::Tensor inputTensor, int64_t frameCount) {
+    return getDefaultRendererObject()->renderFrame(inputTensor, frameCount);
+}
+
+torch::Tensor getFeatureMap(torch::Tensor inputTensor, int64_t featureMap) {
+    return getDefaultRendererObject()->getFeatureMap(inputTensor, featureMap);
+}
+
+torch::Tensor getFeatureMaps(torch::Tensor inputTensor, std::vector<int64_t> featureMaps) {
+    return getDefaultRendererObject()->getFeatureMaps(inputTensor, featureMaps);
+}
+
+int64_t submitRenderFrame(torch::Tensor inputTensor, int64_t frameCount) {
+    return getDefaultRendererObject()->submitRenderFrame(inputTensor, frameCount);
+}
+
+torch::Tensor collectRenderFrame(int64_t frameHandle) {
+    return getDefaultRendererObject()->collectRenderFrame(frameHandle);
+}
+
+c10::intrusive_ptr<VptRenderFuture> renderFrameAsync(torch::Tensor inputTensor, int64_t frameCount) {
+    return getDefaultRendererObject()->renderFrameAsync(inputTensor, frameCount);
+}
+
+torch::Tensor renderBatch(torch::Tensor inputTensor, torch::Tensor cameras, int64_t frameCount) {
+    return getDefaultRendererObject()->renderBatch(inputTensor, cameras, frameCount);
+}
+
+torch::Tensor renderSweep(torch::Tensor inputTensor, torch::Tensor parameters, int64_t frameCount) {
+    return getDefaultRendererObject()->renderSweep(inputTensor, parameters, frameCount);
+}
+
 void loadCloudFile(const std::string& filename) {
-    //std::cout << "loading cloud from " << filename << std::endl;
-    CloudDataPtr cloudData = std::make_shared<CloudData>();
-    cloudData->loadFromFile(filename);
-    vptRenderer->setCloudData(cloudData);
+    getDefaultRendererObject()->loadCloudFile(filename);
 }
 
 void loadEmissionFile(const std::string& filename) {
-    //std::cout << "loading emission from " << filename << std::endl;
-    CloudDataPtr emissionData = std::make_shared<CloudData>();
-    emissionData->loadFromFile(filename);
-    vptRenderer->setEmissionData(emissionData);
+    getDefaultRendererObject()->loadEmissionFile(filename);
 }
 
-
 void loadEnvironmentMap(const std::string& filename) {
-    //std::cout << "loadEnvironmentMap from " << filename << std::endl;
-    vptRenderer->loadEnvironmentMapImage(filename);
+    getDefaultRendererObject()->loadEnvironmentMap(filename);
 }
 
 void setEnvironmentMapIntensityFactor(double intensityFactor) {
-    //std::cout << "setEnvironmentMapIntensityFactor to " << intensityFactor << std::endl;
-    vptRenderer->setEnvironmentMapIntensityFactor(intensityFactor);
-}
-
-bool parseVector3(std::vector<double> data, glm::vec3& out){
-    if (data.size() != 3){
-        std::cerr << "exptected vector of size 3" << std:: endl;
-        return false;
-    }
-    out.x = data[0];
-    out.y = data[1];
-    out.z = data[2];
- 
-    return true;
+    getDefaultRendererObject()->setEnvironmentMapIntensityFactor(intensityFactor);
 }
 
 void setScatteringAlbedo(std::vector<double> albedo) {
-    glm::vec3 vec = glm::vec3(0,0,0);
-    if (parseVector3(albedo, vec)) {
-        //std::cout << "setScatteringAlbedo to " << vec.x << ", " << vec.y << ", " << vec.z << std::endl;
-        vptRenderer->setScatteringAlbedo(vec);
-    }
+    getDefaultRendererObject()->setScatteringAlbedo(albedo);
 }
 
 void setExtinctionScale(double extinctionScale) {
-    //std::cout << "setExtinctionScale to " << extinctionScale << std::endl;
-    vptRenderer->setExtinctionScale(extinctionScale);
+    getDefaultRendererObject()->setExtinctionScale(extinctionScale);
 }
 
 void setExtinctionBase(std::vector<double> extinctionBase) {
-    glm::vec3 vec = glm::vec3(0,0,0);
-    if (parseVector3(extinctionBase, vec)) {
-        //std::cout << "setExtinctionBase to " << vec.x << ", " << vec.y << ", " << vec.z << std::endl;
-        vptRenderer->setExtinctionBase(vec);
-    }
+    getDefaultRendererObject()->setExtinctionBase(extinctionBase);
 }
 
-void setVPTMode(int64_t mode){
-    std::cout << "setVPTMode to " << VPT_MODE_NAMES[mode] << std::endl;
-    vptRenderer->setVptMode(VptMode(mode));
+void setVPTMode(int64_t mode) {
+    getDefaultRendererObject()->setVPTMode(mode);
 }
 
-void setFeatureMapType(int64_t type) {
-    //std::cout << "setFeatureMapType to " << type << std::endl;
-    vptRenderer->setFeatureMapType(FeatureMapTypeVpt(type));
+void setSamplerType(int64_t type) {
+    getDefaultRendererObject()->setSamplerType(type);
 }
 
+void setGridType(int64_t type) {
+    getDefaultRendererObject()->setGridType(type);
+}
+
+void setFeatureMapType(int64_t type) {
+    getDefaultRendererObject()->setFeatureMapType(type);
+}
 
 void setCameraPosition(std::vector<double> cameraPosition) {
-    glm::vec3 vec = glm::vec3(0,0,0);
-    if (parseVector3(cameraPosition, vec)) {
-        //std::cout << "setCameraPosition to " << vec.x << ", " << vec.y << ", " << vec.z << std::endl;
-        vptRenderer->setCameraPosition(vec);
-    }
+    getDefaultRendererObject()->setCameraPosition(cameraPosition);
 }
 
 void setCameraTarget(std::vector<double> cameraTarget) {
-    glm::vec3 vec = glm::vec3(0,0,0);
-    if (parseVector3(cameraTarget, vec)) {
-        //std::cout << "setCameraTarget to " << vec.x << ", " << vec.y << ", " << vec.z << std::endl;
-        vptRenderer->setCameraTarget(vec);
-    }
+    getDefaultRendererObject()->setCameraTarget(cameraTarget);
+}
+
+void setCameraFOVy(double FOVy) {
+    getDefaultRendererObject()->setCameraFOVy(FOVy);
+}
+
+void setSeedOffset(int64_t offset) {
+    getDefaultRendererObject()->setSeedOffset(offset);
+}
+
+void setMaxSamplesPerDispatch(int64_t numSamples) {
+    getDefaultRendererObject()->setMaxSamplesPerDispatch(numSamples);
+}
+
+void setFeatureMapSampleLimit(int64_t limit) {
+    getDefaultRendererObject()->setFeatureMapSampleLimit(limit);
 }
 
-void setCameraFOVy(double FOVy){
-    //std::cout << "setCameraFOVy to " << FOVy << std::endl;
-    vptRenderer->setCameraFOVy(FOVy * sgl::PI / 180);
+void setUseAdaptiveSampling(bool useAdaptiveSampling, double errorThreshold) {
+    getDefaultRendererObject()->setUseAdaptiveSampling(useAdaptiveSampling, errorThreshold);
 }
 
-void setSeedOffset(int64_t offset){
-    //std::cout << "setSeedOffset to " << offset << std::endl;
-    vptRenderer->setCustomSeedOffset(offset);
+std::vector<double> getAdaptiveSamplingStats() {
+    return getDefaultRendererObject()->getAdaptiveSamplingStats();
 }
 
-void setPhaseG(double phaseG){
-    vptRenderer->setPhaseG(phaseG);
+void setUseTemporalAccumulation(bool useTemporalAccumulation, int64_t maxHistoryLength) {
+    getDefaultRendererObject()->setUseTemporalAccumulation(useTemporalAccumulation, maxHistoryLength);
 }
 
-void setViewProjectionMatrixAsPrevious(){
-    vptRenderer->setViewProjectionMatrixAsPrevious();
+void setUseSunTransmittanceVolume(bool useSunTransmittanceVolume) {
+    getDefaultRendererObject()->setUseSunTransmittanceVolume(useSunTransmittanceVolume);
 }
 
-void setEmissionCap(double emissionCap){
-    vptRenderer->setEmissionCap(emissionCap);
+void setPhaseG(double phaseG) {
+    getDefaultRendererObject()->setPhaseG(phaseG);
 }
-void setEmissionStrength(double emissionStrength){
-    vptRenderer->setEmissionStrength(emissionStrength);
+
+void setViewProjectionMatrixAsPrevious() {
+    getDefaultRendererObject()->setViewProjectionMatrixAsPrevious();
 }
-void setUseEmission(bool useEmission){
-    vptRenderer->setUseEmission(useEmission);
+
+void setEmissionCap(double emissionCap) {
+    getDefaultRendererObject()->setEmissionCap(emissionCap);
 }
-void flipYZ(bool flip){
-    vptRenderer->flipYZ(flip);
+
+void setEmissionStrength(double emissionStrength) {
+    getDefaultRendererObject()->setEmissionStrength(emissionStrength);
 }
 
-void rememberNextBounds(){
-    vptRenderer->rememberNextBounds();
+void setUseEmission(bool useEmission) {
+    getDefaultRendererObject()->setUseEmission(useEmission);
 }
 
-void forgetCurrentBounds(){
-    vptRenderer->forgetCurrentBounds();
-}
\ No newline at end of file
+void flipYZ(bool flip) {
+    getDefaultRendererObject()->flipYZ(flip);
+}
+
+void rememberNextBounds() {
+    getDefaultRendererObject()->rememberNextBounds();
+}
+
+void forgetCurrentBounds() {
+    getDefaultRendererObject()->forgetCurrentBounds();
+}
@@ -29,9 +29,12 @@
 #ifndef CLOUDRENDERING_MODULE_HPP
 #define CLOUDRENDERING_MODULE_HPP
 
+#include <mutex>
+
 #include <torch/script.h>
 #include <torch/types.h>
 
+/// Creates (reference counted) the renderer object used by the free functions below.
 MODULE_OP_API void initialize();
 MODULE_OP_API void cleanup();
 
@@ -51,9 +54,26 @@ MODULE_OP_API void setCameraTarget(std::vector<double> cameraTarget);
 MODULE_OP_API void setCameraFOVy(double FOVy);
 
 MODULE_OP_API void setVPTMode(int64_t mode);
+MODULE_OP_API void setSamplerType(int64_t type);
+MODULE_OP_API void setGridType(int64_t type);
 MODULE_OP_API void setFeatureMapType(int64_t type);
 
 MODULE_OP_API void setSeedOffset(int64_t offset);
+MODULE_OP_API void setMaxSamplesPerDispatch(int64_t numSamples);
+MODULE_OP_API void setFeatureMapSampleLimit(int64_t limit);
+MODULE_OP_API void setUseAdaptiveSampling(bool useAdaptiveSampling, double errorThreshold);
+/**
+ * Returns [effective spp, fraction of converged pixels, time to threshold in seconds, spp to threshold]. The last two
+ * values are -1 if not all pixels converged yet. Once all pixels converged, the remaining dispatches are skipped.
+ */
+MODULE_OP_API std::vector<double> getAdaptiveSamplingStats();
+/**
+ * Reprojects the accumulated samples into the new view when the camera moves (or the cloud data changes) instead of
+ * discarding them. At most maxHistoryLength reprojected samples are reused per pixel.
+ */
+MODULE_OP_API void setUseTemporalAccumulation(bool useTemporalAccumulation, int64_t maxHistoryLength);
+/// Biased next event tracking: Sun shadow rays are replaced by a lookup in a precomputed transmittance volume.
+MODULE_OP_API void setUseSunTransmittanceVolume(bool useSunTransmittanceVolume);
 
 MODULE_OP_API void setViewProjectionMatrixAsPrevious();
 
@@ -67,14 +87,45 @@ MODULE_OP_API void forgetCurrentBounds();
 
 MODULE_OP_API torch::Tensor renderFrame(torch::Tensor inputTensor, int64_t frameCount);
 MODULE_OP_API torch::Tensor getFeatureMap(torch::Tensor inputTensor, int64_t frameCount);
+/// Returns the passed feature maps (values of FeatureMapTypeVpt) stacked as K x C x H x W tensor using one readback.
+MODULE_OP_API torch::Tensor getFeatureMaps(torch::Tensor inputTensor, std::vector<int64_t> featureMaps);
+/**
+ * Asynchronous variant of renderFrame for CPU tensors. submitRenderFrame returns a handle without waiting for the GPU,
+ * and collectRenderFrame waits for the frame and returns it. This way, the GPU can already render the next frame while
+ * the last frame is read back. At most three frames can be in flight; older frames that were not collected are dropped.
+ */
+MODULE_OP_API int64_t submitRenderFrame(torch::Tensor inputTensor, int64_t frameCount);
+MODULE_OP_API torch::Tensor collectRenderFrame(int64_t frameHandle);
+/**
+ * Queues a frame for CPU tensors on a render thread and returns a handle (torch.classes.vpt.RenderFuture) immediately.
+ * The frame can be collected using its wait() method, and done() checks whether it is ready. Several requests can be
+ * outstanding at a time; they are rendered in the order they were submitted. Per-frame parameters (camera,
+ * scattering, extinction, emission, environment map intensity and seed offset) are captured at submission time, while
+ * all other setters wait for the outstanding requests.
+ */
+class VptRenderFuture;
+MODULE_OP_API c10::intrusive_ptr<VptRenderFuture> renderFrameAsync(torch::Tensor inputTensor, int64_t frameCount);
+/**
+ * Renders one frame of size C x H x W (given by inputTensor) per camera and returns a tensor of size B x C x H x W.
+ * The cameras are passed either as B x 6 or B x 7 tensor (position, target and optionally FOVy in degrees) or as
+ * B x 4 x 4 tensor of view matrices. All views are rendered using a single submission.
+ */
+MODULE_OP_API torch::Tensor renderBatch(torch::Tensor inputTensor, torch::Tensor cameras, int64_t frameCount);
+/**
+ * Renders one frame of size C x H x W (given by inputTensor) per row of an N x 14 or N x 15 parameter tensor and
+ * returns a tensor of size N x C x H x W. A row holds the scattering albedo (3), extinction scale, phase function g,
+ * sunlight intensity, environment map intensity, seed offset, camera position (3), camera target (3) and optionally
+ * the vertical field of view in degrees. The parameters of the last row remain set afterwards.
+ */
+MODULE_OP_API torch::Tensor renderSweep(torch::Tensor inputTensor, torch::Tensor parameters, int64_t frameCount);
 
-class VolumetricPathTracingModuleRenderer;
-extern VolumetricPathTracingModuleRenderer* vptRenderer;
-
-torch::Tensor renderFrameCpu(torch::Tensor inputTensor, int64_t frameCount);
-torch::Tensor renderFrameVulkan(torch::Tensor inputTensor, int64_t frameCount);
-#ifdef SUPPORT_CUDA_INTEROP
-torch::Tensor renderFrameCuda(torch::Tensor inputTensor, int64_t frameCount);
-#endif
+/**
+ * The Vulkan device and queue are shared by all renderer objects (torch.classes.vpt.Renderer) of the process. The
+ * device is created by the first call to acquireVulkanContext and destroyed when the last reference is released.
+ */
+void acquireVulkanContext();
+void releaseVulkanContext();
+/// Serializes the use of the shared queue, i.e., recording and submitting commands of all renderer objects.
+std::mutex& getVulkanDeviceMutex();
 
 #endif //CLOUDRENDERING_MODULE_HPP
@@ -0,0 +1,630 @@
+/*
+ * BSD 2-Clause License
+ *
+ * Copyright (c) 2022, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdexcept>
+
+#include <Math/Math.hpp>
+#include <Utils/AppSettings.hpp>
+#include <Utils/File/Logfile.hpp>
+#include <Graphics/Vulkan/Utils/Device.hpp>
+#include <Graphics/Vulkan/Render/Renderer.hpp>
+
+#include "nanovdb/NanoVDB.h"
+#include "nanovdb/util/Primitives.h"
+#include "CloudData.hpp"
+
+#include "VolumetricPathTracingModuleRenderer.hpp"
+#include "Module.hpp"
+#include "RendererObject.hpp"
+
+/// 16-bit outputs are converted on the GPU before the readback (CPU) or by PyTorch on the device (CUDA).
+static bool getIsOutputDTypeSupported(caffe2::TypeMeta dtype) {
+    return dtype == torch::kFloat32 || dtype == torch::kFloat16 || dtype == torch::kBFloat16;
+}
+
+static void checkInputTensor(const std::string& functionName, const torch::Tensor& inputTensor) {
+    if (inputTensor.sizes().size() != 3) {
+        sgl::Logfile::get()->throwError(
+                "Error in " + functionName + ": inputTensor.sizes().size() != 3.", false);
+    }
+    if (inputTensor.size(0) != 3 && inputTensor.size(0) != 4) {
+        sgl::Logfile::get()->throwError(
+                "Error in " + functionName + ": The number of image channels is not equal to 3 or 4.",
+                false);
+    }
+    if (!getIsOutputDTypeSupported(inputTensor.dtype())) {
+        sgl::Logfile::get()->throwError(
+                "Error in " + functionName + ": "
+                "The only data types currently supported are float32, float16 and bfloat16.",
+                false);
+    }
+}
+
+/// Converts a list passed from Python to a vector. TorchScript surfaces the exception as a Python RuntimeError.
+static glm::vec3 parseVector3(const std::vector<double>& data, const std::string& functionName) {
+    if (data.size() != 3) {
+        throw std::runtime_error(
+                "Error in " + functionName + ": Expected a list of size 3, but got size "
+                + std::to_string(data.size()) + ".");
+    }
+    return { float(data[0]), float(data[1]), float(data[2]) };
+}
+
+VptRendererObject::VptRendererObject() {
+    acquireVulkanContext();
+
+    std::lock_guard<std::mutex> deviceLock(getVulkanDeviceMutex());
+    renderer = std::make_unique<sgl::vk::Renderer>(sgl::AppSettings::get()->getPrimaryDevice());
+    moduleRenderer = std::make_unique<VolumetricPathTracingModuleRenderer>(renderer.get());
+
+    // Placeholder volume, so that frames can be rendered before load_cloud_file is called.
+    CloudDataPtr cloudData = std::make_shared<CloudData>();
+    cloudData->setNanoVdbGridHandle(nanovdb::createFogVolumeSphere<float>(
+            0.25f, nanovdb::Vec3<float>(0), 0.01f));
+    moduleRenderer->setCloudData(cloudData);
+    moduleRenderer->setVptMode(VptMode::DELTA_TRACKING);
+    moduleRenderer->setUseLinearRGB(true);
+}
+
+VptRendererObject::~VptRendererObject() {
+    // Outstanding requests are still rendered, so no future is left without a result.
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        isShuttingDown = true;
+    }
+    jobConditionVariable.notify_all();
+    if (renderThread.joinable()) {
+        renderThread.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> deviceLock(getVulkanDeviceMutex());
+        sgl::AppSettings::get()->getPrimaryDevice()->waitIdle();
+        moduleRenderer = {};
+        renderer = {};
+    }
+    releaseVulkanContext();
+}
+
+void VptRendererObject::updateRenderingResolution(const torch::Tensor& inputTensor) {
+    // Expecting tensor of size CxHxW (channels x height x width).
+    const size_t channels = inputTensor.size(0);
+    const size_t height = inputTensor.size(1);
+    const size_t width = inputTensor.size(2);
+
+    if (moduleRenderer->settingsDiffer(
+            width, height, uint32_t(channels), inputTensor.device(), inputTensor.dtype())) {
+        moduleRenderer->setRenderingResolution(
+                width, height, uint32_t(channels), inputTensor.device(), inputTensor.dtype());
+    }
+}
+
+torch::Tensor VptRendererObject::renderFrame(torch::Tensor inputTensor, int64_t frameCount) {
+    checkInputTensor("renderFrame", inputTensor);
+
+    if (inputTensor.device().type() == torch::DeviceType::CPU) {
+        return renderFrameCpu(inputTensor, frameCount, getRenderParameters());
+    } else if (inputTensor.device().type() == torch::DeviceType::Vulkan) {
+        return renderFrameVulkan(inputTensor, frameCount, getRenderParameters());
+    }
+#ifdef SUPPORT_CUDA_INTEROP
+    else if (inputTensor.device().type() == torch::DeviceType::CUDA) {
+        return renderFrameCuda(inputTensor, frameCount, getRenderParameters());
+    }
+#endif
+    else {
+        sgl::Logfile::get()->throwError("Unsupported PyTorch device type.", false);
+    }
+
+    return {};
+}
+
+torch::Tensor VptRendererObject::renderFrameCpu(
+        torch::Tensor inputTensor, int64_t frameCount, const RenderParameters& parameters) {
+    std::lock_guard<std::mutex> instanceLock(instanceMutex);
+    std::unique_lock<std::mutex> deviceLock(getVulkanDeviceMutex());
+    applyRenderParameters(parameters);
+    updateRenderingResolution(inputTensor);
+    const uint64_t frameHandle = moduleRenderer->renderFrameCpuAsync(uint32_t(frameCount));
+
+    // Other renderer objects can record and submit their work while this thread waits for the GPU.
+    deviceLock.unlock();
+
+    // The frame is read back in CHW layout directly into the returned tensor.
+    return moduleRenderer->waitForFrameCpu(frameHandle);
+}
+
+torch::Tensor VptRendererObject::renderFrameVulkan(
+        torch::Tensor inputTensor, int64_t frameCount, const RenderParameters& parameters) {
+    std::lock_guard<std::mutex> instanceLock(instanceMutex);
+    std::unique_lock<std::mutex> deviceLock(getVulkanDeviceMutex());
+    applyRenderParameters(parameters);
+    updateRenderingResolution(inputTensor);
+    const uint64_t frameHandle = moduleRenderer->renderFrameCpuAsync(uint32_t(frameCount));
+    deviceLock.unlock();
+
+    // TODO: Add support for not going the GPU->CPU->GPU route.
+    return moduleRenderer->waitForFrameCpu(frameHandle).to(inputTensor.device());
+}
+
+#ifdef SUPPORT_CUDA_INTEROP
+torch::Tensor VptRendererObject::renderFrameCuda(
+        torch::Tensor inputTensor, int64_t frameCount, const RenderParameters& parameters) {
+    // Expecting tensor of size CxHxW (channels x height x width).
+    const size_t channels = inputTensor.size(0);
+    const size_t height = inputTensor.size(1);
+    const size_t width = inputTensor.size(2);
+
+    // The CUDA stream waits for the rendering via a semaphore, so the device lock is only needed for the submission.
+    std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+    applyRenderParameters(parameters);
+    moduleRenderer->setRenderingResolution(
+            width, height, uint32_t(channels), inputTensor.device(), inputTensor.dtype());
+
+    void* imageDataDevicePtr = moduleRenderer->renderFrameCuda(frameCount);
+
+    torch::Tensor outputTensor = torch::from_blob(
+            imageDataDevicePtr, { int(height), int(width), int(channels) },
+            torch::TensorOptions().dtype(torch::kFloat32).device(inputTensor.device()));
+
+    if (inputTensor.dtype() != torch::kFloat32) {
+        return outputTensor.permute({2, 0, 1}).to(inputTensor.dtype()).detach();
+    }
+    return outputTensor.permute({2, 0, 1}).detach();
+}
+#endif
+
+torch::Tensor VptRendererObject::getFeatureMap(torch::Tensor inputTensor, int64_t featureMap) {
+    checkInputTensor("getFeatureMap", inputTensor);
+
+    // Expecting tensor of size CxHxW (channels x height x width).
+    const size_t channels = inputTensor.size(0);
+    const size_t height = inputTensor.size(1);
+    const size_t width = inputTensor.size(2);
+
+    std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+    updateRenderingResolution(inputTensor);
+
+    if (inputTensor.device().type() == torch::DeviceType::CPU) {
+        return moduleRenderer->getFeatureMapCpu(FeatureMapTypeVpt(featureMap));
+    }
+#ifdef SUPPORT_CUDA_INTEROP
+    else if (inputTensor.device().type() == torch::DeviceType::CUDA) {
+        void* imageDataDevicePtr = moduleRenderer->getFeatureMapCuda(FeatureMapTypeVpt(featureMap));
+
+        torch::Tensor outputTensor = torch::from_blob(
+                imageDataDevicePtr, { int(height), int(width), int(channels) },
+                torch::TensorOptions().dtype(torch::kFloat32).device(inputTensor.device()));
+
+        if (inputTensor.dtype() != torch::kFloat32) {
+            return outputTensor.permute({2, 0, 1}).to(inputTensor.dtype()).detach();
+        }
+        return outputTensor.permute({2, 0, 1}).detach();
+    }
+#endif
+    else {
+        sgl::Logfile::get()->throwError("Unsupported PyTorch device type.", false);
+    }
+
+    return {};
+}
+
+torch::Tensor VptRendererObject::getFeatureMaps(torch::Tensor inputTensor, std::vector<int64_t> featureMaps) {
+    checkInputTensor("getFeatureMaps", inputTensor);
+
+    // Invalid feature map types are reported by the renderer.
+    std::vector<FeatureMapTypeVpt> featureMapTypes;
+    for (int64_t featureMap : featureMaps) {
+        featureMapTypes.push_back(FeatureMapTypeVpt(featureMap));
+    }
+
+    // All feature maps are read back to the CPU with one submission.
+    torch::Tensor outputTensor;
+    {
+        std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+        updateRenderingResolution(inputTensor);
+        outputTensor = moduleRenderer->getFeatureMapsCpu(featureMapTypes);
+    }
+    if (inputTensor.device().type() != torch::DeviceType::CPU) {
+        outputTensor = outputTensor.to(inputTensor.device());
+    }
+    return outputTensor;
+}
+
+int64_t VptRendererObject::submitRenderFrame(torch::Tensor inputTensor, int64_t frameCount) {
+    checkInputTensor("submitRenderFrame", inputTensor);
+    if (inputTensor.device().type() != torch::DeviceType::CPU) {
+        sgl::Logfile::get()->throwError(
+                "Error in submitRenderFrame: Asynchronous rendering is only supported for CPU tensors.", false);
+    }
+
+    // Changing the resolution waits for all frames in flight and invalidates their handles.
+    RenderParameters parameters = getRenderParameters();
+    std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+    applyRenderParameters(parameters);
+    updateRenderingResolution(inputTensor);
+    return int64_t(moduleRenderer->renderFrameCpuAsync(uint32_t(frameCount)));
+}
+
+torch::Tensor VptRendererObject::collectRenderFrame(int64_t frameHandle) {
+    // Waiting for the fence of the frame does not touch the queue, so the device lock is not needed.
+    std::lock_guard<std::mutex> instanceLock(instanceMutex);
+    if (!moduleRenderer->getHasFrameData()) {
+        sgl::Logfile::get()->throwError(
+                "Error in collectRenderFrame: No frame was submitted using submit_render_frame.", false);
+    }
+    return moduleRenderer->waitForFrameCpu(uint64_t(frameHandle));
+}
+
+torch::Tensor VptRendererObject::renderBatch(torch::Tensor inputTensor, torch::Tensor cameras, int64_t frameCount) {
+    checkInputTensor("renderBatch", inputTensor);
+
+    // The batch is always read back to the CPU with one submission.
+    torch::Tensor outputTensor;
+    {
+        RenderParameters parameters = getRenderParameters();
+        std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+        applyRenderParameters(parameters);
+        updateRenderingResolution(inputTensor);
+        outputTensor = moduleRenderer->renderBatchCpu(cameras, uint32_t(frameCount));
+    }
+    if (inputTensor.device().type() != torch::DeviceType::CPU) {
+        outputTensor = outputTensor.to(inputTensor.device());
+    }
+    return outputTensor;
+}
+
+torch::Tensor VptRenderFuture::wait() {
+    return future.get();
+}
+
+bool VptRenderFuture::done() {
+    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+c10::intrusive_ptr<VptRenderFuture> VptRendererObject::renderFrameAsync(
+        torch::Tensor inputTensor, int64_t frameCount) {
+    checkInputTensor("renderFrameAsync", inputTensor);
+    if (inputTensor.device().type() != torch::DeviceType::CPU) {
+        sgl::Logfile::get()->throwError(
+                "Error in renderFrameAsync: Asynchronous rendering is only supported for CPU tensors.", false);
+    }
+
+    RenderJob job;
+    job.inputTensor = inputTensor;
+    job.frameCount = frameCount;
+    job.parameters = getRenderParameters();
+    auto renderFuture = c10::make_intrusive<VptRenderFuture>(job.promise.get_future().share());
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        if (!renderThread.joinable()) {
+            renderThread = std::thread(&VptRendererObject::renderThreadMain, this);
+        }
+        jobQueue.push_back(std::move(job));
+    }
+    jobConditionVariable.notify_one();
+    return renderFuture;
+}
+
+void VptRendererObject::renderThreadMain() {
+    while (true) {
+        RenderJob job;
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            jobConditionVariable.wait(lock, [this] { return isShuttingDown || !jobQueue.empty(); });
+            if (jobQueue.empty()) {
+                return;
+            }
+            job = std::move(jobQueue.front());
+            jobQueue.pop_front();
+            isRenderJobRunning = true;
+        }
+
+        try {
+            job.promise.set_value(renderFrameCpu(job.inputTensor, job.frameCount, job.parameters));
+        } catch (...) {
+            job.promise.set_exception(std::current_exception());
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            isRenderJobRunning = false;
+        }
+        jobFinishedConditionVariable.notify_all();
+    }
+}
+
+void VptRendererObject::waitForRenderJobs() {
+    std::unique_lock<std::mutex> lock(jobMutex);
+    jobFinishedConditionVariable.wait(lock, [this] { return jobQueue.empty() && !isRenderJobRunning; });
+}
+
+VptRendererObject::RenderParameters VptRendererObject::getRenderParameters() {
+    std::lock_guard<std::mutex> parametersLock(parametersMutex);
+    return renderParameters;
+}
+
+void VptRendererObject::applyRenderParameters(const RenderParameters& parameters) {
+    if (parameters.cameraPosition) {
+        moduleRenderer->setCameraPosition(*parameters.cameraPosition);
+    }
+    if (parameters.cameraTarget) {
+        moduleRenderer->setCameraTarget(*parameters.cameraTarget);
+    }
+    if (parameters.cameraFOVy) {
+        moduleRenderer->setCameraFOVy(*parameters.cameraFOVy);
+    }
+    if (parameters.scatteringAlbedo) {
+        moduleRenderer->setScatteringAlbedo(*parameters.scatteringAlbedo);
+    }
+    if (parameters.extinctionBase) {
+        moduleRenderer->setExtinctionBase(*parameters.extinctionBase);
+    }
+    if (parameters.extinctionScale) {
+        moduleRenderer->setExtinctionScale(*parameters.extinctionScale);
+    }
+    if (parameters.phaseG) {
+        moduleRenderer->setPhaseG(*parameters.phaseG);
+    }
+    if (parameters.environmentMapIntensityFactor) {
+        moduleRenderer->setEnvironmentMapIntensityFactor(float(*parameters.environmentMapIntensityFactor));
+    }
+    if (parameters.seedOffset) {
+        moduleRenderer->setCustomSeedOffset(*parameters.seedOffset);
+    }
+    if (parameters.emissionCap) {
+        moduleRenderer->setEmissionCap(*parameters.emissionCap);
+    }
+    if (parameters.emissionStrength) {
+        moduleRenderer->setEmissionStrength(*parameters.emissionStrength);
+    }
+    if (parameters.useEmission) {
+        moduleRenderer->setUseEmission(*parameters.useEmission);
+    }
+}
+
+torch::Tensor VptRendererObject::renderSweep(
+        torch::Tensor inputTensor, torch::Tensor parameters, int64_t frameCount) {
+    checkInputTensor("renderSweep", inputTensor);
+
+    // All rows are read back to the CPU with one submission.
+    torch::Tensor outputTensor;
+    {
+        RenderParameters renderParametersOld = getRenderParameters();
+        std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+        applyRenderParameters(renderParametersOld);
+        updateRenderingResolution(inputTensor);
+        outputTensor = moduleRenderer->renderSweepCpu(parameters, uint32_t(frameCount));
+    }
+
+    // The parameters of the last row remain set (the sunlight intensity is not a per-frame parameter).
+    if (parameters.size(0) > 0) {
+        torch::Tensor lastRow = parameters[parameters.size(0) - 1].to(torch::kCPU, torch::kFloat64).contiguous();
+        const double* row = lastRow.data_ptr<double>();
+        std::lock_guard<std::mutex> parametersLock(parametersMutex);
+        renderParameters.scatteringAlbedo = glm::vec3(row[0], row[1], row[2]);
+        renderParameters.extinctionScale = row[3];
+        renderParameters.phaseG = row[4];
+        renderParameters.environmentMapIntensityFactor = row[6];
+        renderParameters.seedOffset = uint32_t(int64_t(row[7]));
+        renderParameters.cameraPosition = glm::vec3(row[8], row[9], row[10]);
+        renderParameters.cameraTarget = glm::vec3(row[11], row[12], row[13]);
+        if (parameters.size(1) == 15) {
+            renderParameters.cameraFOVy = row[14] * sgl::PI / 180.0;
+        }
+    }
+    if (inputTensor.device().type() != torch::DeviceType::CPU) {
+        outputTensor = outputTensor.to(inputTensor.device());
+    }
+    return outputTensor;
+}
+
+void VptRendererObject::loadCloudFile(const std::string& filename) {
+    // Parsing the file does not need the device, so other objects can keep rendering in the meantime.
+    // Structural changes wait for the queued render_frame_async requests, which were submitted with the old data.
+    CloudDataPtr cloudData = std::make_shared<CloudData>();
+    cloudData->loadFromFile(filename);
+    waitForRenderJobs();
+    std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+    moduleRenderer->setCloudData(cloudData);
+}
+
+void VptRendererObject::loadEmissionFile(const std::string& filename) {
+    CloudDataPtr emissionData = std::make_shared<CloudData>();
+    emissionData->loadFromFile(filename);
+    waitForRenderJobs();
+    std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+    moduleRenderer->setEmissionData(emissionData);
+}
+
+void VptRendererObject::loadEnvironmentMap(const std::string& filename) {
+    waitForRenderJobs();
+    std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+    moduleRenderer->loadEnvironmentMapImage(filename);
+}
+
+void VptRendererObject::setEnvironmentMapIntensityFactor(double intensityFactor) {
+    std::lock_guard<std::mutex> parametersLock(parametersMutex);
+    renderParameters.environmentMapIntensityFactor = intensityFactor;
+}
+
+void VptRendererObject::setScatteringAlbedo(std::vector<double> albedo) {
+    glm::vec3 vec = parseVector3(albedo, "setScatteringAlbedo");
+    std::lock_guard<std::mutex> parametersLock(parametersMutex);
+    renderParameters.scatteringAlbedo = vec;
+}
+
+void VptRendererObject::setExtinctionScale(double extinctionScale) {
+    std::lock_guard<std::mutex> parametersLock(parametersMutex);
+    renderParameters.extinctionScale = extinctionScale;
+}
+
+void VptRendererObject::setExtinctionBase(std::vector<double> extinctionBase) {
+    glm::vec3 vec = parseVector3(extinctionBase, "setExtinctionBase");
+    std::lock_guard<std::mutex> parametersLock(parametersMutex);
+    renderParameters.extinctionBase = vec;
+}
+
+void VptRendererObject::setPhaseG(double phaseG) {
+    std::lock_guard<std::mutex> parametersLock(parametersMutex);
+    renderParameters.phaseG = phaseG;
+}
+
+void VptRendererObject::setCameraPosition(std::vector<double> cameraPosition) {
+    glm::vec3 vec = parseVector3(cameraPosition, "setCameraPosition");
+    std::lock_guard<std::mutex> parametersLock(parametersMutex);
+    renderParameters.cameraPosition = vec;
+}
+
+void VptRendererObject::setCameraTarget(std::vector<double> cameraTarget) {
+    glm::vec3 vec = parseVector3(cameraTarget, "setCameraTarget");
+    std::lock_guard<std::mutex> parametersLock(parametersMutex);
+    renderParameters.cameraTarget = vec;
+}
+
+void VptRendererObject::setCameraFOVy(double FOVy) {
+    std::lock_guard<std::mutex> parametersLock(parametersMutex);
+    renderParameters.cameraFOVy = FOVy * sgl::PI / 180;
+}
+
+void VptRendererObject::setVPTMode(int64_t mode) {
+    if (mode < 0 || mode >= int64_t(std::size(VPT_MODE_NAMES))) {
+        sgl::Logfile::get()->throwError("Error in setVPTMode: Invalid VPT mode.");
+    }
+    waitForRenderJobs();
+    std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+    moduleRenderer->setVptMode(VptMode(mode));
+}
+
+void VptRendererObject::setSamplerType(int64_t type) {
+    if (type < 0 || type >= int64_t(std::size(VPT_SAMPLER_TYPE_NAMES))) {
+        sgl::Logfile::get()->throwError("Error in setSamplerType: Invalid sampler type.");
+    }
+    waitForRenderJobs();
+    std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+    moduleRenderer->setSamplerType(VptSamplerType(type));
+}
+
+void VptRendererObject::setGridType(int64_t type) {
+    if (type < 0 || type >= int64_t(std::size(GRID_TYPE_NAMES))) {
+        sgl::Logfile::get()->throwError("Error in setGridType: Invalid grid type.");
+    }
+    waitForRenderJobs();
+    std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+    moduleRenderer->setGridType(GridType(type));
+}
+
+void VptRendererObject::setFeatureMapType(int64_t type) {
+    waitForRenderJobs();
+    std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+    moduleRenderer->setFeatureMapType(FeatureMapTypeVpt(type));
+}
+
+void VptRendererObject::setSeedOffset(int64_t offset) {
+    std::lock_guard<std::mutex> parametersLock(parametersMutex);
+    renderParameters.seedOffset = uint32_t(offset);
+}
+
+void VptRendererObject::setMaxSamplesPerDispatch(int64_t numSamples) {
+    waitForRenderJobs();
+    std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+    moduleRenderer->setMaxNumSamplesPerDispatch(uint32_t(std::max(numSamples, int64_t(1))));
+}
+
+void VptRendererObject::setFeatureMapSampleLimit(int64_t limit) {
+    waitForRenderJobs();
+    std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+    moduleRenderer->setFeatureMapSampleLimit(int(limit));
+}
+
+void VptRendererObject::setUseAdaptiveSampling(bool useAdaptiveSampling, double errorThreshold) {
+    waitForRenderJobs();
+    std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+    moduleRenderer->setUseAdaptiveSampling(useAdaptiveSampling, float(errorThreshold));
+}
+
+std::vector<double> VptRendererObject::getAdaptiveSamplingStats() {
+    std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+    AdaptiveSamplingStats stats = moduleRenderer->getAdaptiveSamplingStats();
+    return {
+            stats.effectiveSpp, stats.convergedFraction, stats.timeToThresholdSeconds,
+            double(stats.numSamplesToThreshold) };
+}
+
+void VptRendererObject::setUseTemporalAccumulation(bool useTemporalAccumulation, int64_t maxHistoryLength) {
+    waitForRenderJobs();
+    std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+    moduleRenderer->setUseTemporalAccumulation(useTemporalAccumulation, int(maxHistoryLength));
+}
+
+void VptRendererObject::setUseSunTransmittanceVolume(bool useSunTransmittanceVolume) {
+    waitForRenderJobs();
+    std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+    moduleRenderer->setUseSunTransmittanceVolume(useSunTransmittanceVolume);
+}
+
+void VptRendererObject::setViewProjectionMatrixAsPrevious() {
+    waitForRenderJobs();
+    RenderParameters parameters = getRenderParameters();
+    std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+    applyRenderParameters(parameters);
+    moduleRenderer->setViewProjectionMatrixAsPrevious();
+}
+
+void VptRendererObject::setEmissionCap(double emissionCap) {
+    std::lock_guard<std::mutex> parametersLock(parametersMutex);
+    renderParameters.emissionCap = emissionCap;
+}
+
+void VptRendererObject::setEmissionStrength(double emissionStrength) {
+    std::lock_guard<std::mutex> parametersLock(parametersMutex);
+    renderParameters.emissionStrength = emissionStrength;
+}
+
+void VptRendererObject::setUseEmission(bool useEmission) {
+    std::lock_guard<std::mutex> parametersLock(parametersMutex);
+    renderParameters.useEmission = useEmission;
+}
+
+void VptRendererObject::flipYZ(bool flip) {
+    waitForRenderJobs();
+    std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+    moduleRenderer->flipYZ(flip);
+}
+
+void VptRendererObject::rememberNextBounds() {
+    waitForRenderJobs();
+    std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+    moduleRenderer->rememberNextBounds();
+}
+
+void VptRendererObject::forgetCurrentBounds() {
+    waitForRenderJobs();
+    std::scoped_lock lock(instanceMutex, getVulkanDeviceMutex());
+    moduleRenderer->forgetCurrentBounds();
+}
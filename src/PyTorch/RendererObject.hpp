@@ -0,0 +1,183 @@
+/*
+ * BSD 2-Clause License
+ *
+ * Copyright (c) 2022, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLOUDRENDERING_RENDEREROBJECT_HPP
+#define CLOUDRENDERING_RENDEREROBJECT_HPP
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <deque>
+#include <thread>
+#include <future>
+#include <condition_variable>
+
+#include <torch/script.h>
+#include <torch/custom_class.h>
+#include <glm/vec3.hpp>
+
+namespace sgl { namespace vk {
+class Renderer;
+}}
+
+class VolumetricPathTracingModuleRenderer;
+
+/**
+ * Handle of a frame requested using render_frame_async (exposed to Python as torch.classes.vpt.RenderFuture).
+ * wait() blocks until the frame was rendered and returns it (or rethrows the error of the render thread), while done()
+ * can be used for polling. The GIL is not held while waiting, as TorchScript releases it for native calls.
+ */
+class VptRenderFuture : public torch::CustomClassHolder {
+public:
+    explicit VptRenderFuture(std::shared_future<torch::Tensor> future) : future(std::move(future)) {}
+    torch::Tensor wait();
+    bool done();
+
+private:
+    std::shared_future<torch::Tensor> future;
+};
+
+/**
+ * Renderer instance exposed to Python as torch.classes.vpt.Renderer. Each instance owns its own module renderer,
+ * camera and cloud data, so several scenes with different settings can be rendered by one process.
+ *
+ * All instances share the Vulkan device and queue of the process (see acquireVulkanContext). Recording and submitting
+ * commands is serialized by the device mutex, while waiting for a frame and copying it to the output tensor only holds
+ * the mutex of the instance. This way, multiple Python threads can render different scenes concurrently.
+ */
+class VptRendererObject : public torch::CustomClassHolder {
+public:
+    VptRendererObject();
+    ~VptRendererObject() override;
+
+    void loadCloudFile(const std::string& filename);
+    void loadEmissionFile(const std::string& filename);
+
+    void loadEnvironmentMap(const std::string& filename);
+    void setEnvironmentMapIntensityFactor(double intensityFactor);
+
+    void setScatteringAlbedo(std::vector<double> albedo);
+    void setExtinctionScale(double extinctionScale);
+    void setExtinctionBase(std::vector<double> extinctionBase);
+    void setPhaseG(double phaseG);
+
+    void setCameraPosition(std::vector<double> cameraPosition);
+    void setCameraTarget(std::vector<double> cameraTarget);
+    void setCameraFOVy(double FOVy);
+
+    void setVPTMode(int64_t mode);
+    void setSamplerType(int64_t type);
+    void setGridType(int64_t type);
+    void setFeatureMapType(int64_t type);
+
+    void setSeedOffset(int64_t offset);
+    void setMaxSamplesPerDispatch(int64_t numSamples);
+    void setFeatureMapSampleLimit(int64_t limit);
+    void setUseAdaptiveSampling(bool useAdaptiveSampling, double errorThreshold);
+    std::vector<double> getAdaptiveSamplingStats();
+    void setUseTemporalAccumulation(bool useTemporalAccumulation, int64_t maxHistoryLength);
+    void setUseSunTransmittanceVolume(bool useSunTransmittanceVolume);
+
+    void setViewProjectionMatrixAsPrevious();
+
+    void setEmissionCap(double emissionCap);
+    void setEmissionStrength(double emissionStrength);
+    void setUseEmission(bool useEmission);
+    void flipYZ(bool flip);
+
+    void rememberNextBounds();
+    void forgetCurrentBounds();
+
+    torch::Tensor renderFrame(torch::Tensor inputTensor, int64_t frameCount);
+    torch::Tensor getFeatureMap(torch::Tensor inputTensor, int64_t featureMap);
+    torch::Tensor getFeatureMaps(torch::Tensor inputTensor, std::vector<int64_t> featureMaps);
+    int64_t submitRenderFrame(torch::Tensor inputTensor, int64_t frameCount);
+    torch::Tensor collectRenderFrame(int64_t frameHandle);
+    torch::Tensor renderBatch(torch::Tensor inputTensor, torch::Tensor cameras, int64_t frameCount);
+    torch::Tensor renderSweep(torch::Tensor inputTensor, torch::Tensor parameters, int64_t frameCount);
+    /**
+     * Queues a frame on the render thread of this object and returns immediately. Requests are rendered in order.
+     * Each request stores a snapshot of the per-frame parameters (camera, scattering albedo, extinction, phase
+     * function, environment map intensity, seed offset and emission), so these can be changed right after submitting.
+     * All other settings (e.g., the cloud data or the VPT mode) wait for the outstanding requests before changing.
+     */
+    c10::intrusive_ptr<VptRenderFuture> renderFrameAsync(torch::Tensor inputTensor, int64_t frameCount);
+
+private:
+    /**
+     * Per-frame parameters. The setters only store them, and they are passed to the module renderer right before
+     * rendering. Parameters that were never set keep the defaults of the module renderer.
+     */
+    struct RenderParameters {
+        std::optional<glm::vec3> cameraPosition, cameraTarget;
+        std::optional<double> cameraFOVy; ///< In radians.
+        std::optional<glm::vec3> scatteringAlbedo, extinctionBase;
+        std::optional<double> extinctionScale, phaseG, environmentMapIntensityFactor;
+        std::optional<uint32_t> seedOffset;
+        std::optional<double> emissionCap, emissionStrength;
+        std::optional<bool> useEmission;
+    };
+    /// Returns a copy of the current per-frame parameters.
+    RenderParameters getRenderParameters();
+    /// Passes the parameters to the module renderer. Expects the instance and device mutexes to be locked.
+    void applyRenderParameters(const RenderParameters& parameters);
+    /// Waits until the render thread has finished all outstanding requests.
+    void waitForRenderJobs();
+
+    /// Changes the resolution, channel count, device or data type if they differ from the input tensor.
+    void updateRenderingResolution(const torch::Tensor& inputTensor);
+    torch::Tensor renderFrameCpu(torch::Tensor inputTensor, int64_t frameCount, const RenderParameters& parameters);
+    torch::Tensor renderFrameVulkan(torch::Tensor inputTensor, int64_t frameCount, const RenderParameters& parameters);
+#ifdef SUPPORT_CUDA_INTEROP
+    torch::Tensor renderFrameCuda(torch::Tensor inputTensor, int64_t frameCount, const RenderParameters& parameters);
+#endif
+
+    std::unique_ptr<sgl::vk::Renderer> renderer;
+    std::unique_ptr<VolumetricPathTracingModuleRenderer> moduleRenderer;
+    std::mutex instanceMutex; ///< Guards the state of this object; always locked before the device mutex.
+    std::mutex parametersMutex; ///< Guards renderParameters, so setters do not wait for frames being rendered.
+    RenderParameters renderParameters;
+
+    // Render thread processing the requests of renderFrameAsync (started on first use).
+    struct RenderJob {
+        torch::Tensor inputTensor;
+        int64_t frameCount = 0;
+        RenderParameters parameters;
+        std::promise<torch::Tensor> promise;
+    };
+    void renderThreadMain();
+    std::thread renderThread;
+    std::mutex jobMutex;
+    std::condition_variable jobConditionVariable;
+    std::condition_variable jobFinishedConditionVariable;
+    std::deque<RenderJob> jobQueue;
+    bool isRenderJobRunning = false;
+    bool isShuttingDown = false;
+};
+
+#endif //CLOUDRENDERING_RENDEREROBJECT_HPP
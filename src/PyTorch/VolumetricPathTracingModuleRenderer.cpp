@@ -26,8 +26,11 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <Math/Math.hpp>
 #include <Utils/AppSettings.hpp>
+#include <Graphics/Vulkan/Shader/ShaderManager.hpp>
 #include <Graphics/Vulkan/Render/CommandBuffer.hpp>
+#include <Graphics/Vulkan/Render/ComputePipeline.hpp>
 #include <ImGui/imgui.h>
 #include "CloudData.hpp"
 
@@ -59,16 +62,11 @@ VolumetricPathTracingModuleRenderer::VolumetricPathTracingModuleRenderer(sgl::vk
     camera->setFOVy(std::atan(1.0f / 2.0f) * 2.0f);
     camera->resetLookAtLocation();
 
-    sgl::vk::Device* device = sgl::AppSettings::get()->getPrimaryDevice();
     vptPass = std::make_shared<VolumetricPathTracingPass>(renderer, &camera);
-    renderFinishedFence = std::make_shared<sgl::vk::Fence>(device);
+    planarBlitPass = std::make_shared<PlanarBlitPass>(renderer);
 }
 
 VolumetricPathTracingModuleRenderer::~VolumetricPathTracingModuleRenderer() {
-    if (imageData) {
-        delete[] imageData;
-        imageData = nullptr;
-    }
     if (outputImageBufferCu) {
         cudaStream_t stream = at::cuda::getCurrentCUDAStream();
         cudaStreamSynchronize(stream);
@@ -110,6 +108,10 @@ void VolumetricPathTracingModuleRenderer::setEnvironmentMapIntensityFactor(float
     vptPass->setEnvironmentMapIntensityFactor(intensityFactor);
 }
 
+void VolumetricPathTracingModuleRenderer::setSunlightIntensity(float intensity) {
+    vptPass->setSunlightIntensity(intensity);
+}
+
 void VolumetricPathTracingModuleRenderer::setScatteringAlbedo(glm::vec3 albedo){
     vptPass->setScatteringAlbedo(albedo);
 }
@@ -130,6 +132,10 @@ void VolumetricPathTracingModuleRenderer::setFeatureMapType(FeatureMapTypeVpt ty
     vptPass->setFeatureMapType(type);
 }
 
+void VolumetricPathTracingModuleRenderer::setFeatureMapSampleLimit(int limit) {
+    vptPass->setFeatureMapSampleLimit(limit);
+}
+
 void VolumetricPathTracingModuleRenderer::setEmissionCap(double emissionCap){
     vptPass->setEmissionCap(emissionCap);
 }
@@ -144,18 +150,31 @@ void VolumetricPathTracingModuleRenderer::flipYZ(bool flip){
 }
 
 void VolumetricPathTracingModuleRenderer::setCameraPosition(glm::vec3 cameraPosition){
+    const bool hasMoved = this->cameraPosition != cameraPosition;
     this->cameraPosition = cameraPosition;
     camera->setPosition(cameraPosition);
     camera->setLookAtViewMatrix(cameraPosition, cameraTarget, camera->getCameraUp());
+    if (hasMoved) {
+        // Restarts the accumulation (or reprojects it in temporal accumulation mode).
+        vptPass->onHasMoved();
+    }
 }
 
 void VolumetricPathTracingModuleRenderer::setCameraTarget(glm::vec3 cameraTarget){
+    const bool hasMoved = this->cameraTarget != cameraTarget;
     this->cameraTarget = cameraTarget;
     camera->setLookAtViewMatrix(cameraPosition, cameraTarget, camera->getCameraUp());
+    if (hasMoved) {
+        vptPass->onHasMoved();
+    }
 }
 
 void VolumetricPathTracingModuleRenderer::setCameraFOVy(double FOVy) {
+    const bool hasMoved = camera->getFOVy() != float(FOVy);
     camera->setFOVy(FOVy);
+    if (hasMoved) {
+        vptPass->onHasMoved();
+    }
 }
 
 void VolumetricPathTracingModuleRenderer::rememberNextBounds() {
@@ -179,26 +198,26 @@ bool VolumetricPathTracingModuleRenderer::settingsDiffer(
 
 void VolumetricPathTracingModuleRenderer::setRenderingResolution(
         uint32_t width, uint32_t height, uint32_t channels, c10::Device torchDevice, caffe2::TypeMeta dtype) {
-    if (dtype != torch::kFloat32) {
+    if (dtype != torch::kFloat32 && dtype != torch::kFloat16 && dtype != torch::kBFloat16) {
         sgl::Logfile::get()->throwError(
                 "Error in VolumetricPathTracingModuleRenderer::setRenderingResolution: "
-                "The only data type currently supported is 32-bit float.", false);
+                "The only data types currently supported are float32, float16 and bfloat16.", false);
     }
     this->numChannels = channels;
     this->dtype = dtype;
     this->deviceType = torchDevice.type();
     sgl::vk::Device* device = sgl::AppSettings::get()->getPrimaryDevice();
 
-    if (imageData) {
-        delete[] imageData;
-        imageData = nullptr;
-    }
     if (renderImageView) {
         device->waitIdle();
         renderer->getFrameCommandBuffers();
     }
     renderImageView = {};
-    renderImageStaging = {};
+    readbackSlots = {};
+    planarImageBuffer = {};
+    batchPlanarImageBuffer = {};
+    batchStagingBuffer = {};
+    batchCapacity = 0;
     outputImageBufferVk = {};
     outputImageBufferCu = {};
     commandBuffers = {};
@@ -222,12 +241,27 @@ void VolumetricPathTracingModuleRenderer::setRenderingResolution(
 
     // TODO: Add support for not going the GPU->CPU->GPU route with torch::DeviceType::Vulkan.
     if (torchDevice.type() == torch::DeviceType::CPU || torchDevice.type() == torch::DeviceType::Vulkan) {
-        imageSettings.tiling = VK_IMAGE_TILING_LINEAR;
-        imageSettings.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-        imageSettings.memoryUsage = VMA_MEMORY_USAGE_GPU_TO_CPU;
-        renderImageStaging = std::make_shared<sgl::vk::Image>(device, imageSettings);
-
-        imageData = new float[width * height * numChannels];
+        // Handles of frames rendered with the old resolution become invalid, as their slots are discarded.
+        // 16-bit data types are converted on the GPU, which halves the size of the staging buffers and the readback.
+        const size_t planarImageSize = dtype.itemsize() * getImageSliceNumElements();
+        planarImageBuffer = std::make_shared<sgl::vk::Buffer>(
+                device, planarImageSize,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+        planarBlitPass->setInputImage(renderImageView);
+        planarBlitPass->setOutputBuffer(planarImageBuffer);
+        planarBlitPass->setNumChannels(numChannels);
+        planarBlitPass->setOutputDType(dtype);
+
+        sgl::vk::CommandPoolType commandPoolType;
+        commandPoolType.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        readbackSlots.resize(NUM_READBACK_SLOTS);
+        for (ReadbackSlot& slot : readbackSlots) {
+            slot.stagingBuffer = std::make_shared<sgl::vk::Buffer>(
+                    device, planarImageSize,
+                    VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+            slot.commandBuffer = std::make_shared<sgl::vk::CommandBuffer>(device, commandPoolType);
+            slot.fence = std::make_shared<sgl::vk::Fence>(device);
+        }
     }
 #ifdef SUPPORT_CUDA_INTEROP
     else if (torchDevice.type() == torch::DeviceType::CUDA) {
@@ -312,6 +346,10 @@ void VolumetricPathTracingModuleRenderer::setUseSparseGrid(bool useSparseGrid) {
     vptPass->setUseSparseGrid(useSparseGrid);
 }
 
+void VolumetricPathTracingModuleRenderer::setGridType(GridType type) {
+    vptPass->setGridType(type);
+}
+
 void VolumetricPathTracingModuleRenderer::setGridInterpolationType(GridInterpolationType type) {
     vptPass->setSparseGridInterpolationType(type);
 }
@@ -321,6 +359,10 @@ void VolumetricPathTracingModuleRenderer::setCustomSeedOffset(uint32_t offset) {
 }
 
 
+void VolumetricPathTracingModuleRenderer::setSamplerType(VptSamplerType samplerType) {
+    vptPass->setSamplerType(samplerType);
+}
+
 void VolumetricPathTracingModuleRenderer::setUseLinearRGB(bool useLinearRGB) {
     vptPass->setUseLinearRGB(useLinearRGB);
 }
@@ -341,51 +383,189 @@ void VolumetricPathTracingModuleRenderer::setVptModeFromString(const std::string
             + vptModeName + "\".");
 }
 
-float* VolumetricPathTracingModuleRenderer::renderFrameCpu(uint32_t numFrames) {
-    // TODO: Allow multiple frames in flight.
-    for (uint32_t i = 0; i < numFrames; i++) {
+void VolumetricPathTracingModuleRenderer::setMaxNumSamplesPerDispatch(uint32_t numSamples) {
+    maxNumSamplesPerDispatch = std::max(numSamples, 1u);
+}
+
+void VolumetricPathTracingModuleRenderer::setUseAdaptiveSampling(bool useAdaptiveSampling, float errorThreshold) {
+    vptPass->setUseAdaptiveSampling(useAdaptiveSampling);
+    vptPass->setAdaptiveSamplingErrorThreshold(errorThreshold);
+}
+
+AdaptiveSamplingStats VolumetricPathTracingModuleRenderer::getAdaptiveSamplingStats() {
+    // The statistics buffer is shared by all frames in flight, so it is only read once all of them have finished.
+    for (ReadbackSlot& slot : readbackSlots) {
+        if (slot.isPending) {
+            slot.fence->wait();
+            slot.fence->reset();
+            slot.isPending = false;
+        }
+    }
+    if (deviceType == torch::DeviceType::CUDA) {
+        // Frames rendered for CUDA tensors are synchronized using semaphores, so no fence can be waited on.
+        renderer->getDevice()->waitIdle();
+    }
+    vptPass->updateAdaptiveSamplingStats();
+    return vptPass->getAdaptiveSamplingStats();
+}
+
+void VolumetricPathTracingModuleRenderer::setUseTemporalAccumulation(
+        bool useTemporalAccumulation, int maxHistoryLength) {
+    vptPass->setUseTemporalAccumulation(useTemporalAccumulation);
+    vptPass->setTemporalMaxHistoryLength(maxHistoryLength);
+}
+
+void VolumetricPathTracingModuleRenderer::setUseSunTransmittanceVolume(bool useSunTransmittanceVolume) {
+    vptPass->setUseSunTransmittanceVolume(useSunTransmittanceVolume);
+}
+
+size_t VolumetricPathTracingModuleRenderer::getImageSliceNumElements() const {
+    size_t numElements = size_t(numChannels) * size_t(getFrameWidth()) * size_t(getFrameHeight());
+    if (dtype.itemsize() == 2) {
+        // The planar blit pass writes two 16-bit elements per word.
+        numElements += numElements % 2;
+    }
+    return numElements;
+}
+
+uint32_t VolumetricPathTracingModuleRenderer::getNumDispatches(uint32_t numFrames) const {
+    return std::max((numFrames + maxNumSamplesPerDispatch - 1) / maxNumSamplesPerDispatch, 1u);
+}
+
+void VolumetricPathTracingModuleRenderer::setDispatchNumSamples(uint32_t dispatchIdx, uint32_t numFrames) {
+    uint32_t numSamplesRemaining = numFrames - std::min(dispatchIdx * maxNumSamplesPerDispatch, numFrames);
+    vptPass->setNumSamplesPerDispatch(int(std::max(std::min(numSamplesRemaining, maxNumSamplesPerDispatch), 1u)));
+}
+
+VolumetricPathTracingModuleRenderer::ReadbackSlot& VolumetricPathTracingModuleRenderer::acquireReadbackSlot() {
+    if (readbackSlots.empty()) {
+        sgl::Logfile::get()->throwError(
+                "Error in VolumetricPathTracingModuleRenderer::acquireReadbackSlot: "
+                "No CPU frame data was allocated.", false);
+    }
+    lastFrameHandle++;
+    ReadbackSlot& slot = readbackSlots.at(lastFrameHandle % NUM_READBACK_SLOTS);
+    if (slot.isPending) {
+        // The frame was never collected. Its data is dropped, but the command buffer can only be reused once done.
+        slot.fence->wait();
+        slot.fence->reset();
+        slot.isPending = false;
+    }
+    slot.frameHandle = lastFrameHandle;
+
+    renderer->pushCommandBuffer(slot.commandBuffer);
+    renderer->beginCommandBuffer();
+    // Commands of the previous submission may still be executing, e.g., the copy of the last frame reading the render
+    // image this frame is about to overwrite.
+    renderer->insertMemoryBarrier(
+            VK_ACCESS_MEMORY_WRITE_BIT | VK_ACCESS_MEMORY_READ_BIT,
+            VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+            VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    return slot;
+}
+
+void VolumetricPathTracingModuleRenderer::submitReadback(ReadbackSlot& slot) {
+    // The channels are de-interleaved on the GPU, so the host can directly copy the staging buffer into a CHW tensor.
+    renderImageView->getImage()->transitionImageLayout(VK_IMAGE_LAYOUT_GENERAL, renderer->getVkCommandBuffer());
+    renderer->insertMemoryBarrier(
+            VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    planarBlitPass->render();
+    renderer->insertMemoryBarrier(
+            VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    planarImageBuffer->copyDataTo(slot.stagingBuffer, renderer->getVkCommandBuffer());
+    renderer->endCommandBuffer();
+
+    renderer->submitToQueue(
+            {}, {}, slot.fence,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    slot.isPending = true;
+}
+
+void VolumetricPathTracingModuleRenderer::recordFrameDispatches(uint32_t numFrames) {
+    // All samples of one dispatch are accumulated in registers, so usually only one dispatch is necessary.
+    // If more are needed, all of them are recorded into one command buffer and the CPU only waits once at the end.
+    // The frame information of each dispatch is updated inside of the command buffer, so the accumulation behaves the
+    // same as with one submission per dispatch.
+    const uint32_t numDispatches = getNumDispatches(numFrames);
+    for (uint32_t i = 0; i < numDispatches; i++) {
+        if (i != 0) {
+            // The dispatch reads the accumulation of the last dispatch and overwrites the uniform data it used.
+            renderer->insertMemoryBarrier(
+                    VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+                    VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        }
         vptPass->setPreviousViewProjMatrix(previousViewProjectionMatrix);
-        renderer->beginCommandBuffer();
+        setDispatchNumSamples(i, numFrames);
         vptPass->render();
-        if (i == numFrames - 1) {
-            renderImageView->getImage()->transitionImageLayout(
-                    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, renderer->getVkCommandBuffer());
-            renderImageStaging->transitionImageLayout(
-                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, renderer->getVkCommandBuffer());
-            renderImageView->getImage()->copyToImage(
-                    renderImageStaging, VK_IMAGE_ASPECT_COLOR_BIT,
-                    renderer->getVkCommandBuffer());
-        }
-        renderer->endCommandBuffer();
+    }
+}
 
-        // Submit the rendering operations in Vulkan.
-        renderer->submitToQueue(
-                {}, {}, renderFinishedFence,
-                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-        renderFinishedFence->wait();
-        renderFinishedFence->reset();
-    }
-
-    uint32_t width = renderImageStaging->getImageSettings().width;
-    uint32_t height = renderImageStaging->getImageSettings().height;
-    VkSubresourceLayout subresourceLayout =
-            renderImageStaging->getSubresourceLayout(VK_IMAGE_ASPECT_COLOR_BIT);
-    auto* mappedData = (float*)renderImageStaging->mapMemory();
-    const auto rowPitch = uint32_t(subresourceLayout.rowPitch / sizeof(float));
-
-    for (uint32_t y = 0; y < height; y++) {
-        for (uint32_t x = 0; x < width; x++) {
-            uint32_t writeLocation = (x + y * width) * numChannels;
-            // We don't need to add "uint32_t(subresourceLayout.offset)" here, as this is automatically done by VMA.
-            uint32_t readLocation = x * 4 + rowPitch * y;
-            for (uint32_t c = 0; c < numChannels; c++) {
-                imageData[writeLocation + c] = mappedData[readLocation + c];
-            }
+uint64_t VolumetricPathTracingModuleRenderer::renderFrameCpuAsync(uint32_t numFrames) {
+    ReadbackSlot& slot = acquireReadbackSlot();
+    recordFrameDispatches(numFrames);
+    submitReadback(slot);
+    return slot.frameHandle;
+}
+
+bool VolumetricPathTracingModuleRenderer::getIsFrameCpuReady(uint64_t frameHandle) {
+    for (ReadbackSlot& slot : readbackSlots) {
+        if (slot.frameHandle == frameHandle) {
+            return !slot.isPending
+                    || vkGetFenceStatus(renderer->getDevice()->getVkDevice(), slot.fence->getVkFence()) == VK_SUCCESS;
         }
     }
+    return false;
+}
+
+void VolumetricPathTracingModuleRenderer::waitForFrameCpu(uint64_t frameHandle, const torch::Tensor& outputTensor) {
+    if (readbackSlots.empty() || frameHandle == 0 || frameHandle > lastFrameHandle) {
+        sgl::Logfile::get()->throwError(
+                "Error in VolumetricPathTracingModuleRenderer::waitForFrameCpu: Invalid frame handle.", false);
+    }
+    ReadbackSlot& slot = readbackSlots.at(frameHandle % NUM_READBACK_SLOTS);
+    if (slot.frameHandle != frameHandle) {
+        sgl::Logfile::get()->throwError(
+                "Error in VolumetricPathTracingModuleRenderer::waitForFrameCpu: The frame was dropped, as more than "
+                + std::to_string(NUM_READBACK_SLOTS) + " frames were submitted without collecting it.", false);
+    }
+    const int64_t width = getFrameWidth();
+    const int64_t height = getFrameHeight();
+    if (outputTensor.device().type() != torch::DeviceType::CPU || outputTensor.dtype() != dtype
+            || !outputTensor.is_contiguous() || outputTensor.numel() != int64_t(numChannels) * height * width) {
+        sgl::Logfile::get()->throwError(
+                "Error in VolumetricPathTracingModuleRenderer::waitForFrameCpu: The output tensor must be a contiguous "
+                "CPU tensor of the rendering data type with channels * height * width elements.", false);
+    }
+
+    // The staging buffer keeps the data until the slot is reused, so a frame can be collected multiple times.
+    if (slot.isPending) {
+        slot.fence->wait();
+        slot.fence->reset();
+        slot.isPending = false;
+    }
 
-    renderImageStaging->unmapMemory();
-    return imageData;
+    // A single (vectorized and multi-threaded) PyTorch copy out of the mapped memory.
+    void* mappedData = slot.stagingBuffer->mapMemory();
+    torch::Tensor stagingTensor = torch::from_blob(
+            mappedData, { int64_t(numChannels), height, width },
+            torch::TensorOptions().dtype(dtype).device(at::kCPU));
+    outputTensor.view({ int64_t(numChannels), height, width }).copy_(stagingTensor);
+    slot.stagingBuffer->unmapMemory();
+}
+
+torch::Tensor VolumetricPathTracingModuleRenderer::waitForFrameCpu(uint64_t frameHandle) {
+    torch::Tensor outputTensor = torch::empty(
+            { int64_t(numChannels), int64_t(getFrameHeight()), int64_t(getFrameWidth()) },
+            torch::TensorOptions().dtype(dtype).device(at::kCPU));
+    waitForFrameCpu(frameHandle, outputTensor);
+    return outputTensor;
+}
+
+torch::Tensor VolumetricPathTracingModuleRenderer::renderFrameCpu(uint32_t numFrames) {
+    return waitForFrameCpu(renderFrameCpuAsync(numFrames));
 }
 
 float* VolumetricPathTracingModuleRenderer::renderFrameVulkan(uint32_t numFrames) {
@@ -401,8 +581,9 @@ float* VolumetricPathTracingModuleRenderer::renderFrameCuda(uint32_t numFrames)
                 "sgl::vk::getIsCudaDeviceApiFunctionTableInitialized() returned false.", false);
     }
 
-    if (size_t(numFrames) > commandBuffers.size() || size_t(numFrames) > interFrameSemaphores.size() + 1) {
-        this->createCommandStructures(numFrames);
+    const uint32_t numDispatches = getNumDispatches(numFrames);
+    if (size_t(numDispatches) > commandBuffers.size() || size_t(numDispatches) > interFrameSemaphores.size() + 1) {
+        this->createCommandStructures(numDispatches);
 
         //sgl::Logfile::get()->throwError(
         //        "Error in VolumetricPathTracingModuleRenderer::renderFrameCuda: Frame data was not allocated.",
@@ -413,7 +594,7 @@ float* VolumetricPathTracingModuleRenderer::renderFrameCuda(uint32_t numFrames)
 
     timelineValue++;
 
-    for (uint32_t frameIndex = 0; frameIndex < numFrames; frameIndex++) {
+    for (uint32_t frameIndex = 0; frameIndex < numDispatches; frameIndex++) {
         sgl::vk::CommandBufferPtr commandBuffer = commandBuffers.at(frameIndex);
         sgl::vk::SemaphorePtr waitSemaphore;
         sgl::vk::SemaphorePtr signalSemaphore;
@@ -425,7 +606,7 @@ float* VolumetricPathTracingModuleRenderer::renderFrameCuda(uint32_t numFrames)
             waitSemaphore = interFrameSemaphores.at(frameIndex - 1);
             waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
         }
-        if (frameIndex == numFrames - 1) {
+        if (frameIndex == numDispatches - 1) {
             signalSemaphore = renderFinishedSemaphore;
         } else {
             signalSemaphore = interFrameSemaphores.at(frameIndex);
@@ -441,10 +622,11 @@ float* VolumetricPathTracingModuleRenderer::renderFrameCuda(uint32_t numFrames)
         renderer->beginCommandBuffer();
 
         vptPass->setPreviousViewProjMatrix(previousViewProjectionMatrix);
+        setDispatchNumSamples(frameIndex, numFrames);
 
         vptPass->render();
 
-        if (frameIndex == numFrames - 1) {
+        if (frameIndex == numDispatches - 1) {
             renderImageView->getImage()->transitionImageLayout(
                     VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, renderer->getVkCommandBuffer());
             renderImageView->getImage()->copyToBuffer(
@@ -473,53 +655,244 @@ float* VolumetricPathTracingModuleRenderer::renderFrameCuda(uint32_t numFrames)
 }
 #endif
 
-float* VolumetricPathTracingModuleRenderer::getFeatureMapCpu(FeatureMapTypeVpt featureMap) {
+torch::Tensor VolumetricPathTracingModuleRenderer::renderBatchCpu(const torch::Tensor& cameras, uint32_t numFrames) {
+    const bool isViewMatrixBatch = cameras.dim() == 3 && cameras.size(1) == 4 && cameras.size(2) == 4;
+    const bool isViewParamBatch = cameras.dim() == 2 && (cameras.size(1) == 6 || cameras.size(1) == 7);
+    if (!isViewMatrixBatch && !isViewParamBatch) {
+        sgl::Logfile::get()->throwError(
+                "Error in VolumetricPathTracingModuleRenderer::renderBatchCpu: The camera tensor must be of size "
+                "B x 6, B x 7 or B x 4 x 4.", false);
+    }
+    if (!getHasFrameData()) {
+        sgl::Logfile::get()->throwError(
+                "Error in VolumetricPathTracingModuleRenderer::renderBatchCpu: No frame data was allocated.", false);
+    }
+
+    const auto batchSize = uint32_t(cameras.size(0));
+    if (batchSize == 0) {
+        return torch::empty(
+                { 0, int64_t(numChannels), int64_t(getFrameHeight()), int64_t(getFrameWidth()) },
+                torch::TensorOptions().dtype(dtype).device(at::kCPU));
+    }
+    torch::Tensor camerasCpu = cameras.to(torch::kCPU, torch::kFloat32).contiguous();
+    const float* cameraData = camerasCpu.data_ptr<float>();
+    ensureBatchCapacity(batchSize);
+
+    // The views are rendered with the shared camera object, which is restored afterwards.
+    const glm::vec3 cameraPositionOld = camera->getPosition();
+    const glm::mat4 viewMatrixOld = camera->getViewMatrix();
+    const float fovyOld = camera->getFOVy();
 
-    sgl::vk::TexturePtr texture = vptPass->getFeatureMapTexture(featureMap);
-    
     renderer->beginCommandBuffer();
+    for (uint32_t b = 0; b < batchSize; b++) {
+        // Asynchronously submitted frames or the last view may still use the render and accumulation images.
+        renderer->insertMemoryBarrier(
+                VK_ACCESS_MEMORY_WRITE_BIT | VK_ACCESS_MEMORY_READ_BIT,
+                VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+                VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+        if (isViewParamBatch) {
+            const float* viewParams = cameraData + b * cameras.size(1);
+            glm::vec3 position(viewParams[0], viewParams[1], viewParams[2]);
+            glm::vec3 target(viewParams[3], viewParams[4], viewParams[5]);
+            camera->setPosition(position);
+            camera->setLookAtViewMatrix(position, target, camera->getCameraUp());
+            if (cameras.size(1) == 7) {
+                camera->setFOVy(viewParams[6] * sgl::PI / 180.0f);
+            }
+        } else {
+            // PyTorch tensors are row-major, GLM matrices are column-major.
+            const float* viewMatrixData = cameraData + b * 16;
+            glm::mat4 viewMatrix;
+            for (int row = 0; row < 4; row++) {
+                for (int col = 0; col < 4; col++) {
+                    viewMatrix[col][row] = viewMatrixData[row * 4 + col];
+                }
+            }
+            camera->overwriteViewMatrix(viewMatrix);
+        }
+        vptPass->discardAccumulation();
+        recordFrameDispatches(numFrames);
+        recordBatchImageCopy(b);
+    }
+    torch::Tensor outputTensor = submitBatchReadback(batchSize);
 
-    renderer->transitionImageLayout(texture->getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-    renderer->transitionImageLayout(renderImageView->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    texture->getImage()->blit(renderImageView->getImage(), renderer->getVkCommandBuffer());
+    camera->setFOVy(fovyOld);
+    camera->setPosition(cameraPositionOld);
+    camera->overwriteViewMatrix(viewMatrixOld);
+    vptPass->discardAccumulation();
+    return outputTensor;
+}
 
-    renderImageView->getImage()->transitionImageLayout(
-            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, renderer->getVkCommandBuffer());
-    renderImageStaging->transitionImageLayout(
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, renderer->getVkCommandBuffer());
-    renderImageView->getImage()->copyToImage(
-            renderImageStaging, VK_IMAGE_ASPECT_COLOR_BIT,
-            renderer->getVkCommandBuffer());
-    
+torch::Tensor VolumetricPathTracingModuleRenderer::renderSweepCpu(
+        const torch::Tensor& parameters, uint32_t numFrames) {
+    if (parameters.dim() != 2 || (parameters.size(1) != 14 && parameters.size(1) != 15)) {
+        sgl::Logfile::get()->throwError(
+                "Error in VolumetricPathTracingModuleRenderer::renderSweepCpu: The parameter tensor must be of size "
+                "N x 14 or N x 15.", false);
+    }
+    if (!getHasFrameData()) {
+        sgl::Logfile::get()->throwError(
+                "Error in VolumetricPathTracingModuleRenderer::renderSweepCpu: No frame data was allocated.", false);
+    }
+
+    const auto numRows = uint32_t(parameters.size(0));
+    if (numRows == 0) {
+        return torch::empty(
+                { 0, int64_t(numChannels), int64_t(getFrameHeight()), int64_t(getFrameWidth()) },
+                torch::TensorOptions().dtype(dtype).device(at::kCPU));
+    }
+    // Double precision keeps large seed offsets exact.
+    torch::Tensor parametersCpu = parameters.to(torch::kCPU, torch::kFloat64).contiguous();
+    const double* parameterData = parametersCpu.data_ptr<double>();
+    ensureBatchCapacity(numRows);
+
+    renderer->beginCommandBuffer();
+    for (uint32_t i = 0; i < numRows; i++) {
+        // Asynchronously submitted frames or the last row may still use the render and accumulation images.
+        renderer->insertMemoryBarrier(
+                VK_ACCESS_MEMORY_WRITE_BIT | VK_ACCESS_MEMORY_READ_BIT,
+                VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+                VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+        // The uniform buffers are updated inside of the command buffer by the dispatches of every row.
+        const double* row = parameterData + i * parameters.size(1);
+        setScatteringAlbedo(glm::vec3(row[0], row[1], row[2]));
+        setExtinctionScale(row[3]);
+        setPhaseG(row[4]);
+        setSunlightIntensity(float(row[5]));
+        setEnvironmentMapIntensityFactor(float(row[6]));
+        setCustomSeedOffset(uint32_t(int64_t(row[7])));
+        setCameraPosition(glm::vec3(row[8], row[9], row[10]));
+        setCameraTarget(glm::vec3(row[11], row[12], row[13]));
+        if (parameters.size(1) == 15) {
+            camera->setFOVy(float(row[14]) * sgl::PI / 180.0f);
+        }
+        vptPass->discardAccumulation();
+        recordFrameDispatches(numFrames);
+        recordBatchImageCopy(i);
+    }
+    return submitBatchReadback(numRows);
+}
+
+torch::Tensor VolumetricPathTracingModuleRenderer::getFeatureMapsCpu(
+        const std::vector<FeatureMapTypeVpt>& featureMaps) {
+    const auto numFeatureMaps = uint32_t(featureMaps.size());
+    if (numFeatureMaps == 0) {
+        return torch::empty(
+                { 0, int64_t(numChannels), int64_t(getFrameHeight()), int64_t(getFrameWidth()) },
+                torch::TensorOptions().dtype(dtype).device(at::kCPU));
+    }
+    std::vector<sgl::vk::TexturePtr> textures;
+    for (FeatureMapTypeVpt featureMap : featureMaps) {
+        sgl::vk::TexturePtr texture = vptPass->getFeatureMapTexture(featureMap);
+        if (!texture) {
+            sgl::Logfile::get()->throwError(
+                    "Error in VolumetricPathTracingModuleRenderer::getFeatureMapsCpu: Invalid feature map type "
+                    + std::to_string(int(featureMap)) + ".", false);
+        }
+        textures.push_back(texture);
+    }
+    ensureBatchCapacity(numFeatureMaps);
+
+    renderer->beginCommandBuffer();
+    renderer->insertMemoryBarrier(
+            VK_ACCESS_MEMORY_WRITE_BIT | VK_ACCESS_MEMORY_READ_BIT,
+            VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+            VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    for (uint32_t i = 0; i < numFeatureMaps; i++) {
+        const sgl::vk::TexturePtr& texture = textures.at(i);
+        if (i != 0) {
+            // The blit overwrites the render image, which is read by the planar copy of the last feature map.
+            renderer->insertMemoryBarrier(
+                    VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        }
+        // The blit converts the different formats of the feature maps (e.g., RG32F for the depth) to RGBA32F.
+        renderer->transitionImageLayout(texture->getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+        renderer->transitionImageLayout(renderImageView->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        texture->getImage()->blit(renderImageView->getImage(), renderer->getVkCommandBuffer());
+        recordBatchImageCopy(i);
+    }
+    return submitBatchReadback(numFeatureMaps);
+}
+
+void VolumetricPathTracingModuleRenderer::ensureBatchCapacity(uint32_t numImages) {
+    if (numImages <= batchCapacity) {
+        return;
+    }
+    // The descriptor set of the batch pass may still be in use by the last batch.
+    sgl::vk::Device* device = renderer->getDevice();
+    device->waitIdle();
+    const size_t batchBufferSize = dtype.itemsize() * getImageSliceNumElements() * numImages;
+    batchPlanarImageBuffer = std::make_shared<sgl::vk::Buffer>(
+            device, batchBufferSize,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    batchStagingBuffer = std::make_shared<sgl::vk::Buffer>(
+            device, batchBufferSize,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+    if (!batchBlitPass) {
+        batchBlitPass = std::make_shared<PlanarBlitPass>(renderer);
+        batchFinishedFence = std::make_shared<sgl::vk::Fence>(device);
+    }
+    batchBlitPass->setInputImage(renderImageView);
+    batchBlitPass->setOutputBuffer(batchPlanarImageBuffer);
+    batchBlitPass->setNumChannels(numChannels);
+    batchBlitPass->setOutputDType(dtype);
+    batchCapacity = numImages;
+}
+
+void VolumetricPathTracingModuleRenderer::recordBatchImageCopy(uint32_t imageIndex) {
+    const size_t imageSize = getImageSliceNumElements();
+    renderImageView->getImage()->transitionImageLayout(VK_IMAGE_LAYOUT_GENERAL, renderer->getVkCommandBuffer());
+    renderer->insertMemoryBarrier(
+            VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    batchBlitPass->setOutputOffset(uint32_t(imageIndex * imageSize));
+    batchBlitPass->render();
+}
+
+torch::Tensor VolumetricPathTracingModuleRenderer::submitBatchReadback(uint32_t numImages) {
+    renderer->insertMemoryBarrier(
+            VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    batchPlanarImageBuffer->copyDataTo(batchStagingBuffer, renderer->getVkCommandBuffer());
     renderer->endCommandBuffer();
 
-    // Submit the rendering operations in Vulkan.
     renderer->submitToQueue(
-            {}, {}, renderFinishedFence,
+            {}, {}, batchFinishedFence,
             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-    renderFinishedFence->wait();
-    renderFinishedFence->reset();
-    
-    uint32_t width = renderImageStaging->getImageSettings().width;
-    uint32_t height = renderImageStaging->getImageSettings().height;
-    VkSubresourceLayout subresourceLayout =
-            renderImageStaging->getSubresourceLayout(VK_IMAGE_ASPECT_COLOR_BIT);
-    auto* mappedData = (float*)renderImageStaging->mapMemory();
-    const auto rowPitch = uint32_t(subresourceLayout.rowPitch / sizeof(float));
-
-    for (uint32_t y = 0; y < height; y++) {
-        for (uint32_t x = 0; x < width; x++) {
-            uint32_t writeLocation = (x + y * width) * numChannels;
-            // We don't need to add "uint32_t(subresourceLayout.offset)" here, as this is automatically done by VMA.
-            uint32_t readLocation = x * 4 + rowPitch * y;
-            for (uint32_t c = 0; c < numChannels; c++) {
-                imageData[writeLocation + c] = mappedData[readLocation + c];
-            }
-        }
-    }
+    batchFinishedFence->wait();
+    batchFinishedFence->reset();
+
+    const auto width = int64_t(getFrameWidth());
+    const auto height = int64_t(getFrameHeight());
+    const std::vector<int64_t> sizes = { int64_t(numImages), int64_t(numChannels), height, width };
+    // The slices of 16-bit images may be padded to an even number of elements.
+    const std::vector<int64_t> strides = { int64_t(getImageSliceNumElements()), height * width, width, 1 };
+    torch::Tensor outputTensor = torch::empty(
+            sizes, torch::TensorOptions().dtype(dtype).device(at::kCPU));
+    void* mappedData = batchStagingBuffer->mapMemory();
+    torch::Tensor stagingTensor = torch::from_blob(
+            mappedData, sizes, strides, torch::TensorOptions().dtype(dtype).device(at::kCPU));
+    outputTensor.copy_(stagingTensor);
+    batchStagingBuffer->unmapMemory();
+    return outputTensor;
+}
+
+torch::Tensor VolumetricPathTracingModuleRenderer::getFeatureMapCpu(FeatureMapTypeVpt featureMap) {
+
+    sgl::vk::TexturePtr texture = vptPass->getFeatureMapTexture(featureMap);
 
-    renderImageStaging->unmapMemory();
-    return imageData;
+    ReadbackSlot& slot = acquireReadbackSlot();
+
+    renderer->transitionImageLayout(texture->getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    renderer->transitionImageLayout(renderImageView->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    texture->getImage()->blit(renderImageView->getImage(), renderer->getVkCommandBuffer());
+
+    submitReadback(slot);
+    return waitForFrameCpu(slot.frameHandle);
 }
 
 
@@ -579,4 +952,75 @@ float* VolumetricPathTracingModuleRenderer::getFeatureMapCuda(FeatureMapTypeVpt
     //cudaStreamSynchronize(stream);
     return (float*)outputImageBufferCu->getCudaDevicePtr();
     
-}
\ No newline at end of file
+}
+
+PlanarBlitPass::PlanarBlitPass(sgl::vk::Renderer* renderer) : ComputePass(renderer) {
+}
+
+void PlanarBlitPass::setInputImage(const sgl::vk::ImageViewPtr& _inputImage) {
+    inputImage = _inputImage;
+    if (computeData) {
+        computeData->setStaticImageView(inputImage, "inputImage");
+    }
+}
+
+void PlanarBlitPass::setOutputBuffer(const sgl::vk::BufferPtr& _outputBuffer) {
+    outputBuffer = _outputBuffer;
+    if (computeData) {
+        computeData->setStaticBuffer(outputBuffer, "OutputBuffer");
+    }
+}
+
+void PlanarBlitPass::setNumChannels(uint32_t _numChannels) {
+    pushConstants.numChannels = _numChannels;
+}
+
+void PlanarBlitPass::setOutputOffset(uint32_t _outputOffset) {
+    pushConstants.outputOffset = _outputOffset;
+}
+
+void PlanarBlitPass::setOutputDType(caffe2::TypeMeta _outputDType) {
+    if (outputDType != _outputDType) {
+        outputDType = _outputDType;
+        setShaderDirty();
+    }
+}
+
+void PlanarBlitPass::loadShader() {
+    std::map<std::string, std::string> preprocessorDefines;
+    preprocessorDefines.insert(std::make_pair("BLOCK_SIZE", std::to_string(BLOCK_SIZE)));
+    if (outputDType == torch::kFloat16) {
+        preprocessorDefines.insert(std::make_pair("OUTPUT_FLOAT16", ""));
+    } else if (outputDType == torch::kBFloat16) {
+        preprocessorDefines.insert(std::make_pair("OUTPUT_BFLOAT16", ""));
+    }
+    shaderStages = sgl::vk::ShaderManager->getShaderStages(
+            { "PlanarBlit.Compute" }, preprocessorDefines);
+}
+
+void PlanarBlitPass::createComputeData(sgl::vk::Renderer* renderer, sgl::vk::ComputePipelinePtr& computePipeline) {
+    computeData = std::make_shared<sgl::vk::ComputeData>(renderer, computePipeline);
+    computeData->setStaticImageView(inputImage, "inputImage");
+    computeData->setStaticBuffer(outputBuffer, "OutputBuffer");
+}
+
+void PlanarBlitPass::_render() {
+    auto width = int(inputImage->getImage()->getImageSettings().width);
+    auto height = int(inputImage->getImage()->getImageSettings().height);
+    renderer->pushConstants(
+            std::static_pointer_cast<sgl::vk::Pipeline>(computeData->getComputePipeline()),
+            VK_SHADER_STAGE_COMPUTE_BIT, 0, pushConstants);
+    if (outputDType.itemsize() == 2) {
+        // One invocation per word of two elements. The work groups are spread over two dimensions, as the number of
+        // work groups per dimension may be limited to 65535.
+        const uint32_t numWords = (pushConstants.numChannels * uint32_t(width * height) + 1u) / 2u;
+        const auto groupSize = uint32_t(BLOCK_SIZE * BLOCK_SIZE);
+        const uint32_t numGroups = (numWords + groupSize - 1u) / groupSize;
+        const uint32_t numGroupsX = std::min(numGroups, 4096u);
+        renderer->dispatch(computeData, numGroupsX, (numGroups + numGroupsX - 1u) / numGroupsX, 1);
+    } else {
+        renderer->dispatch(
+                computeData,
+                sgl::iceil(width, BLOCK_SIZE), sgl::iceil(height, BLOCK_SIZE), 1);
+    }
+}
@@ -42,12 +42,15 @@ typedef std::shared_ptr<CloudData> CloudDataPtr;
 class VolumetricPathTracingPass;
 enum class VptMode;
 enum class GridInterpolationType;
+enum class GridType;
 
 namespace sgl {
 class Camera;
 typedef std::shared_ptr<Camera> CameraPtr;
 }
 
+class PlanarBlitPass;
+
 class VolumetricPathTracingModuleRenderer {
 public:
     explicit VolumetricPathTracingModuleRenderer(sgl::vk::Renderer* renderer);
@@ -59,12 +62,15 @@ public:
 
     void loadEnvironmentMapImage(const std::string& filename);
     void setEnvironmentMapIntensityFactor(float intensityFactor);
+    void setSunlightIntensity(float intensity);
 
     void setScatteringAlbedo(glm::vec3 albedo);
     void setExtinctionScale(double extinctionScale);
     void setExtinctionBase(glm::vec3 extinctionBase);
     void setPhaseG(double phaseG);
     void setFeatureMapType(FeatureMapTypeVpt type);
+    /// Feature maps are only updated for the first 'limit' samples (0 means no limit).
+    void setFeatureMapSampleLimit(int limit);
 
     void setEmissionCap(double emissionCap);
     void setEmissionStrength(double emissionStrength);
@@ -94,11 +100,16 @@ public:
 
     /// Sets whether a dense or sparse grid should be used.
     void setUseSparseGrid(bool useSparseGrid);
+    /// Sets the representation of the density grid (dense, NanoVDB or brick map).
+    void setGridType(GridType type);
     void setGridInterpolationType(GridInterpolationType type);
 
     /// Sets an additive offset for the random seed in the VPT shader.
     void setCustomSeedOffset(uint32_t offset);
 
+    /// Sets the sample generator used by the path tracer.
+    void setSamplerType(VptSamplerType samplerType);
+
     /// Sets whether linear RGB or sRGB should be used for rendering.
     void setUseLinearRGB(bool useLinearRGB);
 
@@ -107,16 +118,79 @@ public:
     void setVptModeFromString(const std::string& vptModeName);
 
     /**
-     * Renders the path traced volume object to the scene framebuffer and returns a CPU pointer to the image data.
+     * Sets the maximum number of samples per pixel traced by a single compute dispatch. Larger values reduce the
+     * number of dispatches and accumulation image round trips, but increase the run time of a single dispatch.
+     */
+    void setMaxNumSamplesPerDispatch(uint32_t numSamples);
+
+    /// Sets whether pixels stop receiving samples once their relative error falls below the passed threshold.
+    void setUseAdaptiveSampling(bool useAdaptiveSampling, float errorThreshold);
+    /// Waits for all frames in flight (they stay collectable) and reads back the adaptive sampling statistics.
+    AdaptiveSamplingStats getAdaptiveSamplingStats();
+
+    /// Sets whether to reuse the reprojected history (at most maxHistoryLength samples) when the accumulation restarts.
+    void setUseTemporalAccumulation(bool useTemporalAccumulation, int maxHistoryLength);
+
+    /// Sets whether next event tracking looks up the transmittance toward the sun in a precomputed volume (biased).
+    void setUseSunTransmittanceVolume(bool useSunTransmittanceVolume);
+
+    /**
+     * Renders the path traced volume object to the scene framebuffer and returns the image data.
      * @param numFrames The number of frames to accumulate.
-     * @return A CPU floating point array of size width * height * 3 containing the frame data.
-     * NOTE: The returned data is managed by this class.
+     * @return A CPU tensor of size channels x height x width containing the frame data.
      */
-    float* renderFrameCpu(uint32_t numFrames);
+    torch::Tensor renderFrameCpu(uint32_t numFrames);
+
+    /**
+     * Records the rendering of a frame and the copy into a staging buffer of the readback ring, submits the commands
+     * and returns without waiting for the GPU. This way, the next frame can already be rendered while the data of the
+     * last frame is still being read back and repacked on the host.
+     * At most NUM_READBACK_SLOTS frames can be in flight. Submitting more frames without collecting them drops the
+     * oldest one.
+     * @param numFrames The number of frames to accumulate.
+     * @return A handle that can be passed to @see waitForFrameCpu.
+     */
+    uint64_t renderFrameCpuAsync(uint32_t numFrames);
+    /// Returns whether the GPU has finished the frame with the passed handle (i.e., waitForFrameCpu won't block).
+    bool getIsFrameCpuReady(uint64_t frameHandle);
+    /// Waits until the frame with the passed handle was rendered and returns it as a CPU tensor of size C x H x W.
+    torch::Tensor waitForFrameCpu(uint64_t frameHandle);
+    /**
+     * Waits until the frame with the passed handle was rendered and copies it into the passed contiguous float CPU
+     * tensor with channels * height * width elements. The staging buffer already stores the data in CHW layout, so
+     * only one copy out of the mapped memory is necessary.
+     */
+    void waitForFrameCpu(uint64_t frameHandle, const torch::Tensor& outputTensor);
 
     float* renderFrameVulkan(uint32_t numFrames);
 
-    float* getFeatureMapCpu(FeatureMapTypeVpt featureMap);
+    /**
+     * Renders one view per camera and returns the frames as a CPU tensor of size B x C x H x W. All views are recorded
+     * into one command buffer, each starting a new accumulation, and are read back using a single submission.
+     * @param cameras Either a B x 6 or B x 7 tensor (camera position, camera target and optionally the vertical field
+     * of view in degrees) or a B x 4 x 4 tensor of view matrices.
+     * @param numFrames The number of frames to accumulate per view.
+     */
+    torch::Tensor renderBatchCpu(const torch::Tensor& cameras, uint32_t numFrames);
+
+    /**
+     * Renders one frame per row of a parameter table and returns the frames as a CPU tensor of size N x C x H x W.
+     * Like for renderBatchCpu, all frames are recorded into one command buffer and read back using one submission.
+     * Between the frames, only uniform data changes (i.e., no shaders are recompiled). The parameters of the last row
+     * remain set afterwards.
+     * @param parameters An N x 14 or N x 15 tensor with the columns scattering albedo (3), extinction scale, phase
+     * function g, sunlight intensity, environment map intensity, seed offset, camera position (3), camera target (3)
+     * and optionally the vertical field of view in degrees.
+     * @param numFrames The number of frames to accumulate per row.
+     */
+    torch::Tensor renderSweepCpu(const torch::Tensor& parameters, uint32_t numFrames);
+
+    torch::Tensor getFeatureMapCpu(FeatureMapTypeVpt featureMap);
+    /**
+     * Returns the passed feature maps as a CPU tensor of size K x C x H x W. All feature maps are packed into one
+     * buffer and read back using a single submission.
+     */
+    torch::Tensor getFeatureMapsCpu(const std::vector<FeatureMapTypeVpt>& featureMaps);
     float* getFeatureMapCuda(FeatureMapTypeVpt featureMap);
 
 #ifdef SUPPORT_CUDA_INTEROP
@@ -138,16 +212,52 @@ private:
 
     sgl::vk::Renderer* renderer = nullptr;
     std::shared_ptr<VolumetricPathTracingPass> vptPass;
+    /// Number of elements of one image in the planar buffers (16-bit images are padded to an even number).
+    [[nodiscard]] size_t getImageSliceNumElements() const;
+    /// Returns the number of dispatches necessary for accumulating numFrames samples.
+    uint32_t getNumDispatches(uint32_t numFrames) const;
+    /// Sets the number of samples traced by the dispatch dispatchIdx when accumulating numFrames samples.
+    void setDispatchNumSamples(uint32_t dispatchIdx, uint32_t numFrames);
+    uint32_t maxNumSamplesPerDispatch = 256;
+    /// Records the dispatches necessary for accumulating numFrames samples into the current command buffer.
+    void recordFrameDispatches(uint32_t numFrames);
 
     sgl::vk::ImageViewPtr renderImageView;
     uint32_t numChannels = 0;
     caffe2::TypeMeta dtype;
     c10::DeviceType deviceType;
 
-    // Data for CPU rendering.
-    sgl::vk::ImagePtr renderImageStaging;
-    sgl::vk::FencePtr renderFinishedFence;
-    float* imageData = nullptr;
+    // Data for CPU rendering. The frames are read back using a ring of staging buffers.
+    static const uint32_t NUM_READBACK_SLOTS = 3;
+    struct ReadbackSlot {
+        sgl::vk::BufferPtr stagingBuffer; ///< Stores the frame in CHW layout.
+        sgl::vk::CommandBufferPtr commandBuffer;
+        sgl::vk::FencePtr fence;
+        uint64_t frameHandle = 0; ///< 0 means no frame was submitted using this slot.
+        bool isPending = false; ///< Whether the fence of the slot still needs to be waited on.
+    };
+    /// Returns the slot for the next frame. If the frame occupying it is still in flight, the function waits for it.
+    ReadbackSlot& acquireReadbackSlot();
+    /// Converts the render image to planar layout, copies it into the staging buffer of the slot and submits.
+    void submitReadback(ReadbackSlot& slot);
+    std::vector<ReadbackSlot> readbackSlots;
+    uint64_t lastFrameHandle = 0;
+    std::shared_ptr<PlanarBlitPass> planarBlitPass;
+    sgl::vk::BufferPtr planarImageBuffer;
+
+    // Data for batched rendering and feature map readback. The images are written to consecutive slices of the
+    // batch buffers and read back together.
+    /// Makes sure the batch buffers can hold numImages images of the current resolution.
+    void ensureBatchCapacity(uint32_t numImages);
+    /// Records the copy of the render image into the slice imageIndex of the batch buffer.
+    void recordBatchImageCopy(uint32_t imageIndex);
+    /// Ends the current command buffer, submits it and returns the first numImages images of the batch buffer.
+    torch::Tensor submitBatchReadback(uint32_t numImages);
+    std::shared_ptr<PlanarBlitPass> batchBlitPass;
+    sgl::vk::BufferPtr batchPlanarImageBuffer;
+    sgl::vk::BufferPtr batchStagingBuffer;
+    sgl::vk::FencePtr batchFinishedFence;
+    uint32_t batchCapacity = 0;
 
     // Data for Vulkan rendering.
 
@@ -165,4 +275,35 @@ private:
 #endif
 };
 
+/**
+ * Writes the channels of an RGBA image to a buffer with one contiguous plane per channel (CHW layout).
+ */
+class PlanarBlitPass : public sgl::vk::ComputePass {
+public:
+    explicit PlanarBlitPass(sgl::vk::Renderer* renderer);
+    void setInputImage(const sgl::vk::ImageViewPtr& _inputImage);
+    void setOutputBuffer(const sgl::vk::BufferPtr& _outputBuffer);
+    void setNumChannels(uint32_t _numChannels);
+    /// Offset (in number of elements) of the first element written to the output buffer.
+    void setOutputOffset(uint32_t _outputOffset);
+    /// Float32, float16 or bfloat16. The 16-bit types are converted on the GPU.
+    void setOutputDType(caffe2::TypeMeta _outputDType);
+
+protected:
+    void loadShader() override;
+    void createComputeData(sgl::vk::Renderer* renderer, sgl::vk::ComputePipelinePtr& computePipeline) override;
+    void _render() override;
+
+private:
+    const int BLOCK_SIZE = 16;
+    sgl::vk::ImageViewPtr inputImage;
+    sgl::vk::BufferPtr outputBuffer;
+    struct PushConstants {
+        uint32_t numChannels = 4;
+        uint32_t outputOffset = 0;
+    };
+    PushConstants pushConstants;
+    caffe2::TypeMeta outputDType = caffe2::TypeMeta::Make<float>();
+};
+
 #endif //CLOUDRENDERING_VOLUMETRICPATHTRACINGMODULERENDERER_HPP
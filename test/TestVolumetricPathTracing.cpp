@@ -26,6 +26,10 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <chrono>
+#include <cmath>
+#include <vector>
+
 #include <gtest/gtest.h>
 #include <json/json.h>
 
@@ -61,7 +65,11 @@ protected:
     void testEqualMean() {
         vptRenderer0->setRenderingResolution(renderingResolution, renderingResolution);
         vptRenderer1->setRenderingResolution(renderingResolution, renderingResolution);
+        testEqualMeanKeepAccumulationState();
+    }
 
+    /// Like @see testEqualMean, but expects the rendering resolution to be set already (keeps temporal history).
+    void testEqualMeanKeepAccumulationState() {
         uint32_t width = vptRenderer0->getFrameWidth();
         uint32_t height = vptRenderer0->getFrameHeight();
         float* frameData0 = vptRenderer0->renderFrame(numSamples);
@@ -94,6 +102,15 @@ protected:
         }
     }
 
+    static double computeRmse(const float* frameData, const float* referenceData, uint32_t numValues) {
+        double squaredErrorSum = 0.0;
+        for (uint32_t i = 0; i < numValues; i++) {
+            double difference = double(frameData[i]) - double(referenceData[i]);
+            squaredErrorSum += difference * difference;
+        }
+        return std::sqrt(squaredErrorSum / double(numValues));
+    }
+
     static void debugOutputImage(const std::string& filename, const float* frameData, uint32_t width, uint32_t height) {
         sgl::BitmapPtr bitmap(new sgl::Bitmap(int(width), int(height), 32));
         uint8_t* bitmapData = bitmap->getPixels();
@@ -139,6 +156,278 @@ TEST_F(VolumetricPathTracingTest, DeltaTrackingSeedIndependentEqualMeanTest) {
     vptRenderer1->setCustomSeedOffset(268435456u);
     testEqualMean();
 }
+TEST_F(VolumetricPathTracingTest, DeltaTrackingSamplesPerDispatchEqualMeanTest) {
+    CloudDataPtr cloudData = createCloudBlock(1, 1, 1, 1.0f);
+    vptRenderer0->setCloudData(cloudData);
+    vptRenderer1->setCloudData(cloudData);
+
+    vptRenderer0->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer1->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer1->setNumSamplesPerDispatch(16);
+    testEqualMean();
+}
+/**
+ * Test whether recording all dispatches of an accumulation into one command buffer produces the same image as
+ * submitting and waiting for every dispatch separately. Both renderers use the same seed, so the images should match.
+ */
+TEST_F(VolumetricPathTracingTest, DeltaTrackingSingleSubmissionEqualImageTest) {
+    CloudDataPtr cloudData = createCloudBlock(1, 1, 1, 1.0f);
+    vptRenderer0->setCloudData(cloudData);
+    vptRenderer1->setCloudData(cloudData);
+
+    vptRenderer0->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer1->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer0->setNumSamplesPerDispatch(4);
+    vptRenderer1->setNumSamplesPerDispatch(4);
+    vptRenderer0->setRenderingResolution(renderingResolution, renderingResolution);
+    vptRenderer1->setRenderingResolution(renderingResolution, renderingResolution);
+
+    uint32_t width = vptRenderer0->getFrameWidth();
+    uint32_t height = vptRenderer0->getFrameHeight();
+    float* frameData0 = vptRenderer0->renderFrame(numSamples);
+    float* frameData1 = vptRenderer1->renderFrameSingleSubmission(numSamples);
+
+    float maxDifference = 0.0f;
+    for (uint32_t i = 0; i < width * height * 3; i++) {
+        maxDifference = std::max(maxDifference, std::abs(frameData0[i] - frameData1[i]));
+    }
+    if (maxDifference > 1e-5f) {
+        debugOutputImage(
+                std::string() + "out_" + ::testing::UnitTest::GetInstance()->current_test_info()->name() + "_0.png",
+                frameData0, width, height);
+        debugOutputImage(
+                std::string() + "out_" + ::testing::UnitTest::GetInstance()->current_test_info()->name() + "_1.png",
+                frameData1, width, height);
+    }
+    ASSERT_LE(maxDifference, 1e-5f);
+}
+/**
+ * Test whether restarting the accumulation with temporal accumulation enabled (i.e., reusing the reprojected history
+ * of an unchanged view) produces the same image mean.
+ */
+TEST_F(VolumetricPathTracingTest, DeltaTrackingTemporalAccumulationEqualMeanTest) {
+    CloudDataPtr cloudData = createCloudBlock(1, 1, 1, 1.0f);
+    vptRenderer0->setCloudData(cloudData);
+    vptRenderer1->setCloudData(cloudData);
+
+    vptRenderer0->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer1->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer1->setUseTemporalAccumulation(true, 16);
+    vptRenderer0->setRenderingResolution(renderingResolution, renderingResolution);
+    vptRenderer1->setRenderingResolution(renderingResolution, renderingResolution);
+    vptRenderer1->renderFrame(numSamples);
+    vptRenderer1->setCloudData(cloudData);
+    testEqualMeanKeepAccumulationState();
+}
+/**
+ * Test whether reprojecting the history after a camera movement reduces the error compared to restarting the
+ * accumulation. Both are compared against a reference rendered from the new pose with 16 times as many samples per
+ * pixel and an independent seed.
+ */
+TEST_F(VolumetricPathTracingTest, DeltaTrackingTemporalAccumulationCameraMoveTest) {
+    CloudDataPtr cloudData = createCloudBlock(1, 1, 1, 1.0f);
+    vptRenderer0->setCloudData(cloudData);
+    vptRenderer1->setCloudData(cloudData);
+
+    vptRenderer0->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer1->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer1->setUseTemporalAccumulation(true, numSamples);
+    vptRenderer0->setRenderingResolution(renderingResolution, renderingResolution);
+    vptRenderer1->setRenderingResolution(renderingResolution, renderingResolution);
+    uint32_t width = vptRenderer0->getFrameWidth();
+    uint32_t height = vptRenderer0->getFrameHeight();
+    const uint32_t numValues = width * height * 3;
+
+    // Accumulate the history at the old pose.
+    vptRenderer1->renderFrame(numSamples);
+    const glm::vec3 cameraTranslation(0.02f, 0.01f, 0.0f);
+    vptRenderer0->translateCamera(cameraTranslation);
+    vptRenderer1->translateCamera(cameraTranslation);
+
+    float* restartedFrameData = vptRenderer0->renderFrame(numSamples);
+    std::vector<float> restartedData(restartedFrameData, restartedFrameData + numValues);
+    vptRenderer0->setCustomSeedOffset(268435456u);
+    vptRenderer0->onHasMoved();
+    float* referenceFrameData = vptRenderer0->renderFrame(numSamples * 16);
+    std::vector<float> referenceData(referenceFrameData, referenceFrameData + numValues);
+    float* reprojectedFrameData = vptRenderer1->renderFrame(numSamples);
+
+    double rmseRestarted = computeRmse(restartedData.data(), referenceData.data(), numValues);
+    double rmseReprojected = computeRmse(reprojectedFrameData, referenceData.data(), numValues);
+    if (rmseReprojected >= rmseRestarted) {
+        debugOutputImage(
+                std::string() + "out_" + ::testing::UnitTest::GetInstance()->current_test_info()->name() + "_0.png",
+                referenceData.data(), width, height);
+        debugOutputImage(
+                std::string() + "out_" + ::testing::UnitTest::GetInstance()->current_test_info()->name() + "_1.png",
+                reprojectedFrameData, width, height);
+    }
+    ASSERT_LT(rmseReprojected, rmseRestarted);
+}
+/**
+ * Test whether the full resolution accumulation following a frame traced at reduced resolution (i.e., after a camera
+ * movement with progressive resolution enabled) produces the same image mean.
+ */
+TEST_F(VolumetricPathTracingTest, DeltaTrackingProgressiveResolutionEqualMeanTest) {
+    CloudDataPtr cloudData = createCloudBlock(1, 1, 1, 1.0f);
+    vptRenderer0->setCloudData(cloudData);
+    vptRenderer1->setCloudData(cloudData);
+
+    vptRenderer0->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer1->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer1->setUseProgressiveResolution(true, 2, 4);
+    vptRenderer1->onHasMoved();
+    testEqualMean();
+}
+/**
+ * Test whether filling the pixels outside of the projected cloud box once with the environment produces the same image
+ * mean as tracing them with every dispatch.
+ */
+TEST_F(VolumetricPathTracingTest, DeltaTrackingSkipBackgroundPixelsEqualMeanTest) {
+    CloudDataPtr cloudData = createCloudBlock(1, 1, 1, 1.0f);
+    vptRenderer0->setCloudData(cloudData);
+    vptRenderer1->setCloudData(cloudData);
+
+    vptRenderer0->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer1->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer0->setSkipBackgroundPixels(false);
+    vptRenderer1->setSkipBackgroundPixels(true);
+    testEqualMean();
+}
+
+/**
+ * Test whether the feature maps only mode produces the same first event feature maps as delta tracking. With the same
+ * seed and camera, both modes sample the same free-flight distances for the primary rays, so the maps are expected to
+ * match already at one sample per pixel.
+ */
+TEST_F(VolumetricPathTracingTest, DeltaTrackingFeatureMapsOnlyEqualFeatureMapsTest) {
+    CloudDataPtr cloudData = createCloudBlock(1, 1, 1, 1.0f);
+    vptRenderer0->setCloudData(cloudData);
+    vptRenderer1->setCloudData(cloudData);
+
+    vptRenderer0->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer1->setVptMode(VptMode::FEATURE_MAPS_ONLY);
+    vptRenderer0->setRenderingResolution(renderingResolution, renderingResolution);
+    vptRenderer1->setRenderingResolution(renderingResolution, renderingResolution);
+    uint32_t width = vptRenderer0->getFrameWidth();
+    uint32_t height = vptRenderer0->getFrameHeight();
+    const uint32_t numValues = width * height * 3;
+
+    const FeatureMapTypeVpt featureMapTypes[] = {
+            FeatureMapTypeVpt::FIRST_X, FeatureMapTypeVpt::DEPTH, FeatureMapTypeVpt::DENSITY
+    };
+    for (FeatureMapTypeVpt featureMapType : featureMapTypes) {
+        vptRenderer0->setFeatureMapType(featureMapType);
+        vptRenderer1->setFeatureMapType(featureMapType);
+        // Restart the accumulation, so that both renderers use the same sample index for every feature map.
+        vptRenderer0->onHasMoved();
+        vptRenderer1->onHasMoved();
+        float* frameData0 = vptRenderer0->renderFrame(1);
+        std::vector<float> featureMapData0(frameData0, frameData0 + numValues);
+        float* frameData1 = vptRenderer1->renderFrame(1);
+
+        uint32_t numMismatches = 0;
+        for (uint32_t i = 0; i < numValues; i++) {
+            if (std::abs(featureMapData0[i] - frameData1[i]) > 1e-4f * std::max(std::abs(featureMapData0[i]), 1.0f)) {
+                numMismatches++;
+            }
+        }
+        if (numMismatches != 0) {
+            std::string featureMapName = VPT_FEATURE_MAP_NAMES[int(featureMapType)];
+            debugOutputImage(
+                    std::string() + "out_" + ::testing::UnitTest::GetInstance()->current_test_info()->name() + "_"
+                    + featureMapName + "_0.png",
+                    featureMapData0.data(), width, height);
+            debugOutputImage(
+                    std::string() + "out_" + ::testing::UnitTest::GetInstance()->current_test_info()->name() + "_"
+                    + featureMapName + "_1.png",
+                    frameData1, width, height);
+        }
+        ASSERT_EQ(numMismatches, 0u) << "Feature map: " << VPT_FEATURE_MAP_NAMES[int(featureMapType)];
+    }
+}
+
+/**
+ * Test whether the biased sun transmittance volume makes next event tracking faster. The volume lookup replaces the
+ * shadow ray traced at every collision, so it should be faster for a medium with many collisions.
+ */
+TEST_F(VolumetricPathTracingTest, NextEventTrackingSunTransmittanceVolumeSpeedupTest) {
+    CloudDataPtr cloudData = createCloudBlock(8, 8, 8, 1.0f);
+    vptRenderer0->setCloudData(cloudData);
+    vptRenderer1->setCloudData(cloudData);
+
+    vptRenderer0->setVptMode(VptMode::NEXT_EVENT_TRACKING);
+    vptRenderer1->setVptMode(VptMode::NEXT_EVENT_TRACKING);
+    vptRenderer1->setUseSunTransmittanceVolume(true);
+    vptRenderer0->setRenderingResolution(renderingResolution, renderingResolution);
+    vptRenderer1->setRenderingResolution(renderingResolution, renderingResolution);
+
+    // Compile the pipelines and precompute the volume before measuring.
+    vptRenderer0->renderFrame(1);
+    vptRenderer1->renderFrame(1);
+
+    auto startTimeTracked = std::chrono::steady_clock::now();
+    vptRenderer0->renderFrame(numSamples);
+    auto endTimeTracked = std::chrono::steady_clock::now();
+    auto startTimeVolume = std::chrono::steady_clock::now();
+    vptRenderer1->renderFrame(numSamples);
+    auto endTimeVolume = std::chrono::steady_clock::now();
+
+    double timeTrackedMs = std::chrono::duration<double, std::milli>(endTimeTracked - startTimeTracked).count();
+    double timeVolumeMs = std::chrono::duration<double, std::milli>(endTimeVolume - startTimeVolume).count();
+    std::cout << "Shadow rays: " << timeTrackedMs << "ms, sun transmittance volume: " << timeVolumeMs << "ms"
+              << std::endl;
+    ASSERT_LT(timeVolumeMs, timeTrackedMs);
+}
+TEST_F(VolumetricPathTracingTest, DeltaTrackingSobolSamplerEqualMeanTest) {
+    CloudDataPtr cloudData = createCloudBlock(1, 1, 1, 1.0f);
+    vptRenderer0->setCloudData(cloudData);
+    vptRenderer1->setCloudData(cloudData);
+
+    vptRenderer0->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer1->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer1->setSamplerType(VptSamplerType::SOBOL);
+    testEqualMean();
+}
+TEST_F(VolumetricPathTracingTest, NextEventTrackingBlueNoiseSamplerEqualMeanTest) {
+    CloudDataPtr cloudData = createCloudBlock(1, 1, 1, 1.0f);
+    vptRenderer0->setCloudData(cloudData);
+    vptRenderer1->setCloudData(cloudData);
+
+    vptRenderer0->setVptMode(VptMode::NEXT_EVENT_TRACKING);
+    vptRenderer1->setVptMode(VptMode::NEXT_EVENT_TRACKING);
+    vptRenderer1->setSamplerType(VptSamplerType::SOBOL_BLUE_NOISE);
+    testEqualMean();
+}
+/**
+ * Test whether the Owen-scrambled Sobol sampler does not increase the error at equal sample count. The error is
+ * measured against a white noise reference with 16 times as many samples per pixel and an independent seed.
+ */
+TEST_F(VolumetricPathTracingTest, DeltaTrackingSobolSamplerEqualSppRmseTest) {
+    CloudDataPtr cloudData = createCloudBlock(1, 1, 1, 1.0f);
+    vptRenderer0->setCloudData(cloudData);
+    vptRenderer1->setCloudData(cloudData);
+
+    vptRenderer0->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer1->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer0->setCustomSeedOffset(268435456u);
+    vptRenderer0->setRenderingResolution(renderingResolution, renderingResolution);
+    vptRenderer1->setRenderingResolution(renderingResolution, renderingResolution);
+    uint32_t width = vptRenderer0->getFrameWidth();
+    uint32_t height = vptRenderer0->getFrameHeight();
+    const uint32_t numValues = width * height * 3;
+
+    float* referenceFrameData = vptRenderer0->renderFrame(numSamples * 16);
+    std::vector<float> referenceData(referenceFrameData, referenceFrameData + numValues);
+    float* whiteNoiseFrameData = vptRenderer1->renderFrame(numSamples);
+    double rmseWhiteNoise = computeRmse(whiteNoiseFrameData, referenceData.data(), numValues);
+    vptRenderer1->setSamplerType(VptSamplerType::SOBOL);
+    float* sobolFrameData = vptRenderer1->renderFrame(numSamples);
+    double rmseSobol = computeRmse(sobolFrameData, referenceData.data(), numValues);
+
+    // Small margin for the noise of the reference itself.
+    ASSERT_LE(rmseSobol, rmseWhiteNoise * 1.05);
+}
 TEST_F(VolumetricPathTracingTest, DeltaTrackingGridTypesGrid1Test) {
     CloudDataPtr cloudData = createCloudBlock(1, 1, 1, 1.0f);
     vptRenderer0->setCloudData(cloudData);
@@ -184,6 +473,44 @@ TEST_F(VolumetricPathTracingTest, DeltaTrackingGridTypesGrid8BoundaryLayerTest2)
     vptRenderer1->setGridInterpolationType(GridInterpolationType::TRILINEAR);
     testEqualMean();
 }
+TEST_F(VolumetricPathTracingTest, DeltaTrackingGridTypesGrid20BoundaryLayerTrilinearTest) {
+    // Spans multiple 8^3 NanoVDB leaf nodes, so both the leaf-local and the cross-leaf stencil fetches are used.
+    CloudDataPtr cloudData = createCloudBlock(20, 20, 20, 1.0f, true);
+    vptRenderer0->setCloudData(cloudData);
+    vptRenderer1->setCloudData(cloudData);
+
+    vptRenderer0->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer0->setUseSparseGrid(false);
+    vptRenderer1->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer1->setUseSparseGrid(true);
+    vptRenderer1->setGridInterpolationType(GridInterpolationType::TRILINEAR);
+    testEqualMean();
+}
+TEST_F(VolumetricPathTracingTest, DeltaTrackingGridTypesBrickMapGrid20BoundaryLayerTest) {
+    CloudDataPtr cloudData = createCloudBlock(20, 20, 20, 1.0f, true);
+    vptRenderer0->setCloudData(cloudData);
+    vptRenderer1->setCloudData(cloudData);
+
+    vptRenderer0->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer0->setGridType(GridType::DENSE);
+    vptRenderer1->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer1->setGridType(GridType::BRICK_MAP);
+    testEqualMean();
+}
+TEST_F(VolumetricPathTracingTest, DeltaTrackingGridTypesBrickMapGrid20BoundaryLayerTrilinearTest) {
+    // Hardware filtering inside of the bricks needs to match the filtering of the dense texture across brick borders.
+    CloudDataPtr cloudData = createCloudBlock(20, 20, 20, 1.0f, true);
+    vptRenderer0->setCloudData(cloudData);
+    vptRenderer1->setCloudData(cloudData);
+
+    vptRenderer0->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer0->setGridType(GridType::DENSE);
+    vptRenderer0->setGridInterpolationType(GridInterpolationType::TRILINEAR);
+    vptRenderer1->setVptMode(VptMode::DELTA_TRACKING);
+    vptRenderer1->setGridType(GridType::BRICK_MAP);
+    vptRenderer1->setGridInterpolationType(GridInterpolationType::TRILINEAR);
+    testEqualMean();
+}
 
 // TODO: Fix this test case.
 /*TEST_F(VolumetricPathTracingTest, DecompositionTrackingGridTypesSphereTest) {
@@ -26,6 +26,7 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <Math/Math.hpp>
 #include <Utils/AppSettings.hpp>
 #include <ImGui/imgui.h>
 
@@ -92,6 +93,10 @@ void VolumetricPathTracingTestRenderer::setUseSparseGrid(bool useSparseGrid) {
     vptPass->setUseSparseGrid(useSparseGrid);
 }
 
+void VolumetricPathTracingTestRenderer::setGridType(GridType type) {
+    vptPass->setGridType(type);
+}
+
 void VolumetricPathTracingTestRenderer::setGridInterpolationType(GridInterpolationType type) {
     vptPass->setSparseGridInterpolationType(type);
 }
@@ -100,6 +105,10 @@ void VolumetricPathTracingTestRenderer::setCustomSeedOffset(uint32_t offset) {
     vptPass->setCustomSeedOffset(offset);
 }
 
+void VolumetricPathTracingTestRenderer::setSamplerType(VptSamplerType samplerType) {
+    vptPass->setSamplerType(samplerType);
+}
+
 void VolumetricPathTracingTestRenderer::setUseLinearRGB(bool useLinearRGB) {
     vptPass->setUseLinearRGB(useLinearRGB);
 }
@@ -120,19 +129,51 @@ void VolumetricPathTracingTestRenderer::setVptModeFromString(const std::string&
             + vptModeName + "\".");
 }
 
+void VolumetricPathTracingTestRenderer::setNumSamplesPerDispatch(int numSamples) {
+    numSamplesPerDispatch = std::max(numSamples, 1);
+}
+
+void VolumetricPathTracingTestRenderer::setUseTemporalAccumulation(bool useTemporalAccumulation, int maxHistoryLength) {
+    vptPass->setUseTemporalAccumulation(useTemporalAccumulation);
+    vptPass->setTemporalMaxHistoryLength(maxHistoryLength);
+}
+
+void VolumetricPathTracingTestRenderer::setUseProgressiveResolution(
+        bool useProgressiveResolution, int pixelStride, int numSamples) {
+    vptPass->setUseProgressiveResolution(useProgressiveResolution);
+    vptPass->setProgressiveResolutionSettings(pixelStride, numSamples);
+}
+
+void VolumetricPathTracingTestRenderer::onHasMoved() {
+    vptPass->onHasMoved();
+}
+
+void VolumetricPathTracingTestRenderer::translateCamera(const glm::vec3& translation) {
+    camera->setPosition(camera->getPosition() + translation);
+    vptPass->onHasMoved();
+}
+
+void VolumetricPathTracingTestRenderer::setSkipBackgroundPixels(bool skipBackgroundPixels) {
+    vptPass->setSkipBackgroundPixels(skipBackgroundPixels);
+}
+
+void VolumetricPathTracingTestRenderer::setUseSunTransmittanceVolume(bool useSunTransmittanceVolume) {
+    vptPass->setUseSunTransmittanceVolume(useSunTransmittanceVolume);
+}
+
+void VolumetricPathTracingTestRenderer::setFeatureMapType(FeatureMapTypeVpt type) {
+    vptPass->setFeatureMapType(type);
+}
+
 float* VolumetricPathTracingTestRenderer::renderFrame(int numFrames) {
     // TODO: Allow multiple frames in flight.
-    for (int i = 0; i < numFrames; i++) {
+    const int numDispatches = std::max(sgl::iceil(numFrames, numSamplesPerDispatch), 1);
+    for (int i = 0; i < numDispatches; i++) {
+        vptPass->setNumSamplesPerDispatch(std::min(numSamplesPerDispatch, numFrames - i * numSamplesPerDispatch));
         renderer->beginCommandBuffer();
         vptPass->render();
-        if (i == numFrames - 1) {
-            renderImageView->getImage()->transitionImageLayout(
-                    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, renderer->getVkCommandBuffer());
-            renderImageStaging->transitionImageLayout(
-                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, renderer->getVkCommandBuffer());
-            renderImageView->getImage()->copyToImage(
-                    renderImageStaging, VK_IMAGE_ASPECT_COLOR_BIT,
-                    renderer->getVkCommandBuffer());
+        if (i == numDispatches - 1) {
+            recordRenderImageCopy();
         }
         renderer->endCommandBuffer();
 
@@ -144,6 +185,45 @@ float* VolumetricPathTracingTestRenderer::renderFrame(int numFrames) {
         renderFinishedFence->reset();
     }
 
+    return readRenderImageStaging();
+}
+
+float* VolumetricPathTracingTestRenderer::renderFrameSingleSubmission(int numFrames) {
+    const int numDispatches = std::max(sgl::iceil(numFrames, numSamplesPerDispatch), 1);
+    renderer->beginCommandBuffer();
+    for (int i = 0; i < numDispatches; i++) {
+        if (i != 0) {
+            // The dispatch reads the accumulation of the last dispatch and overwrites the uniform data it used.
+            renderer->insertMemoryBarrier(
+                    VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+                    VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        }
+        vptPass->setNumSamplesPerDispatch(std::min(numSamplesPerDispatch, numFrames - i * numSamplesPerDispatch));
+        vptPass->render();
+    }
+    recordRenderImageCopy();
+    renderer->endCommandBuffer();
+
+    renderer->submitToQueue(
+            {}, {}, renderFinishedFence,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    renderFinishedFence->wait();
+    renderFinishedFence->reset();
+
+    return readRenderImageStaging();
+}
+
+void VolumetricPathTracingTestRenderer::recordRenderImageCopy() {
+    renderImageView->getImage()->transitionImageLayout(
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, renderer->getVkCommandBuffer());
+    renderImageStaging->transitionImageLayout(
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, renderer->getVkCommandBuffer());
+    renderImageView->getImage()->copyToImage(
+            renderImageStaging, VK_IMAGE_ASPECT_COLOR_BIT,
+            renderer->getVkCommandBuffer());
+}
+
+float* VolumetricPathTracingTestRenderer::readRenderImageStaging() {
     uint32_t width = renderImageStaging->getImageSettings().width;
     uint32_t height = renderImageStaging->getImageSettings().height;
     VkSubresourceLayout subresourceLayout =
@@ -39,6 +39,7 @@ typedef std::shared_ptr<CloudData> CloudDataPtr;
 class VolumetricPathTracingPass;
 enum class VptMode;
 enum class GridInterpolationType;
+enum class GridType;
 
 namespace sgl {
 class Camera;
@@ -60,11 +61,16 @@ public:
 
     /// Sets whether a dense or sparse grid should be used.
     void setUseSparseGrid(bool useSparseGrid);
+    /// Sets the representation of the density grid (dense, NanoVDB or brick map).
+    void setGridType(GridType type);
     void setGridInterpolationType(GridInterpolationType type);
 
     /// Sets an additive offset for the random seed in the VPT shader.
     void setCustomSeedOffset(uint32_t offset);
 
+    /// Sets the sample generator used by the path tracer.
+    void setSamplerType(VptSamplerType samplerType);
+
     /// Sets whether linear RGB or sRGB should be used for rendering.
     void setUseLinearRGB(bool useLinearRGB);
 
@@ -72,18 +78,45 @@ public:
     void setVptMode(VptMode vptMode);
     void setVptModeFromString(const std::string& vptModeName);
 
+    /// Sets the number of samples per pixel traced by a single dispatch of the VPT pass.
+    void setNumSamplesPerDispatch(int numSamples);
+
+    /// Sets whether the accumulated samples are reprojected instead of discarded when the accumulation restarts.
+    void setUseTemporalAccumulation(bool useTemporalAccumulation, int maxHistoryLength);
+
+    /// Sets whether frames rendered after @see onHasMoved are traced at reduced resolution and upsampled.
+    void setUseProgressiveResolution(bool useProgressiveResolution, int pixelStride, int numSamples);
+    /// Signals a camera movement to the VPT pass.
+    void onHasMoved();
+    /// Moves the camera by the passed offset and signals the movement to the VPT pass.
+    void translateCamera(const glm::vec3& translation);
+    /// Sets whether pixels outside of the projected cloud box are only traced in the first dispatch.
+    void setSkipBackgroundPixels(bool skipBackgroundPixels);
+    /// Sets whether next event tracking looks up the sun transmittance in a precomputed volume (biased).
+    void setUseSunTransmittanceVolume(bool useSunTransmittanceVolume);
+    /// Sets the feature map that is copied to the frame returned by @see renderFrame instead of the result.
+    void setFeatureMapType(FeatureMapTypeVpt type);
+
     /**
      * Renders the path traced volume object to the scene framebuffer.
-     * @param numFrames The number of frames to accumulate.
+     * @param numFrames The number of frames (i.e., samples per pixel) to accumulate.
      * @return An floating point array of size width * height * 3 containing the frame data.
      * NOTE: The returned data is managed by this class.
      */
     float* renderFrame(int numFrames);
+    /// Like @see renderFrame, but records all dispatches into one command buffer and submits it once.
+    float* renderFrameSingleSubmission(int numFrames);
 
 private:
+    /// Records the copy of the render image into the staging image.
+    void recordRenderImageCopy();
+    /// Copies the staging image into imageData after the GPU has finished.
+    float* readRenderImageStaging();
+
     sgl::CameraPtr camera;
     sgl::vk::Renderer* renderer = nullptr;
     std::shared_ptr<VolumetricPathTracingPass> vptPass;
+    int numSamplesPerDispatch = 1;
 
     sgl::vk::ImageViewPtr renderImageView;
     sgl::vk::ImagePtr renderImageStaging;